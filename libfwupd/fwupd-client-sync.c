@@ -1997,6 +1997,56 @@ fwupd_client_download_bytes (FwupdClient *self,
 	return g_steal_pointer (&helper->bytes);
 }
 
+static void
+fwupd_client_download_file_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
+	helper->ret = fwupd_client_download_file_finish (FWUPD_CLIENT (source), res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fwupd_client_download_file:
+ * @self: A #FwupdClient
+ * @url: the remote URL
+ * @filename: the destination filename
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Downloads data from a remote server to a local file, resuming an interrupted
+ * transfer if possible. The fwupd_client_set_user_agent() function should be
+ * called before this method is used.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fwupd_client_download_file (FwupdClient *self,
+			    const gchar *url,
+			    const gchar *filename,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	g_autoptr(FwupdClientHelper) helper = fwupd_client_helper_new ();
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	g_return_val_if_fail (url != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* call async version and run loop until complete */
+	fwupd_client_download_file_async (self, url, filename, cancellable,
+					  fwupd_client_download_file_cb, helper);
+	g_main_loop_run (helper->loop);
+	if (!helper->ret) {
+		g_propagate_error (error, g_steal_pointer (&helper->error));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fwupd_client_upload_bytes_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
@@ -13,7 +13,9 @@
 #include <gio/gunixfdlist.h>
 #endif
 
+#include <errno.h>
 #include <fcntl.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -25,6 +27,7 @@
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-plugin-private.h"
 #include "fwupd-security-attr-private.h"
 #include "fwupd-release-private.h"
@@ -54,6 +57,9 @@ typedef struct {
 	GDBusProxy			*proxy;
 	SoupSession			*soup_session;
 	gchar				*user_agent;
+	FwupdFeatureFlags		 feature_flags;
+	GHashTable			*devices_delta;	/* device-id:FwupdDevice */
+	GArray				*signal_ids;	/* of guint */
 } FwupdClientPrivate;
 
 enum {
@@ -208,6 +214,18 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 	}
 }
 
+/* the device as last sent by the daemon, with the delta applied */
+static FwupdDevice *
+fwupd_client_device_apply_delta (FwupdDevice *device, GVariant *parameters)
+{
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_old = NULL;
+
+	val_old = g_variant_ref_sink (fwupd_device_to_variant (device));
+	val = g_variant_ref_sink (fwupd_device_variant_apply_delta (val_old, parameters));
+	return fwupd_device_from_variant (val);
+}
+
 static void
 fwupd_client_signal_cb (GDBusProxy *proxy,
 			const gchar *sender_name,
@@ -215,6 +233,8 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 			GVariant *parameters,
 			FwupdClient *self)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	gboolean use_delta = (priv->feature_flags & FWUPD_FEATURE_FLAG_DEVICE_DELTA) > 0;
 	g_autoptr(FwupdDevice) dev = NULL;
 	if (g_strcmp0 (signal_name, "Changed") == 0) {
 		g_debug ("Emitting ::changed()");
@@ -223,6 +243,11 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		if (use_delta) {
+			g_hash_table_insert (priv->devices_delta,
+					     g_strdup (fwupd_device_get_id (dev)),
+					     g_object_ref (dev));
+		}
 		g_debug ("Emitting ::device-added(%s)",
 			 fwupd_device_get_id (dev));
 		g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, dev);
@@ -230,6 +255,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		g_hash_table_remove (priv->devices_delta, fwupd_device_get_id (dev));
 		g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, dev);
 		g_debug ("Emitting ::device-removed(%s)",
 			 fwupd_device_get_id (dev));
@@ -237,14 +263,111 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		if (use_delta) {
+			g_hash_table_insert (priv->devices_delta,
+					     g_strdup (fwupd_device_get_id (dev)),
+					     g_object_ref (dev));
+		}
 		g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
 		g_debug ("Emitting ::device-changed(%s)",
 			 fwupd_device_get_id (dev));
 		return;
 	}
+	if (g_strcmp0 (signal_name, "DeviceChangedDelta") == 0) {
+		FwupdDevice *dev_old;
+		const gchar *device_id = NULL;
+		g_autoptr(GVariant) changed = g_variant_get_child_value (parameters, 0);
+
+		/* sent before SetFeatureFlags was processed */
+		if (!use_delta)
+			return;
+		if (!g_variant_lookup (changed, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id))
+			return;
+		dev_old = g_hash_table_lookup (priv->devices_delta, device_id);
+		if (dev_old == NULL)
+			return;
+		dev = fwupd_client_device_apply_delta (dev_old, parameters);
+		g_hash_table_insert (priv->devices_delta,
+				     g_strdup (fwupd_device_get_id (dev)),
+				     g_object_ref (dev));
+		g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
+		g_debug ("Emitting ::device-changed(%s) from delta",
+			 fwupd_device_get_id (dev));
+		return;
+	}
 	g_debug ("Unknown signal name '%s' from %s", signal_name, sender_name);
 }
 
+static void
+fwupd_client_signal_subscribe_cb (GDBusConnection *connection,
+				  const gchar *sender_name,
+				  const gchar *object_path,
+				  const gchar *interface_name,
+				  const gchar *signal_name,
+				  GVariant *parameters,
+				  gpointer user_data)
+{
+	FwupdClient *self = FWUPD_CLIENT (user_data);
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	fwupd_client_signal_cb (priv->proxy, sender_name, signal_name, parameters, self);
+}
+
+static void
+fwupd_client_signals_unsubscribe (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	for (guint i = 0; i < priv->signal_ids->len; i++) {
+		guint id = g_array_index (priv->signal_ids, guint, i);
+		g_dbus_connection_signal_unsubscribe (priv->conn, id);
+	}
+	g_array_set_size (priv->signal_ids, 0);
+}
+
+static void
+fwupd_client_signals_subscribe_name (FwupdClient *self,
+				     const gchar *signal_name,
+				     GDBusSignalFlags flags)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	guint id = g_dbus_connection_signal_subscribe (priv->conn,
+						       FWUPD_DBUS_SERVICE,
+						       FWUPD_DBUS_INTERFACE,
+						       signal_name,
+						       FWUPD_DBUS_PATH,
+						       NULL,
+						       flags,
+						       fwupd_client_signal_subscribe_cb,
+						       self, NULL);
+	g_array_append_val (priv->signal_ids, id);
+}
+
+/* clients applying deltas do not add a match rule for the DeviceChanged
+ * broadcast, so the bus never sends it to them; the daemon instead sends
+ * them DeviceChanged or DeviceChangedDelta directly */
+static void
+fwupd_client_signals_subscribe (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	const gchar *signal_names[] = { "Changed", "DeviceAdded", "DeviceRemoved" };
+	const gchar *signal_names_unicast[] = { "DeviceChanged", "DeviceChangedDelta" };
+
+	fwupd_client_signals_unsubscribe (self);
+	if ((priv->feature_flags & FWUPD_FEATURE_FLAG_DEVICE_DELTA) == 0) {
+		fwupd_client_signals_subscribe_name (self, NULL, G_DBUS_SIGNAL_FLAGS_NONE);
+		return;
+	}
+	for (guint i = 0; i < G_N_ELEMENTS (signal_names); i++) {
+		fwupd_client_signals_subscribe_name (self,
+						     signal_names[i],
+						     G_DBUS_SIGNAL_FLAGS_NONE);
+	}
+	for (guint i = 0; i < G_N_ELEMENTS (signal_names_unicast); i++) {
+		fwupd_client_signals_subscribe_name (self,
+						     signal_names_unicast[i],
+						     G_DBUS_SIGNAL_FLAGS_NO_MATCH_RULE);
+	}
+}
+
 /**
  * fwupd_client_ensure_networking:
  * @self: A #FwupdClient
@@ -346,8 +469,7 @@ fwupd_client_connect_get_proxy_cb (GObject *source,
 	}
 	g_signal_connect (priv->proxy, "g-properties-changed",
 			  G_CALLBACK (fwupd_client_properties_changed_cb), self);
-	g_signal_connect (priv->proxy, "g-signal",
-			  G_CALLBACK (fwupd_client_signal_cb), self);
+	fwupd_client_signals_subscribe (self);
 	val = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
 	if (val != NULL)
 		fwupd_client_set_daemon_version (self, g_variant_get_string (val, NULL));
@@ -388,7 +510,7 @@ fwupd_client_connect_get_bus_cb (GObject *source,
 		return;
 	}
 	g_dbus_proxy_new (priv->conn,
-			  G_DBUS_PROXY_FLAGS_NONE,
+			  G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
 			  NULL,
 			  FWUPD_DBUS_SERVICE,
 			  FWUPD_DBUS_PATH,
@@ -2153,6 +2275,7 @@ typedef struct {
 	FwupdDevice		*device;
 	FwupdRelease		*release;
 	FwupdInstallFlags	 install_flags;
+	gchar			*filename;	/* (nullable): in the download cache */
 } FwupdClientInstallReleaseData;
 
 static void
@@ -2160,6 +2283,7 @@ fwupd_client_install_release_data_free (FwupdClientInstallReleaseData *data)
 {
 	g_object_unref (data->device);
 	g_object_unref (data->release);
+	g_free (data->filename);
 	g_free (data);
 }
 
@@ -2178,60 +2302,167 @@ fwupd_client_install_release_cb (GObject *source, GAsyncResult *res, gpointer us
 	g_task_return_boolean (task, TRUE);
 }
 
+/* files not used for this long are deleted from the download cache */
+#define FWUPD_CLIENT_DOWNLOAD_CACHE_MAX_AGE	(60 * 60 * 24 * 30)
+
+static gchar *
+fwupd_client_get_download_cache_dir (void)
+{
+	const gchar *root = g_get_user_cache_dir ();
+
+	/* if run from a systemd unit, use the cache directory set there */
+	if (g_getenv ("CACHE_DIRECTORY") != NULL)
+		root = g_getenv ("CACHE_DIRECTORY");
+	return g_build_filename (root, "fwupd", "downloads", NULL);
+}
+
+/* the release checksum is used as the filename so that the same firmware
+ * is only downloaded once, regardless of the URI */
+static gchar *
+fwupd_client_get_download_cache_filename (const gchar *checksum)
+{
+	g_autofree gchar *cachedir = fwupd_client_get_download_cache_dir ();
+	return g_build_filename (cachedir, checksum, NULL);
+}
+
+/* delete firmware, and partial downloads, that have not been used recently */
 static void
-fwupd_client_install_release_bytes_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+fwupd_client_download_cache_expire (void)
 {
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GTask) task = G_TASK (user_data);
+	const gchar *fn;
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+	g_autofree gchar *cachedir = fwupd_client_get_download_cache_dir ();
+	g_autoptr(GDir) dir = NULL;
 
-	if (!fwupd_client_install_bytes_finish (FWUPD_CLIENT (source), res, &error)) {
-		g_task_return_error (task, g_steal_pointer (&error));
+	dir = g_dir_open (cachedir, 0, NULL);
+	if (dir == NULL)
 		return;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		GStatBuf st;
+		g_autofree gchar *fn_tmp = g_build_filename (cachedir, fn, NULL);
+		if (g_stat (fn_tmp, &st) != 0)
+			continue;
+		if (now - (gint64) st.st_mtime < FWUPD_CLIENT_DOWNLOAD_CACHE_MAX_AGE)
+			continue;
+		g_debug ("deleting expired %s", fn_tmp);
+		if (g_unlink (fn_tmp) != 0)
+			g_debug ("failed to delete %s: %s", fn_tmp, g_strerror (errno));
 	}
+}
 
-	/* success */
-	g_task_return_boolean (task, TRUE);
+static gboolean
+fwupd_client_verify_checksum_for_filename (const gchar *filename,
+					   const gchar *checksum_expected,
+					   GError **error)
+{
+	GChecksumType checksum_type = fwupd_checksum_guess_kind (checksum_expected);
+	g_autofree gchar *checksum_actual = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	if (mapped_file == NULL)
+		return FALSE;
+	checksum_actual = g_compute_checksum_for_data (checksum_type,
+						       (const guchar *) g_mapped_file_get_contents (mapped_file),
+						       g_mapped_file_get_length (mapped_file));
+	if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "checksum invalid, expected %s got %s",
+			     checksum_expected, checksum_actual);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+fwupd_client_install_release_filename (GTask *task, const gchar *filename)
+{
+	FwupdClient *self = g_task_get_source_object (task);
+	FwupdClientInstallReleaseData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	/* if the device specifies ONLY_OFFLINE automatically set this flag */
+	if (fwupd_device_has_flag (data->device, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
+		data->install_flags |= FWUPD_INSTALL_FLAG_OFFLINE;
+	fwupd_client_install_async (self,
+				    fwupd_device_get_id (data->device),
+				    filename, data->install_flags,
+				    cancellable,
+				    fwupd_client_install_release_cb,
+				    task);
 }
 
 static void
 fwupd_client_install_release_download_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GTask) task = G_TASK (user_data);
 	FwupdClientInstallReleaseData *data = g_task_get_task_data (task);
-	GChecksumType checksum_type;
-	GCancellable *cancellable = g_task_get_cancellable (task);
 	const gchar *checksum_expected;
-	g_autofree gchar *checksum_actual = NULL;
 
-	blob = fwupd_client_download_bytes_finish (FWUPD_CLIENT (source), res, &error);
-	if (blob == NULL) {
+	if (!fwupd_client_download_file_finish (FWUPD_CLIENT (source), res, &error)) {
 		g_task_return_error (task, g_steal_pointer (&error));
 		return;
 	}
 
-	/* verify checksum */
+	/* verify checksum, and do not keep bad data in the cache */
 	checksum_expected = fwupd_checksum_get_best (fwupd_release_get_checksums (data->release));
-	checksum_type = fwupd_checksum_guess_kind (checksum_expected);
-	checksum_actual = g_compute_checksum_for_bytes (checksum_type, blob);
-	if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
+	if (!fwupd_client_verify_checksum_for_filename (data->filename,
+							checksum_expected,
+							&error)) {
+		g_unlink (data->filename);
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	fwupd_client_install_release_filename (g_steal_pointer (&task), data->filename);
+}
+
+static void
+fwupd_client_install_release_download (GTask *task, const gchar *url)
+{
+	FwupdClient *self = g_task_get_source_object (task);
+	FwupdClientInstallReleaseData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	const gchar *checksum_expected;
+
+	checksum_expected = fwupd_checksum_get_best (fwupd_release_get_checksums (data->release));
+	if (checksum_expected == NULL) {
 		g_task_return_new_error (task,
 					 FWUPD_ERROR,
 					 FWUPD_ERROR_INVALID_FILE,
-					 "checksum invalid, expected %s got %s",
-					 checksum_expected, checksum_actual);
+					 "no checksum for %s",
+					 url);
+		g_object_unref (task);
 		return;
 	}
 
-	/* if the device specifies ONLY_OFFLINE automatically set this flag */
-	if (fwupd_device_has_flag (data->device, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
-		data->install_flags |= FWUPD_INSTALL_FLAG_OFFLINE;
-	fwupd_client_install_bytes_async (FWUPD_CLIENT (source),
-					  fwupd_device_get_id (data->device), blob,
-					  data->install_flags, cancellable,
-					  fwupd_client_install_release_bytes_cb,
-					  g_steal_pointer (&task));
+	/* already downloaded */
+	fwupd_client_download_cache_expire ();
+	data->filename = fwupd_client_get_download_cache_filename (checksum_expected);
+	if (g_file_test (data->filename, G_FILE_TEST_EXISTS)) {
+		g_autoptr(GError) error_local = NULL;
+		if (fwupd_client_verify_checksum_for_filename (data->filename,
+							       checksum_expected,
+							       &error_local)) {
+			g_debug ("using cached %s", data->filename);
+
+			/* used recently, so do not expire */
+			if (g_utime (data->filename, NULL) != 0)
+				g_debug ("failed to touch %s", data->filename);
+			fwupd_client_install_release_filename (task, data->filename);
+			return;
+		}
+		g_debug ("ignoring cached %s: %s", data->filename, error_local->message);
+		g_unlink (data->filename);
+	}
+
+	/* download file */
+	fwupd_client_download_file_async (self, url, data->filename,
+					  cancellable,
+					  fwupd_client_install_release_download_cb,
+					  task);
 }
 
 static void
@@ -2284,11 +2515,7 @@ fwupd_client_install_release_remote_cb (GObject *source, GAsyncResult *res, gpoi
 	}
 
 	/* download file */
-	fwupd_client_download_bytes_async (FWUPD_CLIENT (source), uri_str,
-					   FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
-					   cancellable,
-					   fwupd_client_install_release_download_cb,
-					   g_steal_pointer (&task));
+	fwupd_client_install_release_download (g_steal_pointer (&task), uri_str);
 }
 
 /**
@@ -2337,12 +2564,8 @@ fwupd_client_install_release_async (FwupdClient *self,
 	/* work out what remote-specific URI fields this should use */
 	remote_id = fwupd_release_get_remote_id (release);
 	if (remote_id == NULL) {
-		fwupd_client_download_bytes_async (self,
-						   fwupd_release_get_uri (release),
-						   FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
-						   cancellable,
-						   fwupd_client_install_release_download_cb,
-						   g_steal_pointer (&task));
+		fwupd_client_install_release_download (g_steal_pointer (&task),
+						       fwupd_release_get_uri (release));
 		return;
 	}
 
@@ -3387,6 +3610,7 @@ fwupd_client_set_feature_flags_cb (GObject *source,
 				   gpointer user_data)
 {
 	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = g_task_get_source_object (task);
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) val = NULL;
 
@@ -3397,6 +3621,9 @@ fwupd_client_set_feature_flags_cb (GObject *source,
 		return;
 	}
 
+	/* the daemon now knows if device changes are to be sent directly */
+	fwupd_client_signals_subscribe (self);
+
 	/* success */
 	g_task_return_boolean (task, TRUE);
 }
@@ -3429,6 +3656,11 @@ fwupd_client_set_feature_flags_async (FwupdClient *self,
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 	g_return_if_fail (priv->proxy != NULL);
 
+	/* devices are only cached when applying deltas */
+	priv->feature_flags = feature_flags;
+	if ((feature_flags & FWUPD_FEATURE_FLAG_DEVICE_DELTA) == 0)
+		g_hash_table_remove_all (priv->devices_delta);
+
 	/* call into daemon */
 	task = g_task_new (self, cancellable, callback, callback_data);
 	g_dbus_proxy_call (priv->proxy, "SetFeatureFlags",
@@ -3904,7 +4136,8 @@ fwupd_client_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer us
 	FwupdClient *self = FWUPD_CLIENT (user_data);
 
 	/* if it's returning "Found" or an error, ignore the percentage */
-	if (msg->status_code != SOUP_STATUS_OK) {
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_PARTIAL_CONTENT) {
 		g_debug ("ignoring status code %u (%s)",
 			 msg->status_code, msg->reason_phrase);
 		return;
@@ -4074,6 +4307,312 @@ fwupd_client_download_bytes_finish (FwupdClient *self, GAsyncResult *res, GError
 	return g_task_propagate_pointer (G_TASK(res), error);
 }
 
+typedef struct {
+	gchar		*url;
+	gchar		*filename;
+	gchar		*filename_part;
+	gchar		*filename_validator;
+	gchar		*validator;	/* (nullable): ETag or Last-Modified */
+	goffset		 offset;	/* of existing partial download */
+	SoupMessage	*msg;		/* (nullable) */
+} FwupdClientDownloadFileData;
+
+static void
+fwupd_client_download_file_data_free (FwupdClientDownloadFileData *data)
+{
+	g_free (data->url);
+	g_free (data->filename);
+	g_free (data->filename_part);
+	g_free (data->filename_validator);
+	g_free (data->validator);
+	if (data->msg != NULL)
+		g_object_unref (data->msg);
+	g_free (data);
+}
+
+static void fwupd_client_download_file_send (GTask *task);
+
+/* the partial download cannot be used, so download the whole file */
+static void
+fwupd_client_download_file_restart (GTask *task)
+{
+	FwupdClientDownloadFileData *data = g_task_get_task_data (task);
+	g_debug ("cannot resume %s, restarting", data->url);
+	g_unlink (data->filename_part);
+	g_unlink (data->filename_validator);
+	g_clear_pointer (&data->validator, g_free);
+	data->offset = 0;
+	fwupd_client_download_file_send (task);
+}
+
+/* the partial download can only be resumed if the remote file is unchanged */
+static gboolean
+fwupd_client_download_file_save_validator (FwupdClientDownloadFileData *data, GError **error)
+{
+	const gchar *validator;
+
+	validator = soup_message_headers_get_one (data->msg->response_headers, "ETag");
+	if (validator == NULL)
+		validator = soup_message_headers_get_one (data->msg->response_headers, "Last-Modified");
+	if (validator == NULL) {
+		g_unlink (data->filename_validator);
+		return TRUE;
+	}
+	return g_file_set_contents (data->filename_validator, validator, -1, error);
+}
+
+static void
+fwupd_client_download_file_splice_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientDownloadFileData *data = g_task_get_task_data (task);
+	g_autoptr(GError) error = NULL;
+
+	/* the partial file is kept so that the download can be resumed */
+	if (g_output_stream_splice_finish (G_OUTPUT_STREAM (source), res, &error) < 0) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* only visible once complete */
+	g_unlink (data->filename_validator);
+	if (g_rename (data->filename_part, data->filename) != 0) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_WRITE,
+					 "failed to rename %s: %s",
+					 data->filename_part,
+					 g_strerror (errno));
+		return;
+	}
+
+	/* success */
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fwupd_client_download_file_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = g_task_get_source_object (task);
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	FwupdClientDownloadFileData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	guint status_code = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (data->filename_part);
+	g_autoptr(GFileOutputStream) ostr = NULL;
+	g_autoptr(GInputStream) istr = NULL;
+
+	/* get the result */
+	fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
+	istr = soup_session_send_finish (priv->soup_session, res, &error);
+	if (istr == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	g_object_get (data->msg, "status-code", &status_code, NULL);
+	g_debug ("status-code was %u", status_code);
+
+	/* the partial file is bigger than the remote file, so start again */
+	if (status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE && data->offset > 0) {
+		fwupd_client_download_file_restart (g_steal_pointer (&task));
+		return;
+	}
+	if (status_code == 429) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "Failed to download due to server limit");
+		return;
+	}
+
+	/* append to the existing data if the range starts where it ends, or
+	 * start again if the server ignored the range request or the remote
+	 * file has changed, which is handled using If-Range */
+	if (status_code == SOUP_STATUS_PARTIAL_CONTENT && data->offset > 0) {
+		goffset start = 0;
+		goffset end = 0;
+		goffset total_length = 0;
+		if (!soup_message_headers_get_content_range (data->msg->response_headers,
+							     &start, &end, &total_length) ||
+		    start != data->offset) {
+			g_debug ("range for %s started at %" G_GOFFSET_FORMAT
+				 " not %" G_GOFFSET_FORMAT,
+				 data->url, start, data->offset);
+			fwupd_client_download_file_restart (g_steal_pointer (&task));
+			return;
+		}
+		g_debug ("resuming %s from %" G_GOFFSET_FORMAT, data->url, data->offset);
+		ostr = g_file_append_to (file, G_FILE_CREATE_NONE, cancellable, &error);
+	} else if (status_code == SOUP_STATUS_OK) {
+		ostr = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE,
+				       cancellable, &error);
+	} else {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "Failed to download: %s",
+					 soup_status_get_phrase (status_code));
+		return;
+	}
+	if (ostr == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	if (!fwupd_client_download_file_save_validator (data, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* write directly to disk rather than to memory */
+	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
+	g_output_stream_splice_async (G_OUTPUT_STREAM (ostr), istr,
+				      G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+				      G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				      G_PRIORITY_DEFAULT, cancellable,
+				      fwupd_client_download_file_splice_cb,
+				      g_steal_pointer (&task));
+}
+
+static void
+fwupd_client_download_file_send (GTask *task)
+{
+	FwupdClient *self = g_task_get_source_object (task);
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	FwupdClientDownloadFileData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	g_autoptr(SoupMessage) msg = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+
+	uri = soup_uri_new (data->url);
+	if (uri == NULL) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "Failed to parse URI %s", data->url);
+		g_object_unref (task);
+		return;
+	}
+	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
+	if (data->offset > 0 && data->validator != NULL) {
+		soup_message_headers_set_range (msg->request_headers, data->offset, -1);
+		soup_message_headers_replace (msg->request_headers, "If-Range", data->validator);
+	}
+	g_signal_connect (msg, "got-chunk",
+			  G_CALLBACK (fwupd_client_download_chunk_cb),
+			  self);
+	g_set_object (&data->msg, msg);
+	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
+	soup_session_send_async (priv->soup_session, msg,
+				 cancellable,
+				 fwupd_client_download_file_cb,
+				 task);
+}
+
+/**
+ * fwupd_client_download_file_async:
+ * @self: A #FwupdClient
+ * @url: the remote URL
+ * @filename: the local filename to save to
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Downloads data from a remote server directly to a file, without holding the
+ * data in memory.
+ *
+ * The data is written to a `.part` file in the same directory, named using a
+ * hash of @url, and renamed to @filename when complete. If a partial download
+ * of the same URL already exists then it is resumed using a HTTP range request
+ * with `If-Range` set to the `ETag` or `Last-Modified` value saved alongside
+ * it. The whole file is downloaded if the server does not support this, if the
+ * remote file has changed, or if the returned range does not start where the
+ * partial download ends.
+ *
+ * The fwupd_client_set_user_agent() function should be called before this
+ * method is used.
+ *
+ * Since: 1.5.3
+ **/
+void
+fwupd_client_download_file_async (FwupdClient *self,
+				  const gchar *url,
+				  const gchar *filename,
+				  GCancellable *cancellable,
+				  GAsyncReadyCallback callback,
+				  gpointer callback_data)
+{
+	FwupdClientDownloadFileData *data;
+	GStatBuf st;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *url_hash = NULL;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GError) error = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+	g_return_if_fail (url != NULL);
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* ensure networking set up */
+	task = g_task_new (self, cancellable, callback, callback_data);
+	if (!fwupd_client_ensure_networking (self, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* ensure the destination exists */
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) == -1) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_WRITE,
+					 "failed to create %s: %s",
+					 dirname, g_strerror (errno));
+		return;
+	}
+
+	/* resume any partial download of the same URL */
+	data = g_new0 (FwupdClientDownloadFileData, 1);
+	data->url = g_strdup (url);
+	data->filename = g_strdup (filename);
+	url_hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
+	basename = g_strdup_printf ("%s.part", url_hash);
+	data->filename_part = g_build_filename (dirname, basename, NULL);
+	data->filename_validator = g_strdup_printf ("%s.validator", data->filename_part);
+	if (g_stat (data->filename_part, &st) == 0 &&
+	    g_file_get_contents (data->filename_validator, &data->validator, NULL, NULL))
+		data->offset = st.st_size;
+	g_task_set_task_data (task, data, (GDestroyNotify) fwupd_client_download_file_data_free);
+
+	/* download data */
+	g_debug ("downloading %s to %s", url, filename);
+	fwupd_client_download_file_send (g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_download_file_finish:
+ * @self: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_download_file_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fwupd_client_download_file_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK(res), error);
+}
+
 static void
 fwupd_client_upload_bytes_cb (GObject *source,
 			      GAsyncResult *res,
@@ -4482,6 +5021,10 @@ fwupd_client_class_init (FwupdClientClass *klass)
 static void
 fwupd_client_init (FwupdClient *self)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	priv->devices_delta = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, (GDestroyNotify) g_object_unref);
+	priv->signal_ids = g_array_new (FALSE, FALSE, sizeof(guint));
 }
 
 static void
@@ -4495,12 +5038,16 @@ fwupd_client_finalize (GObject *object)
 	g_free (priv->host_product);
 	g_free (priv->host_machine_id);
 	g_free (priv->host_security_id);
-	if (priv->conn != NULL)
+	if (priv->conn != NULL) {
+		fwupd_client_signals_unsubscribe (self);
 		g_object_unref (priv->conn);
+	}
 	if (priv->proxy != NULL)
 		g_object_unref (priv->proxy);
 	if (priv->soup_session != NULL)
 		g_object_unref (priv->soup_session);
+	g_hash_table_unref (priv->devices_delta);
+	g_array_unref (priv->signal_ids);
 
 	G_OBJECT_CLASS (fwupd_client_parent_class)->finalize (object);
 }
@@ -369,6 +369,15 @@ void		 fwupd_client_download_bytes_async	(FwupdClient	*self,
 GBytes		*fwupd_client_download_bytes_finish	(FwupdClient	*self,
 							 GAsyncResult	*res,
 							 GError		**error);
+void		 fwupd_client_download_file_async	(FwupdClient	*self,
+							 const gchar	*url,
+							 const gchar	*filename,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_download_file_finish	(FwupdClient	*self,
+							 GAsyncResult	*res,
+							 GError		**error);
 void		 fwupd_client_upload_bytes_async	(FwupdClient	*self,
 							 const gchar	*url,
 							 const gchar	*payload,
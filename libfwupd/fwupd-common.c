@@ -696,6 +696,29 @@ g_ascii_string_to_unsigned (const gchar *str,
 }
 #endif /* GLIB_CHECK_VERSION(2,54,0) */
 
+/* parses the canonical 8-4-4-4-12 format as big endian without allocating */
+static gboolean
+fwupd_guid_from_string_canonical (const gchar *guidstr, fwupd_guid_t *guid)
+{
+	guint j = 0;
+	for (guint i = 0; i < 36; i++) {
+		gint hi, lo;
+		if (i == 8 || i == 13 || i == 18 || i == 23) {
+			if (guidstr[i] != '-')
+				return FALSE;
+			continue;
+		}
+		hi = g_ascii_xdigit_value (guidstr[i]);
+		if (hi < 0)
+			return FALSE;
+		lo = g_ascii_xdigit_value (guidstr[++i]);
+		if (lo < 0)
+			return FALSE;
+		(*guid)[j++] = (guint8) ((hi << 4) | lo);
+	}
+	return TRUE;
+}
+
 /**
  * fwupd_guid_from_string:
  * @guidstr: (nullable): a GUID, e.g. `00112233-4455-6677-8899-aabbccddeeff`
@@ -731,6 +754,18 @@ fwupd_guid_from_string (const gchar *guidstr,
 				     "is not valid format");
 		return FALSE;
 	}
+
+	/* the common case, which does not need to be split */
+	if (fwupd_guid_from_string_canonical (guidstr, (fwupd_guid_t *) &gu)) {
+		if (mixed_endian) {
+			gu.a = GUINT32_SWAP_LE_BE (gu.a);
+			gu.b = GUINT16_SWAP_LE_BE (gu.b);
+			gu.c = GUINT16_SWAP_LE_BE (gu.c);
+		}
+		if (guid != NULL)
+			memcpy (guid, &gu, sizeof(gu));
+		return TRUE;
+	}
 	split = g_strsplit (guidstr, "-", 5);
 	if (g_strv_length (split) != 5) {
 		g_set_error_literal (error,
@@ -16,6 +16,14 @@ G_BEGIN_DECLS
 GVariant	*fwupd_device_to_variant		(FwupdDevice	*device);
 GVariant	*fwupd_device_to_variant_full		(FwupdDevice	*device,
 							 FwupdDeviceFlags flags);
+GVariant	*fwupd_device_to_variant_cached		(FwupdDevice	*device,
+							 FwupdDeviceFlags flags);
+GVariant	*fwupd_device_variant_delta		(GVariant	*val_old,
+							 GVariant	*val);
+GVariant	*fwupd_device_variant_apply_delta	(GVariant	*val_old,
+							 GVariant	*delta);
+void		 fwupd_device_reset_from_variant	(FwupdDevice	*device,
+							 GVariant	*value);
 void		 fwupd_device_incorporate		(FwupdDevice	*self,
 							 FwupdDevice	*donor);
 void		 fwupd_device_to_json			(FwupdDevice *device,
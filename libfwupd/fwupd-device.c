@@ -27,6 +27,13 @@
 
 static void fwupd_device_finalize	 (GObject *object);
 
+typedef struct {
+	GVariant			*value;
+	guint				 generation;
+	guint				 guids_len;
+	guint				 instance_ids_len;
+} FwupdDeviceVariantCache;
+
 typedef struct {
 	gchar				*id;
 	gchar				*parent_id;
@@ -34,6 +41,11 @@ typedef struct {
 	guint64				 modified;
 	guint64				 flags;
 	GPtrArray			*guids;
+	fwupd_guid_t			*guid_set;	/* open addressing, nullable */
+	guint				 guid_set_mask;
+	guint				 guid_set_len;
+	gboolean			 guid_set_has_nil;
+	guint				 guid_set_synced;	/* of guids->len */
 	GPtrArray			*instance_ids;
 	GPtrArray			*icons;
 	gchar				*name;
@@ -64,6 +76,9 @@ typedef struct {
 	FwupdStatus			 status;
 	GPtrArray			*releases;
 	FwupdDevice			*parent;	/* noref */
+	guint				 generation;	/* atomic, bumped by each setter */
+	FwupdDeviceVariantCache		 variant_cache[2];	/* untrusted, trusted */
+	GMutex				 variant_cache_mutex;	/* for @variant_cache */
 } FwupdDevicePrivate;
 
 enum {
@@ -112,6 +127,7 @@ fwupd_device_add_checksum (FwupdDevice *device, const gchar *checksum)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_return_if_fail (checksum != NULL);
+	g_atomic_int_inc (&priv->generation);
 	for (guint i = 0; i < priv->checksums->len; i++) {
 		const gchar *checksum_tmp = g_ptr_array_index (priv->checksums, i);
 		if (g_strcmp0 (checksum_tmp, checksum) == 0)
@@ -170,6 +186,7 @@ fwupd_device_set_summary (FwupdDevice *device, const gchar *summary)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
 }
@@ -206,6 +223,7 @@ fwupd_device_set_branch (FwupdDevice *device, const gchar *branch)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->branch);
 	priv->branch = g_strdup (branch);
 }
@@ -242,6 +260,7 @@ fwupd_device_set_serial (FwupdDevice *device, const gchar *serial)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->serial);
 	priv->serial = g_strdup (serial);
 }
@@ -278,6 +297,7 @@ fwupd_device_set_id (FwupdDevice *device, const gchar *id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->id);
 	priv->id = g_strdup (id);
 }
@@ -314,6 +334,7 @@ fwupd_device_set_parent_id (FwupdDevice *device, const gchar *parent_id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->parent_id);
 	priv->parent_id = g_strdup (parent_id);
 }
@@ -403,6 +424,138 @@ fwupd_device_get_guids (FwupdDevice *device)
 	return priv->guids;
 }
 
+/* only lowercase GUIDs are added to the set, as the string comparison used
+ * for everything else would not match GUIDs of a different case */
+static gboolean
+fwupd_device_guid_set_parse (const gchar *guid, fwupd_guid_t *buf)
+{
+	guint j = 0;
+	if (guid == NULL)
+		return FALSE;
+	for (guint i = 0; i < 36; i++) {
+		guint8 val = 0;
+		if (i == 8 || i == 13 || i == 18 || i == 23) {
+			if (guid[i] != '-')
+				return FALSE;
+			continue;
+		}
+		for (guint k = 0; k < 2; k++, i++) {
+			gchar tmp = guid[i];
+			if (tmp >= '0' && tmp <= '9')
+				val = (guint8) ((val << 4) | (tmp - '0'));
+			else if (tmp >= 'a' && tmp <= 'f')
+				val = (guint8) ((val << 4) | (tmp - 'a' + 10));
+			else
+				return FALSE;
+		}
+		i--;
+		(*buf)[j++] = val;
+	}
+	return guid[36] == '\0';
+}
+
+static guint
+fwupd_device_guid_set_hash (const guint8 *buf)
+{
+	guint32 val1;
+	guint32 val2;
+
+	/* most GUIDs are generated from a SHA-1 hash and so are already random */
+	memcpy (&val1, buf, sizeof(val1));
+	memcpy (&val2, buf + 12, sizeof(val2));
+	return val1 ^ val2;
+}
+
+static gboolean
+fwupd_device_guid_set_is_nil (const guint8 *buf)
+{
+	for (guint i = 0; i < sizeof(fwupd_guid_t); i++) {
+		if (buf[i] != 0x0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fwupd_device_guid_set_contains (FwupdDevice *device, const guint8 *buf)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	guint idx;
+
+	if (fwupd_device_guid_set_is_nil (buf))
+		return priv->guid_set_has_nil;
+	if (priv->guid_set == NULL)
+		return FALSE;
+	idx = fwupd_device_guid_set_hash (buf) & priv->guid_set_mask;
+	while (!fwupd_device_guid_set_is_nil (priv->guid_set[idx])) {
+		if (memcmp (priv->guid_set[idx], buf, sizeof(fwupd_guid_t)) == 0)
+			return TRUE;
+		idx = (idx + 1) & priv->guid_set_mask;
+	}
+	return FALSE;
+}
+
+static void
+fwupd_device_guid_set_insert (fwupd_guid_t *guid_set, guint mask, const guint8 *buf)
+{
+	guint idx = fwupd_device_guid_set_hash (buf) & mask;
+	while (!fwupd_device_guid_set_is_nil (guid_set[idx]))
+		idx = (idx + 1) & mask;
+	memcpy (guid_set[idx], buf, sizeof(fwupd_guid_t));
+}
+
+static void
+fwupd_device_guid_set_add (FwupdDevice *device, const guint8 *buf)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+
+	/* the empty slots are all zeros */
+	if (fwupd_device_guid_set_is_nil (buf)) {
+		priv->guid_set_has_nil = TRUE;
+		return;
+	}
+
+	/* keep the set at most half full so probe sequences stay short */
+	if (priv->guid_set == NULL || (priv->guid_set_len + 1) * 2 > priv->guid_set_mask + 1) {
+		guint size = priv->guid_set == NULL ? 16 : (priv->guid_set_mask + 1) * 2;
+		fwupd_guid_t *guid_set = g_new0 (fwupd_guid_t, size);
+		for (guint i = 0; priv->guid_set != NULL && i <= priv->guid_set_mask; i++) {
+			if (fwupd_device_guid_set_is_nil (priv->guid_set[i]))
+				continue;
+			fwupd_device_guid_set_insert (guid_set, size - 1, priv->guid_set[i]);
+		}
+		g_free (priv->guid_set);
+		priv->guid_set = guid_set;
+		priv->guid_set_mask = size - 1;
+	}
+	fwupd_device_guid_set_insert (priv->guid_set, priv->guid_set_mask, buf);
+	priv->guid_set_len++;
+}
+
+/* callers are allowed to modify the array returned by fwupd_device_get_guids()
+ * directly, e.g. when rescanning, so rebuild the set if it is out of sync;
+ * this is only called when adding a GUID so that readers never modify the
+ * set and fwupd_device_has_guid() is safe to call concurrently */
+static void
+fwupd_device_guid_set_ensure (FwupdDevice *device)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+
+	if (priv->guid_set_synced == priv->guids->len)
+		return;
+	g_clear_pointer (&priv->guid_set, g_free);
+	priv->guid_set_mask = 0;
+	priv->guid_set_len = 0;
+	priv->guid_set_has_nil = FALSE;
+	for (guint i = 0; i < priv->guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (priv->guids, i);
+		fwupd_guid_t buf;
+		if (fwupd_device_guid_set_parse (guid, &buf))
+			fwupd_device_guid_set_add (device, buf);
+	}
+	priv->guid_set_synced = priv->guids->len;
+}
+
 /**
  * fwupd_device_has_guid:
  * @device: A #FwupdDevice
@@ -418,9 +571,16 @@ gboolean
 fwupd_device_has_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	fwupd_guid_t buf;
 
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), FALSE);
 
+	/* use the packed representation where possible, falling back to
+	 * the array if it was modified directly since the last add */
+	if (priv->guid_set_synced == priv->guids->len &&
+	    fwupd_device_guid_set_parse (guid, &buf))
+		return fwupd_device_guid_set_contains (device, buf);
+
 	for (guint i = 0; i < priv->guids->len; i++) {
 		const gchar *guid_tmp = g_ptr_array_index (priv->guids, i);
 		if (g_strcmp0 (guid, guid_tmp) == 0)
@@ -442,10 +602,16 @@ void
 fwupd_device_add_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	fwupd_guid_t buf;
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (fwupd_device_has_guid (device, guid))
 		return;
+	fwupd_device_guid_set_ensure (device);
 	g_ptr_array_add (priv->guids, g_strdup (guid));
+	if (fwupd_device_guid_set_parse (guid, &buf))
+		fwupd_device_guid_set_add (device, buf);
+	priv->guid_set_synced = priv->guids->len;
 }
 
 /**
@@ -526,6 +692,7 @@ fwupd_device_add_instance_id (FwupdDevice *device, const gchar *instance_id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (fwupd_device_has_instance_id (device, instance_id))
 		return;
 	g_ptr_array_add (priv->instance_ids, g_strdup (instance_id));
@@ -578,6 +745,7 @@ fwupd_device_add_icon (FwupdDevice *device, const gchar *icon)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (fwupd_device_has_icon (device, icon))
 		return;
 	g_ptr_array_add (priv->icons, g_strdup (icon));
@@ -615,6 +783,7 @@ fwupd_device_set_name (FwupdDevice *device, const gchar *name)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->name);
 	priv->name = g_strdup (name);
 }
@@ -651,6 +820,7 @@ fwupd_device_set_vendor (FwupdDevice *device, const gchar *vendor)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->vendor);
 	priv->vendor = g_strdup (vendor);
 }
@@ -687,6 +857,7 @@ fwupd_device_set_vendor_id (FwupdDevice *device, const gchar *vendor_id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->vendor_id);
 	priv->vendor_id = g_strdup (vendor_id);
 }
@@ -723,6 +894,7 @@ fwupd_device_set_description (FwupdDevice *device, const gchar *description)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->description);
 	priv->description = g_strdup (description);
 }
@@ -759,6 +931,7 @@ fwupd_device_set_version (FwupdDevice *device, const gchar *version)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->version);
 	priv->version = g_strdup (version);
 }
@@ -795,6 +968,7 @@ fwupd_device_set_version_lowest (FwupdDevice *device, const gchar *version_lowes
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->version_lowest);
 	priv->version_lowest = g_strdup (version_lowest);
 }
@@ -831,6 +1005,7 @@ fwupd_device_set_version_lowest_raw (FwupdDevice *device, guint64 version_lowest
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->version_lowest_raw = version_lowest_raw;
 }
 
@@ -866,6 +1041,7 @@ fwupd_device_set_version_bootloader (FwupdDevice *device, const gchar *version_b
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->version_bootloader);
 	priv->version_bootloader = g_strdup (version_bootloader);
 }
@@ -902,6 +1078,7 @@ fwupd_device_set_version_bootloader_raw (FwupdDevice *device, guint64 version_bo
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->version_bootloader_raw = version_bootloader_raw;
 }
 
@@ -937,6 +1114,7 @@ fwupd_device_set_flashes_left (FwupdDevice *device, guint32 flashes_left)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->flashes_left = flashes_left;
 }
 
@@ -972,6 +1150,7 @@ fwupd_device_set_install_duration (FwupdDevice *device, guint32 duration)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->install_duration = duration;
 }
 
@@ -1007,6 +1186,7 @@ fwupd_device_set_plugin (FwupdDevice *device, const gchar *plugin)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->plugin);
 	priv->plugin = g_strdup (plugin);
 }
@@ -1043,6 +1223,7 @@ fwupd_device_set_protocol (FwupdDevice *device, const gchar *protocol)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->protocol);
 	priv->protocol = g_strdup (protocol);
 }
@@ -1079,6 +1260,7 @@ fwupd_device_set_flags (FwupdDevice *device, guint64 flags)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (priv->flags == flags)
 		return;
 	priv->flags = flags;
@@ -1099,6 +1281,7 @@ fwupd_device_add_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (flag == 0)
 		return;
 	if ((priv->flags & flag) > 0)
@@ -1121,6 +1304,7 @@ fwupd_device_remove_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	if (flag == 0)
 		return;
 	if ((priv->flags & flag) == 0)
@@ -1180,6 +1364,7 @@ fwupd_device_set_created (FwupdDevice *device, guint64 created)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->created = created;
 }
 
@@ -1215,6 +1400,7 @@ fwupd_device_set_modified (FwupdDevice *device, guint64 modified)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->modified = modified;
 }
 
@@ -1538,6 +1724,143 @@ fwupd_device_to_variant (FwupdDevice *device)
 	return fwupd_device_to_variant_full (device, FWUPD_DEVICE_FLAG_NONE);
 }
 
+/**
+ * fwupd_device_to_variant_cached:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Serialize the device data, reusing the result of the last call if no
+ * properties have been set since then.
+ *
+ * This can be called from more than one thread, although as with
+ * fwupd_device_to_variant() the device must not be modified at the same time.
+ *
+ * Returns: (transfer full): the serialized data
+ *
+ * Since: 1.5.3
+ **/
+GVariant *
+fwupd_device_to_variant_cached (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	FwupdDeviceVariantCache *cache;
+	guint generation;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	/* the arrays can be cleared without using a setter, and the
+	 * releases have no way to tell the device they were changed */
+	locker = g_mutex_locker_new (&priv->variant_cache_mutex);
+	generation = (guint) g_atomic_int_get (&priv->generation);
+	cache = &priv->variant_cache[(flags & FWUPD_DEVICE_FLAG_TRUSTED) > 0 ? 1 : 0];
+	if (cache->value != NULL &&
+	    cache->generation == generation &&
+	    cache->guids_len == priv->guids->len &&
+	    cache->instance_ids_len == priv->instance_ids->len &&
+	    priv->releases->len == 0)
+		return g_variant_ref (cache->value);
+
+	/* a setter called during this bumps the generation again */
+	if (cache->value != NULL)
+		g_variant_unref (cache->value);
+	cache->value = g_variant_ref_sink (fwupd_device_to_variant_full (device, flags));
+	cache->generation = generation;
+	cache->guids_len = priv->guids->len;
+	cache->instance_ids_len = priv->instance_ids->len;
+	return g_variant_ref (cache->value);
+}
+
+/**
+ * fwupd_device_variant_delta:
+ * @val_old: the serialized device as sent previously
+ * @val: the serialized device as it is now
+ *
+ * Gets the properties that have been added, changed or removed, along with
+ * the device ID so that the device can be found by the receiver.
+ *
+ * Returns: (transfer floating): a #GVariant of type `(a{sv}as)`
+ *
+ * Since: 1.5.3
+ **/
+GVariant *
+fwupd_device_variant_delta (GVariant *val_old, GVariant *val)
+{
+	GVariantBuilder builder;
+	GVariantBuilder invalidated_builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+
+	g_return_val_if_fail (val_old != NULL, NULL);
+	g_return_val_if_fail (val != NULL, NULL);
+
+	/* added or changed */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_old = g_variant_lookup_value (val_old, key, NULL);
+		if (value_old == NULL ||
+		    !g_variant_equal (value, value_old) ||
+		    g_strcmp0 (key, FWUPD_RESULT_KEY_DEVICE_ID) == 0)
+			g_variant_builder_add (&builder, "{sv}", key, value);
+		g_variant_unref (value);
+	}
+
+	/* removed */
+	g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
+	g_variant_iter_init (&iter, val_old);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_new = g_variant_lookup_value (val, key, NULL);
+		if (value_new == NULL)
+			g_variant_builder_add (&invalidated_builder, "s", key);
+		g_variant_unref (value);
+	}
+	return g_variant_new ("(a{sv}as)", &builder, &invalidated_builder);
+}
+
+/**
+ * fwupd_device_variant_apply_delta:
+ * @val_old: the serialized device the delta is relative to
+ * @delta: a #GVariant of type `(a{sv}as)` from fwupd_device_variant_delta()
+ *
+ * Applies the changes from a delta to a serialized device.
+ *
+ * Returns: (transfer floating): a #GVariant of type `a{sv}`
+ *
+ * Since: 1.5.3
+ **/
+GVariant *
+fwupd_device_variant_apply_delta (GVariant *val_old, GVariant *delta)
+{
+	GVariant *value;
+	GVariantBuilder builder;
+	GVariantIter iter;
+	const gchar *key;
+	g_autofree const gchar **invalidated = NULL;
+	g_autoptr(GVariant) changed = NULL;
+
+	g_return_val_if_fail (val_old != NULL, NULL);
+	g_return_val_if_fail (delta != NULL, NULL);
+
+	g_variant_get (delta, "(@a{sv}^a&s)", &changed, &invalidated);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, val_old);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_new = g_variant_lookup_value (changed, key, NULL);
+		if (value_new == NULL &&
+		    !g_strv_contains ((const gchar * const *) invalidated, key))
+			g_variant_builder_add (&builder, "{sv}", key, value);
+		g_variant_unref (value);
+	}
+	g_variant_iter_init (&iter, changed);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_variant_builder_add (&builder, "{sv}", key, value);
+		g_variant_unref (value);
+	}
+	return g_variant_builder_end (&builder);
+}
+
 static void
 fwupd_device_from_key_value (FwupdDevice *device, const gchar *key, GVariant *value)
 {
@@ -1783,6 +2106,7 @@ fwupd_device_set_update_state (FwupdDevice *device, FwupdUpdateState update_stat
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->update_state = update_state;
 }
 
@@ -1818,6 +2142,7 @@ fwupd_device_set_version_format (FwupdDevice *device, FwupdVersionFormat version
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->version_format = version_format;
 }
 
@@ -1853,6 +2178,7 @@ fwupd_device_set_version_raw (FwupdDevice *device, guint64 version_raw)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	priv->version_raw = version_raw;
 }
 
@@ -1888,6 +2214,7 @@ fwupd_device_set_update_message (FwupdDevice *device, const gchar *update_messag
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->update_message);
 	priv->update_message = g_strdup (update_message);
 }
@@ -1924,6 +2251,7 @@ fwupd_device_set_update_image (FwupdDevice *device, const gchar *update_image)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->update_image);
 	priv->update_image = g_strdup (update_image);
 }
@@ -1960,6 +2288,7 @@ fwupd_device_set_update_error (FwupdDevice *device, const gchar *update_error)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_free (priv->update_error);
 	priv->update_error = g_strdup (update_error);
 }
@@ -2016,6 +2345,7 @@ fwupd_device_add_release (FwupdDevice *device, FwupdRelease *release)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_atomic_int_inc (&priv->generation);
 	g_ptr_array_add (priv->releases, g_object_ref (release));
 }
 /**
@@ -2050,6 +2380,7 @@ fwupd_device_set_status (FwupdDevice *self, FwupdStatus status)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	g_atomic_int_inc (&priv->generation);
 	if (priv->status == status)
 		return;
 	priv->status = status;
@@ -2421,6 +2752,7 @@ fwupd_device_init (FwupdDevice *device)
 	priv->checksums = g_ptr_array_new_with_free_func (g_free);
 	priv->children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_mutex_init (&priv->variant_cache_mutex);
 }
 
 static void
@@ -2449,6 +2781,12 @@ fwupd_device_finalize (GObject *object)
 	g_free (priv->version_lowest);
 	g_free (priv->version_bootloader);
 	g_ptr_array_unref (priv->guids);
+	g_free (priv->guid_set);
+	for (guint i = 0; i < G_N_ELEMENTS (priv->variant_cache); i++) {
+		if (priv->variant_cache[i].value != NULL)
+			g_variant_unref (priv->variant_cache[i].value);
+	}
+	g_mutex_clear (&priv->variant_cache_mutex);
 	g_ptr_array_unref (priv->instance_ids);
 	g_ptr_array_unref (priv->icons);
 	g_ptr_array_unref (priv->checksums);
@@ -2469,6 +2807,65 @@ fwupd_device_set_from_variant_iter (FwupdDevice *device, GVariantIter *iter)
 	}
 }
 
+/**
+ * fwupd_device_reset_from_variant:
+ * @device: A #FwupdDevice
+ * @value: (not nullable): the serialized data, as a `a{sv}`
+ *
+ * Replaces all the properties that are serialized by
+ * fwupd_device_to_variant_full(), so that anything not in @value is cleared
+ * rather than kept. The parent and children are not changed.
+ *
+ * Since: 1.5.3
+ **/
+void
+fwupd_device_reset_from_variant (FwupdDevice *device, GVariant *value)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	GVariantIter iter;
+
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+	g_return_if_fail (value != NULL);
+
+	g_atomic_int_inc (&priv->generation);
+	priv->created = 0;
+	priv->modified = 0;
+	priv->flags = 0;
+	priv->version_format = FWUPD_VERSION_FORMAT_UNKNOWN;
+	priv->version_raw = 0;
+	priv->version_lowest_raw = 0;
+	priv->version_bootloader_raw = 0;
+	priv->flashes_left = 0;
+	priv->install_duration = 0;
+	priv->update_state = FWUPD_UPDATE_STATE_UNKNOWN;
+	priv->status = FWUPD_STATUS_UNKNOWN;
+	g_clear_pointer (&priv->id, g_free);
+	g_clear_pointer (&priv->parent_id, g_free);
+	g_clear_pointer (&priv->name, g_free);
+	g_clear_pointer (&priv->serial, g_free);
+	g_clear_pointer (&priv->summary, g_free);
+	g_clear_pointer (&priv->branch, g_free);
+	g_clear_pointer (&priv->description, g_free);
+	g_clear_pointer (&priv->vendor, g_free);
+	g_clear_pointer (&priv->vendor_id, g_free);
+	g_clear_pointer (&priv->plugin, g_free);
+	g_clear_pointer (&priv->protocol, g_free);
+	g_clear_pointer (&priv->version, g_free);
+	g_clear_pointer (&priv->version_lowest, g_free);
+	g_clear_pointer (&priv->version_bootloader, g_free);
+	g_clear_pointer (&priv->update_error, g_free);
+	g_clear_pointer (&priv->update_message, g_free);
+	g_clear_pointer (&priv->update_image, g_free);
+	g_ptr_array_set_size (priv->guids, 0);
+	g_ptr_array_set_size (priv->instance_ids, 0);
+	g_ptr_array_set_size (priv->icons, 0);
+	g_ptr_array_set_size (priv->checksums, 0);
+	g_ptr_array_set_size (priv->releases, 0);
+
+	g_variant_iter_init (&iter, value);
+	fwupd_device_set_from_variant_iter (device, &iter);
+}
+
 /**
  * fwupd_device_from_variant:
  * @value: a #GVariant
@@ -469,10 +469,11 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 					     "Remotes directory not set");
 			return FALSE;
 		}
-		/* set cache to /var/lib... */
+		/* set cache to /var/lib..., keeping the compression format */
 		filename_cache = g_build_filename (priv->remotes_dir,
 						   priv->id,
-						   "metadata.xml.gz",
+						   g_str_has_suffix (metadata_uri, ".zst") ?
+						   "metadata.xml.zst" : "metadata.xml.gz",
 						   NULL);
 		fwupd_remote_set_filename_cache (self, filename_cache);
 	}
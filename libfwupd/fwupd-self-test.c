@@ -7,6 +7,8 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
 #ifdef HAVE_FNMATCH_H
 #include <fnmatch.h>
 #endif
@@ -17,6 +19,7 @@
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-release-private.h"
 #include "fwupd-remote-private.h"
 
@@ -318,6 +321,7 @@ fwupd_device_func (void)
 	g_autofree gchar *data = NULL;
 	g_autofree gchar *str = NULL;
 	g_autoptr(FwupdDevice) dev = NULL;
+	g_autoptr(FwupdDevice) dev_many = fwupd_device_new ();
 	g_autoptr(FwupdRelease) rel = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GString) str_ascii = NULL;
@@ -355,6 +359,28 @@ fwupd_device_func (void)
 	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
 	g_assert (fwupd_device_has_guid (dev, "00000000-0000-0000-0000-000000000000"));
 	g_assert (!fwupd_device_has_guid (dev, "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx"));
+	g_assert (!fwupd_device_has_guid (dev, "2082B5E0-7A64-478A-B1B2-E3404FAB6DAD"));
+	g_assert (!fwupd_device_has_guid (dev, "1ff60ab2-3905-06a1-b476-0371f00c9e9b"));
+
+	/* check GUIDs with enough entries to grow the set */
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *guid = g_strdup_printf ("%08x-0000-0000-0000-000000000000", i + 1);
+		fwupd_device_add_guid (dev_many, guid);
+	}
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *guid = g_strdup_printf ("%08x-0000-0000-0000-000000000000", i + 1);
+		g_assert (fwupd_device_has_guid (dev_many, guid));
+	}
+	g_assert (!fwupd_device_has_guid (dev_many, "00000000-0000-0000-0000-000000000000"));
+	g_assert (!fwupd_device_has_guid (dev_many, "00000065-0000-0000-0000-000000000000"));
+	g_assert_cmpint (fwupd_device_get_guids (dev_many)->len, ==, 100);
+
+	/* check the set is not used after clearing the array directly */
+	g_ptr_array_set_size (fwupd_device_get_guids (dev_many), 0);
+	g_assert (!fwupd_device_has_guid (dev_many, "00000001-0000-0000-0000-000000000000"));
+	fwupd_device_add_guid (dev_many, "00000002-0000-0000-0000-000000000000");
+	g_assert (!fwupd_device_has_guid (dev_many, "00000001-0000-0000-0000-000000000000"));
+	g_assert (fwupd_device_has_guid (dev_many, "00000002-0000-0000-0000-000000000000"));
 
 	/* convert the new non-breaking space back into a normal space:
 	 * https://gitlab.gnome.org/GNOME/glib/commit/76af5dabb4a25956a6c41a75c0c7feeee74496da */
@@ -436,6 +462,105 @@ fwupd_device_func (void)
 	g_assert (ret);
 }
 
+static void
+fwupd_device_variant_cached_func (void)
+{
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+	g_autoptr(GVariant) val1 = NULL;
+	g_autoptr(GVariant) val2 = NULL;
+	g_autoptr(GVariant) val3 = NULL;
+	g_autoptr(GVariant) val4 = NULL;
+	g_autoptr(GVariant) val5 = NULL;
+	g_autoptr(GVariant) val6 = NULL;
+	g_autoptr(GVariant) val7 = NULL;
+	g_autoptr(GVariant) val_full = NULL;
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_name (dev, "ColorHug2");
+	fwupd_device_add_guid (dev, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+
+	/* unchanged, so the same variant */
+	val1 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	val2 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (val1 == val2);
+	val_full = g_variant_ref_sink (fwupd_device_to_variant (dev));
+	g_assert_true (g_variant_equal (val1, val_full));
+
+	/* trusted callers get a different variant */
+	val3 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_TRUSTED);
+	g_assert_true (val1 != val3);
+
+	/* set a property, the old variant is still valid for the caller */
+	fwupd_device_set_name (dev, "ColorHug3");
+	val4 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (g_variant_lookup (val4, "Name", "&s", NULL));
+	g_assert_false (g_variant_equal (val4, val_full));
+	g_assert_true (g_variant_equal (val1, val_full));
+
+	/* the array was cleared without using a setter */
+	g_ptr_array_set_size (fwupd_device_get_guids (dev), 0);
+	val5 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_false (g_variant_lookup (val5, "Guid", "^a&s", NULL));
+
+	/* enough GUIDs to grow the set, with cached variants for both */
+	for (guint i = 0; i < 32; i++) {
+		g_autofree gchar *guid = g_strdup_printf ("%08x-0000-0000-0000-000000000000", i + 1);
+		fwupd_device_add_guid (dev, guid);
+	}
+	val6 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_TRUSTED);
+	val7 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (g_variant_lookup (val6, "Guid", "^a&s", NULL));
+	g_assert_true (g_variant_lookup (val7, "Guid", "^a&s", NULL));
+}
+
+static void
+fwupd_device_variant_delta_func (void)
+{
+	const gchar *device_id = NULL;
+	g_autofree const gchar **invalidated = NULL;
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev2 = NULL;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) delta = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val2 = NULL;
+	g_autoptr(GVariant) val_old = NULL;
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_name (dev, "ColorHug2");
+	fwupd_device_set_summary (dev, "Colorimeter");
+	fwupd_device_set_version (dev, "1.2.3");
+	val_old = g_variant_ref_sink (fwupd_device_to_variant (dev));
+
+	/* change one property, add one and remove another */
+	fwupd_device_set_version (dev, "1.2.4");
+	fwupd_device_set_vendor (dev, "Hughski");
+	fwupd_device_set_summary (dev, NULL);
+	val = g_variant_ref_sink (fwupd_device_to_variant (dev));
+
+	/* only the differences, and the ID to find the device */
+	delta = g_variant_ref_sink (fwupd_device_variant_delta (val_old, val));
+	g_variant_get (delta, "(@a{sv}^a&s)", &changed, &invalidated);
+	g_assert_cmpint (g_variant_n_children (changed), ==, 3);
+	g_assert_true (g_variant_lookup (changed, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id));
+	g_assert_cmpstr (device_id, ==, "USB:foo");
+	g_assert_true (g_variant_lookup (changed, FWUPD_RESULT_KEY_VERSION, "&s", NULL));
+	g_assert_true (g_variant_lookup (changed, FWUPD_RESULT_KEY_VENDOR, "&s", NULL));
+	g_assert_false (g_variant_lookup (changed, FWUPD_RESULT_KEY_NAME, "&s", NULL));
+	g_assert_cmpint (g_strv_length ((gchar **) invalidated), ==, 1);
+	g_assert_cmpstr (invalidated[0], ==, FWUPD_RESULT_KEY_SUMMARY);
+
+	/* what the client does with the delta */
+	val2 = g_variant_ref_sink (fwupd_device_variant_apply_delta (val_old, delta));
+	dev2 = fwupd_device_from_variant (val2);
+	g_assert_nonnull (dev2);
+	g_assert_cmpstr (fwupd_device_get_id (dev2), ==, "USB:foo");
+	g_assert_cmpstr (fwupd_device_get_name (dev2), ==, "ColorHug2");
+	g_assert_cmpstr (fwupd_device_get_version (dev2), ==, "1.2.4");
+	g_assert_cmpstr (fwupd_device_get_vendor (dev2), ==, "Hughski");
+	g_assert_cmpstr (fwupd_device_get_summary (dev2), ==, NULL);
+}
+
 static void
 fwupd_client_devices_func (void)
 {
@@ -559,6 +684,142 @@ fwupd_has_system_bus (void)
 	return FALSE;
 }
 
+typedef struct {
+	GBytes		*blob;
+	goffset		 range_start;
+} FwupdDownloadHelper;
+
+static void
+fwupd_client_download_file_server_cb (SoupServer *server,
+				      SoupMessage *msg,
+				      const gchar *path,
+				      GHashTable *query,
+				      SoupClientContext *client,
+				      gpointer user_data)
+{
+	FwupdDownloadHelper *helper = (FwupdDownloadHelper *) user_data;
+	SoupRange *ranges = NULL;
+	gint nr_ranges = 0;
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (helper->blob, &bufsz);
+	const gchar *if_range;
+
+	/* only support a single range, and only if the file is unchanged */
+	soup_message_headers_replace (msg->response_headers, "ETag", "\"fwupd\"");
+	if_range = soup_message_headers_get_one (msg->request_headers, "If-Range");
+	if (g_strcmp0 (if_range, "\"fwupd\"") == 0 &&
+	    soup_message_headers_get_ranges (msg->request_headers, bufsz,
+					     &ranges, &nr_ranges)) {
+		helper->range_start = ranges[0].start;
+		soup_message_set_status (msg, SOUP_STATUS_PARTIAL_CONTENT);
+		soup_message_headers_set_content_range (msg->response_headers,
+							ranges[0].start,
+							ranges[0].end,
+							bufsz);
+		soup_message_set_response (msg, "application/octet-stream",
+					   SOUP_MEMORY_COPY,
+					   (const gchar *) buf + ranges[0].start,
+					   ranges[0].end - ranges[0].start + 1);
+		soup_message_headers_free_ranges (msg->request_headers, ranges);
+		return;
+	}
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/octet-stream",
+				   SOUP_MEMORY_COPY, (const gchar *) buf, bufsz);
+}
+
+static void
+fwupd_client_download_file_func (void)
+{
+	gboolean ret;
+	gsize bufsz = 0;
+	FwupdDownloadHelper helper = { NULL, 0 };
+	g_autofree gchar *basename_part = NULL;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_part = NULL;
+	g_autofree gchar *fn_validator = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *url_hash = NULL;
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(GByteArray) payload = g_byte_array_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSList) uris = NULL;
+	g_autoptr(SoupServer) server = NULL;
+
+	/* serve a payload that supports range requests */
+	for (guint i = 0; i < 0x10000; i++) {
+		guint8 tmp = i % 0xff;
+		g_byte_array_append (payload, &tmp, 1);
+	}
+	helper.blob = g_byte_array_free_to_bytes (g_steal_pointer (&payload));
+	server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (server, NULL,
+				 fwupd_client_download_file_server_cb,
+				 &helper, NULL);
+	ret = soup_server_listen_local (server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	uris = soup_server_get_uris (server);
+	g_assert_nonnull (uris);
+	url = soup_uri_to_string (uris->data, FALSE);
+	g_slist_free_full (g_steal_pointer (&uris), (GDestroyNotify) soup_uri_free);
+
+	/* simulate an interrupted transfer */
+	tmpdir = g_dir_make_tmp ("fwupd-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (tmpdir);
+	fn = g_build_filename (tmpdir, "firmware.bin", NULL);
+	url_hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
+	basename_part = g_strdup_printf ("%s.part", url_hash);
+	fn_part = g_build_filename (tmpdir, basename_part, NULL);
+	fn_validator = g_strdup_printf ("%s.validator", fn_part);
+	ret = g_file_set_contents (fn_part, g_bytes_get_data (helper.blob, NULL), 1000, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn_validator, "\"fwupd\"", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* resume */
+	fwupd_client_set_user_agent (client, "fwupd/" PACKAGE_VERSION);
+	ret = fwupd_client_download_file (client, url, fn, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (helper.range_start, ==, 1000);
+	g_assert_false (g_file_test (fn_part, G_FILE_TEST_EXISTS));
+	g_assert_false (g_file_test (fn_validator, G_FILE_TEST_EXISTS));
+	ret = g_file_get_contents (fn, &buf, &bufsz, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (bufsz, ==, g_bytes_get_size (helper.blob));
+	g_assert_true (memcmp (buf, g_bytes_get_data (helper.blob, NULL), bufsz) == 0);
+	g_clear_pointer (&buf, g_free);
+
+	/* the remote file has changed since the partial download */
+	helper.range_start = 0;
+	ret = g_file_set_contents (fn_part, "hello world", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn_validator, "\"old\"", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fwupd_client_download_file (client, url, fn, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (helper.range_start, ==, 0);
+	ret = g_file_get_contents (fn, &buf, &bufsz, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (bufsz, ==, g_bytes_get_size (helper.blob));
+	g_assert_true (memcmp (buf, g_bytes_get_data (helper.blob, NULL), bufsz) == 0);
+
+	g_unlink (fn);
+	g_rmdir (tmpdir);
+	g_bytes_unref (helper.blob);
+}
+
 static void
 fwupd_common_machine_hash_func (void)
 {
@@ -672,10 +933,13 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{guid}", fwupd_common_guid_func);
 	g_test_add_func ("/fwupd/release", fwupd_release_func);
 	g_test_add_func ("/fwupd/device", fwupd_device_func);
+	g_test_add_func ("/fwupd/device{variant-cached}", fwupd_device_variant_cached_func);
+	g_test_add_func ("/fwupd/device{variant-delta}", fwupd_device_variant_delta_func);
 	g_test_add_func ("/fwupd/remote{download}", fwupd_remote_download_func);
 	g_test_add_func ("/fwupd/remote{base-uri}", fwupd_remote_baseuri_func);
 	g_test_add_func ("/fwupd/remote{no-path}", fwupd_remote_nopath_func);
 	g_test_add_func ("/fwupd/remote{local}", fwupd_remote_local_func);
+	g_test_add_func ("/fwupd/client{download-file}", fwupd_client_download_file_func);
 	if (fwupd_has_system_bus ()) {
 		g_test_add_func ("/fwupd/client{remotes}", fwupd_client_remotes_func);
 		g_test_add_func ("/fwupd/client{devices}", fwupd_client_devices_func);
@@ -0,0 +1,13 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <libgcab.h>
+
+#include "fu-cabinet.h"
+
+GCabCabinet	*fu_cabinet_get_gcab_cabinet	(FuCabinet		*self);
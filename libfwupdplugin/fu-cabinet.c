@@ -11,7 +11,7 @@
 #include <gio/gio.h>
 #include <libgcab.h>
 
-#include "fu-cabinet.h"
+#include "fu-cabinet-private.h"
 #include "fu-common.h"
 
 #include "fwupd-enums.h"
@@ -116,6 +116,14 @@ fu_cabinet_get_silo (FuCabinet *self)
 	return g_object_ref (self->silo);
 }
 
+/* for the self tests */
+GCabCabinet *
+fu_cabinet_get_gcab_cabinet (FuCabinet *self)
+{
+	g_return_val_if_fail (FU_IS_CABINET (self), NULL);
+	return self->gcab_cabinet;
+}
+
 static GCabFile *
 fu_cabinet_get_file_by_name (FuCabinet *self, const gchar *basename)
 {
@@ -538,9 +546,18 @@ fu_cabinet_build_silo (FuCabinet *self, GBytes *data, GError **error)
 typedef struct {
 	FuCabinet	*self;
 	guint64		 size_total;
+	GHashTable	*basenames;	/* (nullable): payloads to decompress */
 	GError		*error;
 } FuCabinetDecompressHelper;
 
+/* the metadata is tiny, and is needed before we know what payloads to use */
+static gboolean
+fu_cabinet_is_metadata_basename (const gchar *basename)
+{
+	return g_str_has_suffix (basename, ".metainfo.xml") ||
+		g_str_has_suffix (basename, ".jcat");
+}
+
 static gboolean
 fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 {
@@ -553,6 +570,18 @@ fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 	if (helper->error != NULL)
 		return FALSE;
 
+	/* convert to UNIX paths */
+	name = g_strdup (gcab_file_get_name (file));
+	g_strdelimit (name, "\\", '/');
+
+	/* ignore the dirname completely */
+	basename = g_path_get_basename (name);
+	gcab_file_set_extract_name (file, basename);
+
+	/* the sizes were all checked when decompressing the metadata */
+	if (helper->basenames != NULL)
+		return g_hash_table_contains (helper->basenames, basename);
+
 	/* check the size of the compressed file */
 	if (gcab_file_get_size (file) > self->size_max) {
 		g_autofree gchar *sz_val = g_format_size (gcab_file_get_size (file));
@@ -578,26 +607,12 @@ fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 			     sz_val, sz_max);
 		return FALSE;
 	}
-
-	/* convert to UNIX paths */
-	name = g_strdup (gcab_file_get_name (file));
-	g_strdelimit (name, "\\", '/');
-
-	/* ignore the dirname completely */
-	basename = g_path_get_basename (name);
-	gcab_file_set_extract_name (file, basename);
-	return TRUE;
+	return fu_cabinet_is_metadata_basename (basename);
 }
 
 static gboolean
-fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
+fu_cabinet_load (FuCabinet *self, GBytes *data, GError **error)
 {
-	FuCabinetDecompressHelper helper = {
-		.self		= self,
-		.size_total	= 0,
-		.error		= NULL,
-	};
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GInputStream) istream = NULL;
 
 	/* load from a seekable stream */
@@ -617,10 +632,30 @@ fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
 		return FALSE;
 	}
 
-	/* decompress the file to memory */
+	/* success */
+	return TRUE;
+}
+
+/* only the metadata is decompressed if @basenames is %NULL */
+static gboolean
+fu_cabinet_decompress (FuCabinet *self, GHashTable *basenames, GError **error)
+{
+	FuCabinetDecompressHelper helper = {
+		.self		= self,
+		.size_total	= 0,
+		.basenames	= basenames,
+		.error		= NULL,
+	};
+	g_autoptr(GError) error_local = NULL;
+
+	/* decompress the files to memory */
 	if (!gcab_cabinet_extract_simple (self->gcab_cabinet, NULL,
 					  fu_cabinet_decompress_file_cb, &helper,
 					  NULL, &error_local)) {
+		if (helper.error != NULL) {
+			g_propagate_error (error, helper.error);
+			return FALSE;
+		}
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
@@ -638,6 +673,24 @@ fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
 	return TRUE;
 }
 
+/* the payload and legacy detached signature used by each release */
+static void
+fu_cabinet_add_release_basenames (XbNode *release, GHashTable *basenames)
+{
+	const gchar *csum_filename = NULL;
+	g_autofree gchar *basename = NULL;
+	g_autoptr(XbNode) csum_tmp = NULL;
+
+	csum_tmp = xb_node_query_first (release, "checksum[@target='content']", NULL);
+	if (csum_tmp != NULL)
+		csum_filename = xb_node_get_attr (csum_tmp, "filename");
+	if (csum_filename == NULL)
+		csum_filename = "firmware.bin";
+	basename = g_path_get_basename (csum_filename);
+	g_hash_table_add (basenames, g_strdup_printf ("%s.asc", basename));
+	g_hash_table_add (basenames, g_steal_pointer (&basename));
+}
+
 /**
  * fu_cabinet_parse:
  * @self: A #FuCabinet
@@ -658,7 +711,9 @@ fu_cabinet_parse (FuCabinet *self,
 		  GError **error)
 {
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GHashTable) basenames = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GPtrArray) releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	g_autoptr(XbQuery) query = NULL;
 
 	g_return_val_if_fail (FU_IS_CABINET (self), FALSE);
@@ -666,8 +721,10 @@ fu_cabinet_parse (FuCabinet *self,
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 	g_return_val_if_fail (self->silo == NULL, FALSE);
 
-	/* decompress */
-	if (!fu_cabinet_decompress (self, data, error))
+	/* decompress just the metadata */
+	if (!fu_cabinet_load (self, data, error))
+		return FALSE;
+	if (!fu_cabinet_decompress (self, NULL, error))
 		return FALSE;
 
 	/* build xmlb silo */
@@ -698,12 +755,12 @@ fu_cabinet_parse (FuCabinet *self,
 	if (query == NULL)
 		return FALSE;
 
-	/* process each listed release */
+	/* get each listed release */
 	for (guint i = 0; i < components->len; i++) {
 		XbNode *component = g_ptr_array_index (components, i);
-		g_autoptr(GPtrArray) releases = NULL;
-		releases = xb_node_query_full (component, query, &error_local);
-		if (releases == NULL) {
+		g_autoptr(GPtrArray) releases_tmp = NULL;
+		releases_tmp = xb_node_query_full (component, query, &error_local);
+		if (releases_tmp == NULL) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
@@ -711,14 +768,25 @@ fu_cabinet_parse (FuCabinet *self,
 				     error_local->message);
 			return FALSE;
 		}
-		for (guint j = 0; j < releases->len; j++) {
-			XbNode *rel = g_ptr_array_index (releases, j);
-			g_debug ("processing release: %s", xb_node_get_attr (rel, "version"));
-			if (!fu_cabinet_parse_release (self, rel, error))
-				return FALSE;
+		for (guint j = 0; j < releases_tmp->len; j++) {
+			XbNode *rel = g_ptr_array_index (releases_tmp, j);
+			fu_cabinet_add_release_basenames (rel, basenames);
+			g_ptr_array_add (releases, g_object_ref (rel));
 		}
 	}
 
+	/* only decompress the payloads that are actually used */
+	if (!fu_cabinet_decompress (self, basenames, error))
+		return FALSE;
+
+	/* process each listed release */
+	for (guint i = 0; i < releases->len; i++) {
+		XbNode *rel = g_ptr_array_index (releases, i);
+		g_debug ("processing release: %s", xb_node_get_attr (rel, "version"));
+		if (!fu_cabinet_parse_release (self, rel, error))
+			return FALSE;
+	}
+
 	/* success */
 	return TRUE;
 }
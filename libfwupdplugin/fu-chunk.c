@@ -212,3 +212,211 @@ fu_chunk_array_new_from_bytes (GBytes *blob,
 	return fu_chunk_array_new (data, (guint32) sz,
 				   addr_start, page_sz, packet_sz);
 }
+
+/**
+ * fu_chunk_array_new_diff: (skip):
+ * @data_old: the existing contents of the hardware, or %NULL
+ * @data_old_sz: size of @data_old
+ * @data: a linear blob of memory
+ * @data_sz: size of @data_sz
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Chunks a linear blob of memory in the same way as fu_chunk_array_new() but
+ * only returns the chunks that differ from @data_old at the same offset.
+ *
+ * If @page_sz is set to the erase block size then the returned chunks are the
+ * minimal set of blocks that have to be erased and rewritten. Any data past
+ * the end of @data_old is treated as changed.
+ *
+ * Return value: (transfer container) (element-type FuChunk): array of packets
+ *
+ * Since: 1.5.3
+ **/
+GPtrArray *
+fu_chunk_array_new_diff (const guint8 *data_old,
+			 guint32 data_old_sz,
+			 const guint8 *data,
+			 guint32 data_sz,
+			 guint32 addr_start,
+			 guint32 page_sz,
+			 guint32 packet_sz)
+{
+	FuChunk chk;
+	FuChunkIter iter;
+	GPtrArray *segments;
+
+	g_return_val_if_fail (data != NULL, NULL);
+
+	segments = g_ptr_array_new_with_free_func (g_free);
+	fu_chunk_iter_init (&iter, data, data_sz, addr_start, page_sz, packet_sz);
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		guint32 offset = (guint32) (chk.data - data);
+		if (data_old != NULL &&
+		    offset + chk.data_sz <= data_old_sz &&
+		    memcmp (data_old + offset, chk.data, chk.data_sz) == 0)
+			continue;
+		g_ptr_array_add (segments,
+				 fu_chunk_new (chk.idx,
+					       chk.page,
+					       chk.address,
+					       chk.data,
+					       chk.data_sz));
+	}
+	return segments;
+}
+
+/**
+ * fu_chunk_iter_init: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @data: a linear blob of memory, or %NULL
+ * @data_sz: size of @data_sz
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that chunks a linear blob of memory into packets,
+ * ensuring each packet does not cross a page boundary and is less that a
+ * specific transfer size.
+ *
+ * Unlike fu_chunk_array_new() no memory is allocated, and each chunk is
+ * only calculated when required using fu_chunk_iter_next().
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_chunk_iter_init (FuChunkIter *iter,
+		    const guint8 *data,
+		    guint32 data_sz,
+		    guint32 addr_start,
+		    guint32 page_sz,
+		    guint32 packet_sz)
+{
+	g_return_if_fail (iter != NULL);
+	iter->data = data;
+	iter->data_sz = data_sz;
+	iter->addr_start = addr_start;
+	iter->page_sz = page_sz;
+	iter->packet_sz = packet_sz;
+	iter->offset = 0;
+	iter->idx = 0;
+}
+
+/**
+ * fu_chunk_iter_init_from_bytes: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @blob: a #GBytes
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that chunks @blob into packets. The caller must
+ * keep @blob alive while the iterator and chunks are in use.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_chunk_iter_init_from_bytes (FuChunkIter *iter,
+			       GBytes *blob,
+			       guint32 addr_start,
+			       guint32 page_sz,
+			       guint32 packet_sz)
+{
+	gsize sz;
+	const guint8 *data = g_bytes_get_data (blob, &sz);
+	fu_chunk_iter_init (iter, data, (guint32) sz, addr_start, page_sz, packet_sz);
+}
+
+/**
+ * fu_chunk_iter_next: (skip):
+ * @iter: a #FuChunkIter
+ * @chk: (out caller-allocates): a #FuChunk
+ *
+ * Gets the next chunk, which points into the data passed to
+ * fu_chunk_iter_init().
+ *
+ * Returns: %FALSE if there are no more chunks
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_chunk_iter_next (FuChunkIter *iter, FuChunk *chk)
+{
+	guint32 address;
+	guint32 data_sz;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (chk != NULL, FALSE);
+
+	/* done */
+	if (iter->offset >= iter->data_sz)
+		return FALSE;
+	address = iter->addr_start + iter->offset;
+	data_sz = iter->data_sz - iter->offset;
+
+	/* limit to the packet size and to the end of the page */
+	if (iter->packet_sz > 0)
+		data_sz = MIN (data_sz, iter->packet_sz);
+	chk->idx = iter->idx;
+	if (iter->page_sz > 0) {
+		data_sz = MIN (data_sz, iter->page_sz - (address % iter->page_sz));
+		chk->page = address / iter->page_sz;
+		chk->address = address % iter->page_sz;
+	} else {
+		chk->page = 0;
+		chk->address = address;
+	}
+	chk->data = iter->data != NULL ? iter->data + iter->offset : NULL;
+	chk->data_sz = data_sz;
+
+	/* next */
+	iter->offset += data_sz;
+	iter->idx++;
+	return TRUE;
+}
+
+static guint32
+fu_chunk_iter_count_packets (guint32 data_sz, guint32 packet_sz)
+{
+	if (data_sz == 0)
+		return 0;
+	if (packet_sz == 0)
+		return 1;
+	return (data_sz / packet_sz) + (data_sz % packet_sz > 0 ? 1 : 0);
+}
+
+/**
+ * fu_chunk_iter_get_count:
+ * @iter: a #FuChunkIter
+ *
+ * Gets the total number of chunks, which is typically used to show progress.
+ * This does not depend on how many chunks have already been returned.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.3
+ **/
+guint32
+fu_chunk_iter_get_count (FuChunkIter *iter)
+{
+	guint32 cnt;
+	guint32 first_sz;
+	guint32 remaining_sz;
+
+	g_return_val_if_fail (iter != NULL, 0);
+
+	/* no pages */
+	if (iter->page_sz == 0)
+		return fu_chunk_iter_count_packets (iter->data_sz, iter->packet_sz);
+
+	/* partial first page, whole pages, then the partial last page */
+	first_sz = iter->page_sz - (iter->addr_start % iter->page_sz);
+	first_sz = MIN (first_sz, iter->data_sz);
+	cnt = fu_chunk_iter_count_packets (first_sz, iter->packet_sz);
+	remaining_sz = iter->data_sz - first_sz;
+	cnt += (remaining_sz / iter->page_sz) *
+		fu_chunk_iter_count_packets (iter->page_sz, iter->packet_sz);
+	cnt += fu_chunk_iter_count_packets (remaining_sz % iter->page_sz, iter->packet_sz);
+	return cnt;
+}
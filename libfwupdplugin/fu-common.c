@@ -2463,6 +2463,51 @@ fu_common_get_esp_for_path (const gchar *esp_path, GError **error)
 	return NULL;
 }
 
+/* all the CRC functions process eight bytes at a time using tables where
+ * table[k][i] is the effect of byte i followed by k zero bytes */
+static guint8 fu_common_crc8_table[8][256];
+static guint16 fu_common_crc16_table[8][256];
+static guint32 fu_common_crc32_table[8][256];
+
+static void
+fu_common_crc_ensure_tables (void)
+{
+	static gsize tables_init = 0;
+
+	if (!g_once_init_enter (&tables_init))
+		return;
+
+	/* bytewise, the same as the bit-at-a-time algorithms */
+	for (guint i = 0; i < 256; i++) {
+		guint8 crc8 = (guint8) i;
+		guint16 crc16 = (guint16) i;
+		guint32 crc32 = i;
+		for (guint bit = 0; bit < 8; bit++) {
+			crc8 = (crc8 & 0x80) ? (guint8) ((crc8 << 1) ^ 0x07) : (guint8) (crc8 << 1);
+			crc16 = (crc16 & 0x1) ? (guint16) ((crc16 >> 1) ^ 0xa001) : (guint16) (crc16 >> 1);
+			crc32 = (crc32 & 0x1) ? (crc32 >> 1) ^ 0xEDB88320 : crc32 >> 1;
+		}
+		fu_common_crc8_table[0][i] = crc8;
+		fu_common_crc16_table[0][i] = crc16;
+		fu_common_crc32_table[0][i] = crc32;
+	}
+
+	/* feed in the extra zero bytes */
+	for (guint k = 1; k < 8; k++) {
+		for (guint i = 0; i < 256; i++) {
+			guint8 crc8 = fu_common_crc8_table[k - 1][i];
+			guint16 crc16 = fu_common_crc16_table[k - 1][i];
+			guint32 crc32 = fu_common_crc32_table[k - 1][i];
+			fu_common_crc8_table[k][i] = fu_common_crc8_table[0][crc8];
+			fu_common_crc16_table[k][i] = (guint16) ((crc16 >> 8) ^
+								 fu_common_crc16_table[0][crc16 & 0xff]);
+			fu_common_crc32_table[k][i] = (crc32 >> 8) ^
+						      fu_common_crc32_table[0][crc32 & 0xff];
+		}
+	}
+	g_once_init_leave (&tables_init, 1);
+}
+
 /**
  * fu_common_crc8:
  * @buf: memory buffer
@@ -2477,16 +2522,21 @@ fu_common_get_esp_for_path (const gchar *esp_path, GError **error)
 guint8
 fu_common_crc8 (const guint8 *buf, gsize bufsz)
 {
-	guint32 crc = 0;
-	for (gsize j = bufsz; j > 0; j--) {
-		crc ^= (*(buf++) << 8);
-		for (guint32 i = 8; i; i--) {
-			if (crc & 0x8000)
-				crc ^= (0x1070 << 3);
-			crc <<= 1;
-		}
-	}
-	return ~((guint8) (crc >> 8));
+	guint8 crc = 0;
+	fu_common_crc_ensure_tables ();
+	for (; bufsz >= 8; bufsz -= 8, buf += 8) {
+		crc = (guint8) (fu_common_crc8_table[7][crc ^ buf[0]] ^
+				fu_common_crc8_table[6][buf[1]] ^
+				fu_common_crc8_table[5][buf[2]] ^
+				fu_common_crc8_table[4][buf[3]] ^
+				fu_common_crc8_table[3][buf[4]] ^
+				fu_common_crc8_table[2][buf[5]] ^
+				fu_common_crc8_table[1][buf[6]] ^
+				fu_common_crc8_table[0][buf[7]]);
+	}
+	for (; bufsz > 0; bufsz--)
+		crc = fu_common_crc8_table[0][crc ^ *(buf++)];
+	return ~crc;
 }
 
 /**
@@ -2504,16 +2554,20 @@ guint16
 fu_common_crc16 (const guint8 *buf, gsize bufsz)
 {
 	guint16 crc = 0xffff;
-	for (gsize len = bufsz; len > 0; len--) {
-		crc = (guint16) (crc ^ (*buf++));
-		for (guint8 i = 0; i < 8; i++) {
-			if (crc & 0x1) {
-				crc = (crc >> 1) ^ 0xa001;
-			} else {
-				crc >>= 1;
-			}
-		}
-	}
+	fu_common_crc_ensure_tables ();
+	for (; bufsz >= 8; bufsz -= 8, buf += 8) {
+		guint16 tmp = (guint16) (crc ^ (buf[0] | (buf[1] << 8)));
+		crc = (guint16) (fu_common_crc16_table[7][tmp & 0xff] ^
+				 fu_common_crc16_table[6][tmp >> 8] ^
+				 fu_common_crc16_table[5][buf[2]] ^
+				 fu_common_crc16_table[4][buf[3]] ^
+				 fu_common_crc16_table[3][buf[4]] ^
+				 fu_common_crc16_table[2][buf[5]] ^
+				 fu_common_crc16_table[1][buf[6]] ^
+				 fu_common_crc16_table[0][buf[7]]);
+	}
+	for (; bufsz > 0; bufsz--)
+		crc = (guint16) ((crc >> 8) ^ fu_common_crc16_table[0][(crc ^ *(buf++)) & 0xff]);
 	return ~crc;
 }
 
@@ -2533,14 +2587,36 @@ fu_common_crc16 (const guint8 *buf, gsize bufsz)
 guint32
 fu_common_crc32_full (const guint8 *buf, gsize bufsz, guint32 crc, guint32 polynomial)
 {
-	for (guint32 idx = 0; idx < bufsz; idx++) {
-		guint8 data = *buf++;
-		crc = crc ^ data;
-		for (guint32 bit = 0; bit < 8; bit++) {
-			guint32 mask = -(crc & 1);
-			crc = (crc >> 1) ^ (polynomial & mask);
+	/* only the default polynomial has tables */
+	if (polynomial != 0xEDB88320) {
+		for (guint32 idx = 0; idx < bufsz; idx++) {
+			guint8 data = *buf++;
+			crc = crc ^ data;
+			for (guint32 bit = 0; bit < 8; bit++) {
+				guint32 mask = -(crc & 1);
+				crc = (crc >> 1) ^ (polynomial & mask);
+			}
 		}
-	}
+		return ~crc;
+	}
+
+	fu_common_crc_ensure_tables ();
+	for (; bufsz >= 8; bufsz -= 8, buf += 8) {
+		guint32 tmp = crc ^ ((guint32) buf[0] |
+				     ((guint32) buf[1] << 8) |
+				     ((guint32) buf[2] << 16) |
+				     ((guint32) buf[3] << 24));
+		crc = fu_common_crc32_table[7][tmp & 0xff] ^
+		      fu_common_crc32_table[6][(tmp >> 8) & 0xff] ^
+		      fu_common_crc32_table[5][(tmp >> 16) & 0xff] ^
+		      fu_common_crc32_table[4][tmp >> 24] ^
+		      fu_common_crc32_table[3][buf[4]] ^
+		      fu_common_crc32_table[2][buf[5]] ^
+		      fu_common_crc32_table[1][buf[6]] ^
+		      fu_common_crc32_table[0][buf[7]];
+	}
+	for (; bufsz > 0; bufsz--)
+		crc = (crc >> 8) ^ fu_common_crc32_table[0][(crc ^ *(buf++)) & 0xff];
 	return ~crc;
 }
 
@@ -2560,3 +2636,112 @@ fu_common_crc32 (const guint8 *buf, gsize bufsz)
 {
 	return fu_common_crc32_full (buf, bufsz, 0xFFFFFFFF, 0xEDB88320);
 }
+
+/* small enough for each block to stay in the CPU cache for every digest */
+#define FU_COMMON_CHECKSUMS_BLOCK_SIZE		0x10000
+
+static GPtrArray *
+fu_common_checksums_for_data (const guint8 *buf,
+			      gsize bufsz,
+			      const GChecksumType *kinds,
+			      guint kinds_sz,
+			      GFileProgressCallback progress_cb,
+			      gpointer progress_data)
+{
+	GPtrArray *checksums = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GPtrArray) csums = g_ptr_array_new_with_free_func ((GDestroyNotify) g_checksum_free);
+
+	for (guint i = 0; i < kinds_sz; i++)
+		g_ptr_array_add (csums, g_checksum_new (kinds[i]));
+
+	/* update each digest a block at a time so the data is only read
+	 * from main memory once */
+	for (gsize offset = 0; offset < bufsz; offset += FU_COMMON_CHECKSUMS_BLOCK_SIZE) {
+		gsize blocksz = MIN (bufsz - offset, FU_COMMON_CHECKSUMS_BLOCK_SIZE);
+		for (guint i = 0; i < csums->len; i++) {
+			GChecksum *csum = g_ptr_array_index (csums, i);
+			g_checksum_update (csum, buf + offset, (gssize) blocksz);
+		}
+		if (progress_cb != NULL)
+			progress_cb ((goffset) (offset + blocksz), (goffset) bufsz, progress_data);
+	}
+	for (guint i = 0; i < csums->len; i++) {
+		GChecksum *csum = g_ptr_array_index (csums, i);
+		g_ptr_array_add (checksums, g_strdup (g_checksum_get_string (csum)));
+	}
+	return checksums;
+}
+
+/**
+ * fu_common_checksums_for_bytes:
+ * @blob: a #GBytes
+ * @kinds: an array of #GChecksumType, e.g. %G_CHECKSUM_SHA1
+ * @kinds_sz: number of elements in @kinds
+ * @progress_cb: (scope call) (nullable): a #GFileProgressCallback
+ * @progress_data: user data for @progress_cb
+ *
+ * Computes several checksums of the data in a single pass, which is faster
+ * than calling g_compute_checksum_for_bytes() for each kind.
+ *
+ * Returns: (transfer container) (element-type utf8): checksums in the same
+ * order as @kinds
+ *
+ * Since: 1.5.3
+ **/
+GPtrArray *
+fu_common_checksums_for_bytes (GBytes *blob,
+			       const GChecksumType *kinds,
+			       guint kinds_sz,
+			       GFileProgressCallback progress_cb,
+			       gpointer progress_data)
+{
+	gsize bufsz = 0;
+	const guint8 *buf;
+
+	g_return_val_if_fail (blob != NULL, NULL);
+	g_return_val_if_fail (kinds != NULL || kinds_sz == 0, NULL);
+
+	buf = g_bytes_get_data (blob, &bufsz);
+	return fu_common_checksums_for_data (buf, bufsz, kinds, kinds_sz,
+					     progress_cb, progress_data);
+}
+
+/**
+ * fu_common_checksums_for_filename:
+ * @filename: a filename
+ * @kinds: an array of #GChecksumType, e.g. %G_CHECKSUM_SHA1
+ * @kinds_sz: number of elements in @kinds
+ * @progress_cb: (scope call) (nullable): a #GFileProgressCallback
+ * @progress_data: user data for @progress_cb
+ * @error: A #GError or %NULL
+ *
+ * Computes several checksums of a file in a single pass. The file is mapped
+ * rather than loaded into memory.
+ *
+ * Returns: (transfer container) (element-type utf8): checksums in the same
+ * order as @kinds, or %NULL for error
+ *
+ * Since: 1.5.3
+ **/
+GPtrArray *
+fu_common_checksums_for_filename (const gchar *filename,
+				  const GChecksumType *kinds,
+				  guint kinds_sz,
+				  GFileProgressCallback progress_cb,
+				  gpointer progress_data,
+				  GError **error)
+{
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+	g_return_val_if_fail (kinds != NULL || kinds_sz == 0, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	if (mapped_file == NULL)
+		return NULL;
+	return fu_common_checksums_for_data ((const guint8 *) g_mapped_file_get_contents (mapped_file),
+					     g_mapped_file_get_length (mapped_file),
+					     kinds, kinds_sz,
+					     progress_cb, progress_data);
+}
@@ -256,3 +256,14 @@ guint32		 fu_common_crc32_full		(const guint8	*buf,
 						 gsize		 bufsz,
 						 guint32	 crc,
 						 guint32	 polynomial);
+GPtrArray	*fu_common_checksums_for_bytes	(GBytes		*blob,
+						 const GChecksumType *kinds,
+						 guint		 kinds_sz,
+						 GFileProgressCallback progress_cb,
+						 gpointer	 progress_data);
+GPtrArray	*fu_common_checksums_for_filename (const gchar	*filename,
+						 const GChecksumType *kinds,
+						 guint		 kinds_sz,
+						 GFileProgressCallback progress_cb,
+						 gpointer	 progress_data,
+						 GError		**error);
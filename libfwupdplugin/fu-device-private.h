@@ -9,6 +9,8 @@
 #include <fu-device.h>
 #include <xmlb.h>
 
+#include "fu-probe-cache.h"
+
 #define fu_device_set_plugin(d,v)		fwupd_device_set_plugin(FWUPD_DEVICE(d),v)
 
 GPtrArray	*fu_device_get_parent_guids		(FuDevice	*self);
@@ -30,3 +32,8 @@ gchar		*fu_device_get_guids_as_str		(FuDevice	*self);
 GPtrArray	*fu_device_get_possible_plugins		(FuDevice	*self);
 void		 fu_device_add_possible_plugin		(FuDevice	*self,
 							 const gchar	*plugin);
+void		 fu_device_set_probe_cache		(FuDevice	*self,
+							 FuProbeCache	*probe_cache);
+gboolean	 fu_device_get_setup_cached		(FuDevice	*self);
+gboolean	 fu_device_revalidate_setup		(FuDevice	*self,
+							 GError		**error);
@@ -14,11 +14,14 @@
 
 #include "fu-common.h"
 #include "fu-common-version.h"
+#include "fu-device-locker.h"
 #include "fu-device-private.h"
 #include "fu-mutex.h"
+#include "fu-probe-cache.h"
 
 #include "fwupd-common.h"
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 
 /**
  * SECTION:fu-device
@@ -51,6 +54,11 @@ typedef struct {
 	guint				 poll_id;
 	gboolean			 done_probe;
 	gboolean			 done_setup;
+	gboolean			 done_setup_cached;	/* from probe_cache */
+	gchar				*probe_cache_key;	/* (nullable): of the hit */
+	GVariant			*probe_cache_before;	/* (nullable): of the hit */
+	GVariant			*probe_cache_after;	/* (nullable): of the hit */
+	FuProbeCache			*probe_cache;	/* (nullable) */
 	gboolean			 device_id_valid;
 	guint64				 size_min;
 	guint64				 size_max;
@@ -74,12 +82,51 @@ enum {
 	PROP_LOGICAL_ID,
 	PROP_QUIRKS,
 	PROP_PROXY,
+	PROP_ID,
+	PROP_GUIDS,
+	PROP_EQUIVALENT_ID,
 	PROP_LAST
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuDevice, fu_device, FWUPD_TYPE_DEVICE)
 #define GET_PRIVATE(o) (fu_device_get_instance_private (o))
 
+/* the same instance IDs are converted many times when matching and adding
+ * devices, so remember the result rather than hashing again each time */
+#define FU_DEVICE_GUID_CACHE_SIZE_MAX		4096
+
+G_LOCK_DEFINE_STATIC (guid_cache);
+static GHashTable *guid_cache = NULL;	/* instance-id:guid */
+
+static gchar *
+fu_device_guid_hash_string (const gchar *instance_id)
+{
+	const gchar *guid;
+	gchar *guid_new;
+
+	G_LOCK (guid_cache);
+	if (guid_cache == NULL)
+		guid_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	guid = g_hash_table_lookup (guid_cache, instance_id);
+	if (guid != NULL) {
+		guid_new = g_strdup (guid);
+		G_UNLOCK (guid_cache);
+		return guid_new;
+	}
+	G_UNLOCK (guid_cache);
+
+	/* not known */
+	guid_new = fwupd_guid_hash_string (instance_id);
+	if (guid_new == NULL)
+		return NULL;
+	G_LOCK (guid_cache);
+	if (g_hash_table_size (guid_cache) >= FU_DEVICE_GUID_CACHE_SIZE_MAX)
+		g_hash_table_remove_all (guid_cache);
+	g_hash_table_insert (guid_cache, g_strdup (instance_id), g_strdup (guid_new));
+	G_UNLOCK (guid_cache);
+	return guid_new;
+}
+
 static void
 fu_device_get_property (GObject *object, guint prop_id,
 			GValue *value, GParamSpec *pspec)
@@ -102,6 +149,15 @@ fu_device_get_property (GObject *object, guint prop_id,
 	case PROP_PROXY:
 		g_value_set_object (value, priv->proxy);
 		break;
+	case PROP_ID:
+		g_value_set_string (value, fu_device_get_id (self));
+		break;
+	case PROP_GUIDS:
+		g_value_set_boxed (value, fu_device_get_guids (self));
+		break;
+	case PROP_EQUIVALENT_ID:
+		g_value_set_string (value, priv->equivalent_id);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -499,8 +555,11 @@ fu_device_set_equivalent_id (FuDevice *self, const gchar *equivalent_id)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FU_IS_DEVICE (self));
+	if (g_strcmp0 (equivalent_id, priv->equivalent_id) == 0)
+		return;
 	g_free (priv->equivalent_id);
 	priv->equivalent_id = g_strdup (equivalent_id);
+	g_object_notify (G_OBJECT (self), "equivalent-id");
 }
 
 /**
@@ -859,7 +918,7 @@ fu_device_add_parent_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
+		g_autofree gchar *tmp = fu_device_guid_hash_string (guid);
 		if (fu_device_has_parent_guid (self, tmp))
 			return;
 		g_debug ("using %s for %s", tmp, guid);
@@ -1200,12 +1259,22 @@ fu_device_get_firmware_size_max (FuDevice *self)
 	return priv->size_max;
 }
 
+/* the GUID must already be valid */
+static void
+fu_device_add_guid_notify (FuDevice *self, const gchar *guid)
+{
+	if (fwupd_device_has_guid (FWUPD_DEVICE (self), guid))
+		return;
+	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	g_object_notify (G_OBJECT (self), "guids");
+}
+
 static void
 fu_device_add_guid_safe (FuDevice *self, const gchar *guid)
 {
 	/* add the device GUID before adding additional GUIDs from quirks
 	 * to ensure the bootloader GUID is listed after the runtime GUID */
-	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	fu_device_add_guid_notify (self, guid);
 	fu_device_add_guid_quirks (self, guid);
 }
 
@@ -1228,7 +1297,7 @@ fu_device_has_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
+		g_autofree gchar *tmp = fu_device_guid_hash_string (guid);
 		return fwupd_device_has_guid (FWUPD_DEVICE (self), tmp);
 	}
 
@@ -1263,7 +1332,7 @@ fu_device_add_instance_id_full (FuDevice *self,
 	 * calling fu_device_add_guid_safe() -- but we want the quirks to match
 	 * so the plugin is set, but not the LVFS metadata to match firmware
 	 * until we're sure the device isn't using _NO_AUTO_INSTANCE_IDS */
-	guid = fwupd_guid_hash_string (instance_id);
+	guid = fu_device_guid_hash_string (instance_id);
 	fu_device_add_guid_quirks (self, guid);
 	if ((flags & FU_DEVICE_INSTANCE_FLAG_ONLY_QUIRKS) == 0)
 		fwupd_device_add_instance_id (FWUPD_DEVICE (self), instance_id);
@@ -1331,13 +1400,13 @@ fu_device_add_counterpart_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
-		fwupd_device_add_guid (FWUPD_DEVICE (self), tmp);
+		g_autofree gchar *tmp = fu_device_guid_hash_string (guid);
+		fu_device_add_guid_notify (self, tmp);
 		return;
 	}
 
 	/* already valid */
-	fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+	fu_device_add_guid_notify (self, guid);
 }
 
 /**
@@ -1620,6 +1689,7 @@ fu_device_set_id (FuDevice *self, const gchar *id)
 	}
 	fwupd_device_set_id (FWUPD_DEVICE (self), id_hash);
 	priv->device_id_valid = TRUE;
+	g_object_notify (G_OBJECT (self), "id");
 
 	/* ensure the parent ID is set */
 	children = fu_device_get_children (self);
@@ -2910,6 +2980,7 @@ fu_device_rescan (FuDevice *self, GError **error)
 	/* remove all GUIDs */
 	g_ptr_array_set_size (fu_device_get_instance_ids (self), 0);
 	g_ptr_array_set_size (fu_device_get_guids (self), 0);
+	g_object_notify (G_OBJECT (self), "guids");
 
 	/* subclassed */
 	if (klass->rescan != NULL) {
@@ -2948,8 +3019,8 @@ fu_device_convert_instance_ids (FuDevice *self)
 		return;
 	for (guint i = 0; i < instance_ids->len; i++) {
 		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
-		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
-		fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
+		g_autofree gchar *guid = fu_device_guid_hash_string (instance_id);
+		fu_device_add_guid_notify (self, guid);
 	}
 
 	/* convert all children too */
@@ -2960,6 +3031,253 @@ fu_device_convert_instance_ids (FuDevice *self)
 	}
 }
 
+/* only things that do not change between boots are used so that the saved
+ * state is not used for a different device at the same physical location;
+ * the instance IDs usually include the revision, and any version set in
+ * ->probe() is included so that a firmware update makes a new key */
+static gchar *
+fu_device_get_probe_cache_key (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GPtrArray *instance_ids = fu_device_get_instance_ids (self);
+	GString *str;
+
+	if (priv->physical_id == NULL || instance_ids->len == 0)
+		return NULL;
+	str = g_string_new (G_OBJECT_TYPE_NAME (self));
+	g_string_append_printf (str, "|%s", priv->physical_id);
+	if (priv->logical_id != NULL)
+		g_string_append_printf (str, "|%s", priv->logical_id);
+	if (fu_device_get_version (self) != NULL)
+		g_string_append_printf (str, "|%s", fu_device_get_version (self));
+	for (guint i = 0; i < instance_ids->len; i++) {
+		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
+		g_string_append_printf (str, "|%s", instance_id);
+	}
+	return g_string_free (str, FALSE);
+}
+
+static void
+fu_device_set_from_probe_cache (FuDevice *self, GVariant *value)
+{
+	GPtrArray *icons;
+	GPtrArray *guids;
+	GPtrArray *instance_ids;
+	g_autoptr(FwupdDevice) donor = fwupd_device_from_variant (value);
+
+	/* these are typically set by the subclassed ->setup() and so override
+	 * anything set in ->probe() */
+	if (fwupd_device_get_name (donor) != NULL)
+		fu_device_set_name (self, fwupd_device_get_name (donor));
+	if (fwupd_device_get_vendor (donor) != NULL)
+		fu_device_set_vendor (self, fwupd_device_get_vendor (donor));
+	if (fwupd_device_get_serial (donor) != NULL)
+		fu_device_set_serial (self, fwupd_device_get_serial (donor));
+	if (fwupd_device_get_summary (donor) != NULL)
+		fu_device_set_summary (self, fwupd_device_get_summary (donor));
+	if (fwupd_device_get_branch (donor) != NULL)
+		fu_device_set_branch (self, fwupd_device_get_branch (donor));
+	if (fwupd_device_get_version_format (donor) != FWUPD_VERSION_FORMAT_UNKNOWN)
+		fwupd_device_set_version_format (FWUPD_DEVICE (self), fwupd_device_get_version_format (donor));
+	if (fwupd_device_get_version (donor) != NULL)
+		fwupd_device_set_version (FWUPD_DEVICE (self), fwupd_device_get_version (donor));
+	if (fwupd_device_get_version_lowest (donor) != NULL)
+		fwupd_device_set_version_lowest (FWUPD_DEVICE (self), fwupd_device_get_version_lowest (donor));
+	if (fwupd_device_get_version_bootloader (donor) != NULL)
+		fwupd_device_set_version_bootloader (FWUPD_DEVICE (self), fwupd_device_get_version_bootloader (donor));
+	if (fwupd_device_get_version_raw (donor) != 0)
+		fu_device_set_version_raw (self, fwupd_device_get_version_raw (donor));
+	fwupd_device_add_flag (FWUPD_DEVICE (self), fwupd_device_get_flags (donor));
+	instance_ids = fwupd_device_get_instance_ids (donor);
+	for (guint i = 0; i < instance_ids->len; i++)
+		fu_device_add_instance_id (self, g_ptr_array_index (instance_ids, i));
+	guids = fwupd_device_get_guids (donor);
+	for (guint i = 0; i < guids->len; i++)
+		fu_device_add_guid (self, g_ptr_array_index (guids, i));
+	icons = fwupd_device_get_icons (donor);
+	for (guint i = 0; i < icons->len; i++)
+		fu_device_add_icon (self, g_ptr_array_index (icons, i));
+
+	/* anything else not already set */
+	fwupd_device_incorporate (FWUPD_DEVICE (self), donor);
+}
+
+static void
+fu_device_probe_cache_snapshot_clear (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_clear_pointer (&priv->probe_cache_before, g_variant_unref);
+	g_clear_pointer (&priv->probe_cache_after, g_variant_unref);
+}
+
+/* what to keep of the current @value_now, or %NULL to remove the key */
+static GVariant *
+fu_device_probe_cache_revert_value (const gchar *key,
+				    GVariant *value_before,	/* nullable */
+				    GVariant *value_after,	/* nullable */
+				    GVariant *value_now)
+{
+	/* not changed by the cache */
+	if (value_after == NULL ||
+	    (value_before != NULL && g_variant_equal (value_before, value_after)))
+		return g_variant_ref (value_now);
+
+	/* not changed since the hit */
+	if (g_variant_equal (value_after, value_now))
+		return value_before != NULL ? g_variant_ref (value_before) : NULL;
+
+	/* changed since the hit, so only remove what the cache added */
+	if (g_variant_is_of_type (value_now, G_VARIANT_TYPE_STRING_ARRAY)) {
+		GVariantBuilder builder;
+		GVariantIter iter;
+		const gchar *str;
+		g_autofree const gchar **strv_before = NULL;
+		g_autofree const gchar **strv_after = g_variant_get_strv (value_after, NULL);
+
+		if (value_before != NULL)
+			strv_before = g_variant_get_strv (value_before, NULL);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+		g_variant_iter_init (&iter, value_now);
+		while (g_variant_iter_next (&iter, "&s", &str)) {
+			if (g_strv_contains ((const gchar * const *) strv_after, str) &&
+			    (strv_before == NULL ||
+			     !g_strv_contains ((const gchar * const *) strv_before, str)))
+				continue;
+			g_variant_builder_add (&builder, "s", str);
+		}
+		return g_variant_ref_sink (g_variant_builder_end (&builder));
+	}
+	if (g_strcmp0 (key, FWUPD_RESULT_KEY_FLAGS) == 0) {
+		guint64 flags_before = value_before != NULL ? g_variant_get_uint64 (value_before) : 0;
+		guint64 flags_cache = g_variant_get_uint64 (value_after) & ~flags_before;
+		return g_variant_ref_sink (g_variant_new_uint64 (g_variant_get_uint64 (value_now) & ~flags_cache));
+	}
+	return g_variant_ref (value_now);
+}
+
+/* undo fu_device_set_from_probe_cache(), but keep anything that has been
+ * changed since then, e.g. by the engine or the plugin */
+static void
+fu_device_unset_from_probe_cache (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_new = NULL;
+
+	if (priv->probe_cache_before == NULL || priv->probe_cache_after == NULL)
+		return;
+	val = g_variant_ref_sink (fwupd_device_to_variant_full (FWUPD_DEVICE (self),
+								FWUPD_DEVICE_FLAG_TRUSTED));
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_before = NULL;
+		g_autoptr(GVariant) value_after = NULL;
+		g_autoptr(GVariant) value_new = NULL;
+		value_before = g_variant_lookup_value (priv->probe_cache_before, key, NULL);
+		value_after = g_variant_lookup_value (priv->probe_cache_after, key, NULL);
+		value_new = fu_device_probe_cache_revert_value (key, value_before, value_after, value);
+		if (value_new != NULL)
+			g_variant_builder_add (&builder, "{sv}", key, value_new);
+		g_variant_unref (value);
+	}
+	val_new = g_variant_ref_sink (g_variant_builder_end (&builder));
+	fwupd_device_reset_from_variant (FWUPD_DEVICE (self), val_new);
+	fu_device_probe_cache_snapshot_clear (self);
+}
+
+/**
+ * fu_device_set_probe_cache:
+ * @self: A #FuDevice
+ * @probe_cache: (nullable): A #FuProbeCache
+ *
+ * Sets the cache used to skip the subclassed ->setup() when the device has
+ * been seen before.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_device_set_probe_cache (FuDevice *self, FuProbeCache *probe_cache)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_set_object (&priv->probe_cache, probe_cache);
+}
+
+/**
+ * fu_device_get_setup_cached:
+ * @self: A #FuDevice
+ *
+ * Gets if the device was set up using the state from a #FuProbeCache rather
+ * than from the hardware, and has not yet been revalidated. Such a device is
+ * not ready to be used for anything other than being shown to the user.
+ *
+ * Returns: %TRUE if the device state came from the cache
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_device_get_setup_cached (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	return priv->done_setup_cached;
+}
+
+/**
+ * fu_device_revalidate_setup:
+ * @self: A #FuDevice
+ * @error: A #GError, or %NULL
+ *
+ * Runs the subclassed ->setup() on the hardware if the device state was
+ * restored from a #FuProbeCache. This has to be done before the device is
+ * used for anything other than being shown to the user.
+ *
+ * If this fails the cached state is removed so that it is not used again.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_device_revalidate_setup (FuDevice *self, GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* nothing to do */
+	if (!priv->done_setup_cached)
+		return TRUE;
+	priv->done_setup_cached = FALSE;
+	priv->done_setup = FALSE;
+
+	/* the cached state was merged with what ->probe() set, so go back to
+	 * that so nothing that the hardware no longer reports is kept */
+	fu_device_unset_from_probe_cache (self);
+
+	/* refresh the cache entry using probe_cache_key, but do not use it */
+	if (priv->open_refcount > 0) {
+		/* already opened by the plugin */
+		ret = fu_device_setup (self, error);
+	} else {
+		/* opening the device runs ->setup() */
+		g_autoptr(FuDeviceLocker) locker = fu_device_locker_new (self, error);
+		ret = locker != NULL;
+	}
+	if (!ret && priv->probe_cache != NULL && priv->probe_cache_key != NULL)
+		fu_probe_cache_remove (priv->probe_cache, priv->probe_cache_key);
+	g_clear_pointer (&priv->probe_cache_key, g_free);
+	g_clear_object (&priv->probe_cache);
+	return ret;
+}
+
 /**
  * fu_device_setup:
  * @self: A #FuDevice
@@ -2978,6 +3296,7 @@ fu_device_setup (FuDevice *self, GError **error)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	g_autofree gchar *cache_key = NULL;
 
 	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -2986,6 +3305,36 @@ fu_device_setup (FuDevice *self, GError **error)
 	if (priv->done_setup)
 		return TRUE;
 
+	/* use the state from a previous run, revalidating later; when
+	 * revalidating the key of the hit is used as the cached state has
+	 * since changed the version and instance IDs */
+	if (priv->probe_cache != NULL && klass->setup != NULL) {
+		if (priv->probe_cache_key != NULL) {
+			cache_key = g_strdup (priv->probe_cache_key);
+		} else {
+			cache_key = fu_device_get_probe_cache_key (self);
+			if (cache_key != NULL) {
+				g_autoptr(GVariant) value = fu_probe_cache_lookup (priv->probe_cache, cache_key);
+				if (value != NULL) {
+					g_debug ("using probe cache for %s", cache_key);
+					fu_device_probe_cache_snapshot_clear (self);
+					priv->probe_cache_before =
+						g_variant_ref_sink (fwupd_device_to_variant_full (FWUPD_DEVICE (self),
+												  FWUPD_DEVICE_FLAG_TRUSTED));
+					fu_device_set_from_probe_cache (self, value);
+					fu_device_convert_instance_ids (self);
+					priv->probe_cache_after =
+						g_variant_ref_sink (fwupd_device_to_variant_full (FWUPD_DEVICE (self),
+												  FWUPD_DEVICE_FLAG_TRUSTED));
+					priv->probe_cache_key = g_steal_pointer (&cache_key);
+					priv->done_setup_cached = TRUE;
+					priv->done_setup = TRUE;
+					return TRUE;
+				}
+			}
+		}
+	}
+
 	/* subclassed */
 	if (klass->setup != NULL) {
 		if (!klass->setup (self, error))
@@ -2995,6 +3344,13 @@ fu_device_setup (FuDevice *self, GError **error)
 	/* convert the instance IDs to GUIDs */
 	fu_device_convert_instance_ids (self);
 
+	/* children are not serialized, so cannot be restored */
+	if (cache_key != NULL && fu_device_get_children (self)->len == 0) {
+		fu_probe_cache_add (priv->probe_cache, cache_key,
+				    fwupd_device_to_variant_full (FWUPD_DEVICE (self),
+								  FWUPD_DEVICE_FLAG_TRUSTED));
+	}
+
 	priv->done_setup = TRUE;
 	return TRUE;
 }
@@ -3048,6 +3404,9 @@ fu_device_probe_invalidate (FuDevice *self)
 	g_return_if_fail (FU_IS_DEVICE (self));
 	priv->done_probe = FALSE;
 	priv->done_setup = FALSE;
+	priv->done_setup_cached = FALSE;
+	g_clear_pointer (&priv->probe_cache_key, g_free);
+	fu_device_probe_cache_snapshot_clear (self);
 }
 
 /**
@@ -3249,7 +3608,7 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 	/* call the set_quirk_kv() vfunc for the superclassed object */
 	for (guint i = 0; i < instance_ids->len; i++) {
 		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
-		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
+		g_autofree gchar *guid = fu_device_guid_hash_string (instance_id);
 		fu_device_add_guid_quirks (self, guid);
 	}
 }
@@ -3336,6 +3695,22 @@ fu_device_class_init (FuDeviceClass *klass)
 				     G_PARAM_CONSTRUCT |
 				     G_PARAM_STATIC_NAME);
 	g_object_class_install_property (object_class, PROP_PROXY, pspec);
+
+	pspec = g_param_spec_string ("id", NULL, NULL, NULL,
+				     G_PARAM_READABLE |
+				     G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_ID, pspec);
+
+	pspec = g_param_spec_boxed ("guids", NULL, NULL,
+				    G_TYPE_PTR_ARRAY,
+				    G_PARAM_READABLE |
+				    G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_GUIDS, pspec);
+
+	pspec = g_param_spec_string ("equivalent-id", NULL, NULL, NULL,
+				     G_PARAM_READABLE |
+				     G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_EQUIVALENT_ID, pspec);
 }
 
 static void
@@ -3365,6 +3740,13 @@ fu_device_finalize (GObject *object)
 		g_object_remove_weak_pointer (G_OBJECT (priv->proxy), (gpointer *) &priv->proxy);
 	if (priv->quirks != NULL)
 		g_object_unref (priv->quirks);
+	if (priv->probe_cache != NULL)
+		g_object_unref (priv->probe_cache);
+	g_free (priv->probe_cache_key);
+	if (priv->probe_cache_before != NULL)
+		g_variant_unref (priv->probe_cache_before);
+	if (priv->probe_cache_after != NULL)
+		g_variant_unref (priv->probe_cache_after);
 	if (priv->poll_id != 0)
 		g_source_remove (priv->poll_id);
 	if (priv->metadata != NULL)
@@ -10,6 +10,8 @@
 
 #include <string.h>
 
+#include "fwupd-error.h"
+
 #include "fu-firmware-common.h"
 
 /**
@@ -121,3 +123,63 @@ fu_firmware_strparse_uint32 (const gchar *data)
 	buffer[8] = '\0';
 	return (guint32) g_ascii_strtoull (buffer, NULL, 16);
 }
+
+/* base 16 value of each character, or 0xff if invalid */
+static const guint8 fu_firmware_strparse_hex_lookup[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+/**
+ * fu_firmware_strparse_hex:
+ * @data: a string
+ * @buf: a mutable buffer
+ * @bufsz: number of bytes to decode into @buf
+ * @error: A #GError, or %NULL
+ *
+ * Decodes base 16 pairs from a string into a buffer, without allocating.
+ *
+ * The string MUST be at least @bufsz * 2 bytes long as this function cannot
+ * check the length of @data, although it does not need to be NUL terminated.
+ *
+ * Return value: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_firmware_strparse_hex (const gchar *data, guint8 *buf, gsize bufsz, GError **error)
+{
+	const guint8 *str = (const guint8 *) data;
+	guint8 invalid = 0x0;
+
+	/* no branches in the loop so that the compiler can vectorize it */
+	for (gsize i = 0; i < bufsz; i++) {
+		guint8 hi = fu_firmware_strparse_hex_lookup[str[i * 2]];
+		guint8 lo = fu_firmware_strparse_hex_lookup[str[(i * 2) + 1]];
+		invalid |= hi | lo;
+		buf[i] = (guint8) (hi << 4) | lo;
+	}
+	if (invalid & 0xf0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid hex data: %.*s",
+			     (gint) bufsz * 2, data);
+		return FALSE;
+	}
+	return TRUE;
+}
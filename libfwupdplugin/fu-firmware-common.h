@@ -13,3 +13,7 @@ guint8		 fu_firmware_strparse_uint8		(const gchar	*data);
 guint16		 fu_firmware_strparse_uint16		(const gchar	*data);
 guint32		 fu_firmware_strparse_uint24		(const gchar	*data);
 guint32		 fu_firmware_strparse_uint32		(const gchar	*data);
+gboolean	 fu_firmware_strparse_hex		(const gchar	*data,
+							 guint8		*buf,
+							 gsize		 bufsz,
+							 GError		**error);
@@ -61,44 +61,47 @@ fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuIhexFirmwareRecord, fu_ihex_firmware_record_free)
 
 static FuIhexFirmwareRecord *
-fu_ihex_firmware_record_new (guint ln, const gchar *line,
+fu_ihex_firmware_record_new (guint ln, const gchar *line, gsize linesz,
 			     FwupdInstallFlags flags, GError **error)
 {
 	g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
+	guint8 hdr[4] = { 0x0 };
 	guint line_end;
 
 	/* check starting token */
-	if (line[0] != ':') {
+	if (linesz == 0 || line[0] != ':') {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
-			     "invalid starting token: %s",
-			     line);
+			     "invalid starting token: %.*s",
+			     (gint) linesz, line);
 		return NULL;
 	}
 
-	/* length, 16-bit address, type */
-	rcd = g_new0 (FuIhexFirmwareRecord, 1);
-	rcd->ln = ln;
-	rcd->data = g_byte_array_new ();
-	rcd->buf = g_string_new (line);
-	rcd->byte_cnt = fu_firmware_strparse_uint8 (line + 1);
-	rcd->addr = fu_firmware_strparse_uint16 (line + 3);
-	rcd->record_type = fu_firmware_strparse_uint8 (line + 7);
-
 	/* check there's enough data for the smallest possible record */
-	if (rcd->buf->len < 11) {
+	if (linesz < 11) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "line incomplete, length: %u",
-			     (guint) rcd->buf->len);
+			     (guint) linesz);
 		return NULL;
 	}
 
+	/* length, 16-bit address, type */
+	if (!fu_firmware_strparse_hex (line + 1, hdr, sizeof(hdr), error))
+		return NULL;
+	rcd = g_new0 (FuIhexFirmwareRecord, 1);
+	rcd->ln = ln;
+	rcd->data = g_byte_array_sized_new (hdr[0]);
+	rcd->buf = g_string_new_len (line, linesz);
+	rcd->byte_cnt = hdr[0];
+	rcd->addr = ((guint32) hdr[1] << 8) | hdr[2];
+	rcd->record_type = hdr[3];
+
 	/* position of checksum */
 	line_end = 9 + rcd->byte_cnt * 2;
-	if (line_end > (guint) rcd->buf->len) {
+	if (line_end > linesz) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
@@ -107,13 +110,28 @@ fu_ihex_firmware_record_new (guint ln, const gchar *line,
 		return NULL;
 	}
 
+	/* decode data straight into the record */
+	g_byte_array_set_size (rcd->data, rcd->byte_cnt);
+	if (!fu_firmware_strparse_hex (line + 9, rcd->data->data, rcd->data->len, error))
+		return NULL;
+
 	/* verify checksum */
 	if ((flags & FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM) == 0) {
 		guint8 checksum = 0;
-		for (guint i = 1; i < line_end + 2; i += 2) {
-			guint8 data_tmp = fu_firmware_strparse_uint8 (line + i);
-			checksum += data_tmp;
+		if (line_end + 2 > linesz) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "line malformed, length: %u",
+				     line_end + 2);
+			return NULL;
 		}
+		if (!fu_firmware_strparse_hex (line + line_end, &checksum, 1, error))
+			return NULL;
+		for (guint i = 0; i < sizeof(hdr); i++)
+			checksum += hdr[i];
+		for (guint i = 0; i < rcd->data->len; i++)
+			checksum += rcd->data->data[i];
 		if (checksum != 0)  {
 			g_set_error (error,
 				     FWUPD_ERROR,
@@ -123,12 +141,6 @@ fu_ihex_firmware_record_new (guint ln, const gchar *line,
 			return NULL;
 		}
 	}
-
-	/* add data */
-	for (guint i = 9; i < line_end; i += 2) {
-		guint8 tmp_c = fu_firmware_strparse_uint8 (line + i);
-		fu_byte_array_append_uint8 (rcd->data, tmp_c);
-	}
 	return g_steal_pointer (&rcd);
 }
 
@@ -159,18 +171,29 @@ fu_ihex_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
 	gsize sz = 0;
 	const gchar *data = g_bytes_get_data (fw, &sz);
-	g_auto(GStrv) lines = fu_common_strnsplit (data, sz, "\n", -1);
+	gsize offset = 0;
 
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
+	/* walk the lines in place rather than splitting a copy */
+	for (guint ln = 1; offset < sz; ln++) {
 		g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
-		g_strdelimit (lines[ln], "\r\x1a", '\0');
-		if (g_str_has_prefix (lines[ln], ";"))
+		const gchar *line = data + offset;
+		const gchar *eol = memchr (line, '\n', sz - offset);
+		gsize linesz = eol != NULL ? (gsize) (eol - line) : sz - offset;
+
+		offset += linesz + 1;
+		for (gsize i = 0; i < linesz; i++) {
+			if (line[i] == '\r' || line[i] == '\x1a' || line[i] == '\0') {
+				linesz = i;
+				break;
+			}
+		}
+		if (linesz == 0)
 			continue;
-		if (lines[ln][0] == '\0')
+		if (line[0] == ';')
 			continue;
-		rcd = fu_ihex_firmware_record_new (ln + 1, lines[ln], flags, error);
+		rcd = fu_ihex_firmware_record_new (ln, line, linesz, flags, error);
 		if (rcd == NULL) {
-			g_prefix_error (error, "invalid line %u: ", ln + 1);
+			g_prefix_error (error, "invalid line %u: ", ln);
 			return FALSE;
 		}
 		g_ptr_array_add (self->records, g_steal_pointer (&rcd));
@@ -188,13 +211,23 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
 	gboolean got_eof = FALSE;
+	gboolean verbose = g_getenv ("FWUPD_IHEX_VERBOSE") != NULL;
+	guint bufsz = 0;
 	guint32 abs_addr = 0x0;
 	guint32 addr_last = 0x0;
 	guint32 img_addr = G_MAXUINT32;
 	guint32 seg_addr = 0x0;
 	g_autoptr(FuFirmwareImage) img = fu_firmware_image_new (NULL);
 	g_autoptr(GBytes) img_bytes = NULL;
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	g_autoptr(GByteArray) buf = NULL;
+
+	/* only the holes can make the image any larger than this */
+	for (guint k = 0; k < self->records->len; k++) {
+		FuIhexFirmwareRecord *rcd = g_ptr_array_index (self->records, k);
+		if (rcd->record_type == FU_IHEX_FIRMWARE_RECORD_TYPE_DATA)
+			bufsz += rcd->data->len;
+	}
+	buf = g_byte_array_sized_new (bufsz);
 
 	/* parse records */
 	for (guint k = 0; k < self->records->len; k++) {
@@ -203,9 +236,11 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 		guint32 addr = rcd->addr + seg_addr + abs_addr;
 		guint32 len_hole;
 
-		g_debug ("%s:", fu_ihex_firmware_record_type_to_string (rcd->record_type));
-		g_debug ("  length:\t0x%02x", rcd->data->len);
-		g_debug ("  addr:\t0x%08x", addr);
+		if (verbose) {
+			g_debug ("%s:", fu_ihex_firmware_record_type_to_string (rcd->record_type));
+			g_debug ("  length:\t0x%02x", rcd->data->len);
+			g_debug ("  addr:\t0x%08x", addr);
+		}
 
 		/* process different record types */
 		switch (rcd->record_type) {
@@ -238,13 +273,14 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 				return FALSE;
 			}
 			if (addr_last > 0x0 && len_hole > 1) {
+				guint buf_len = buf->len;
 				g_debug ("filling address 0x%08x to 0x%08x on line %u",
 					 addr_last + 1, addr_last + len_hole - 1, rcd->ln);
-				for (guint j = 1; j < len_hole; j++) {
-					/* although 0xff might be clearer,
-					 * we can't write 0xffff to pic14 */
-					fu_byte_array_append_uint8 (buf, 0x00);
-				}
+
+				/* although 0xff might be clearer,
+				 * we can't write 0xffff to pic14 */
+				g_byte_array_set_size (buf, buf_len + len_hole - 1);
+				memset (buf->data + buf_len, 0x00, len_hole - 1);
 			}
 			addr_last = addr + rcd->data->len - 1;
 
@@ -321,7 +357,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 	}
 
 	/* add single image */
-	img_bytes = g_bytes_new (buf->data, buf->len);
+	img_bytes = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	fu_firmware_image_set_bytes (img, img_bytes);
 	if (img_addr != G_MAXUINT32)
 		fu_firmware_image_set_addr (img, img_addr);
@@ -8,6 +8,7 @@
 
 #include "fu-quirks.h"
 #include "fu-plugin.h"
+#include "fu-probe-cache.h"
 #include "fu-security-attrs.h"
 #include "fu-smbios.h"
 
@@ -19,8 +20,11 @@ void		 fu_plugin_set_hwids			(FuPlugin	*self,
 							 FuHwids	*hwids);
 void		 fu_plugin_set_udev_subsystems		(FuPlugin	*self,
 							 GPtrArray	*udev_subsystems);
+GPtrArray	*fu_plugin_get_udev_subsystems		(FuPlugin	*self);
 void		 fu_plugin_set_quirks			(FuPlugin	*self,
 							 FuQuirks	*quirks);
+void		 fu_plugin_set_probe_cache		(FuPlugin	*self,
+							 FuProbeCache	*probe_cache);
 void		 fu_plugin_set_runtime_versions		(FuPlugin	*self,
 							 GHashTable	*runtime_versions);
 void		 fu_plugin_set_compile_versions		(FuPlugin	*self,
@@ -307,6 +307,9 @@ gboolean	 fu_plugin_udev_device_added		(FuPlugin	*plugin,
  *
  * Function run when Udev device changed.
  *
+ * This is only called for devices in subsystems registered by this plugin
+ * using fu_plugin_add_udev_subsystem().
+ *
  * Since: 1.1.2
  **/
 gboolean	 fu_plugin_udev_device_changed		(FuPlugin	*plugin,
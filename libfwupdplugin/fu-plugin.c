@@ -46,7 +46,10 @@ typedef struct {
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
 	GPtrArray		*udev_subsystems;
+	GPtrArray		*udev_subsystems_watched;	/* (nullable): subsystems added by this plugin */
+	FuPluginThreadFlags	 thread_flags;
 	FuSmbios		*smbios;
+	FuProbeCache		*probe_cache;	/* (nullable) */
 	GType			 device_gtype;
 	GHashTable		*devices;		/* (nullable): platform_id:GObject */
 	GRWLock			 devices_mutex;
@@ -843,6 +846,22 @@ fu_plugin_set_udev_subsystems (FuPlugin *self, GPtrArray *udev_subsystems)
 	priv->udev_subsystems = g_ptr_array_ref (udev_subsystems);
 }
 
+/**
+ * fu_plugin_set_probe_cache:
+ * @self: A #FuPlugin
+ * @probe_cache: (nullable): A #FuProbeCache
+ *
+ * Sets the cache used when setting up devices created by the plugin.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_plugin_set_probe_cache (FuPlugin *self, FuProbeCache *probe_cache)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->probe_cache, probe_cache);
+}
+
 /**
  * fu_plugin_set_quirks:
  * @self: A #FuPlugin
@@ -1124,10 +1143,11 @@ fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error
 	g_autoptr(FuDeviceLocker) locker = NULL;
 	g_autoptr(FuFirmware) firmware = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	GChecksumType checksum_types[] = {
+	g_autoptr(GPtrArray) hashes = NULL;
+	const GChecksumType checksum_types[] = {
 		G_CHECKSUM_SHA1,
 		G_CHECKSUM_SHA256,
-		0 };
+	};
 	locker = fu_device_locker_new (device, error);
 	if (locker == NULL)
 		return FALSE;
@@ -1149,11 +1169,11 @@ fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error
 		g_prefix_error (error, "failed to write firmware: ");
 		return FALSE;
 	}
-	for (guint i = 0; checksum_types[i] != 0; i++) {
-		g_autofree gchar *hash = NULL;
-		hash = g_compute_checksum_for_bytes (checksum_types[i], fw);
-		fu_device_add_checksum (device, hash);
-	}
+	hashes = fu_common_checksums_for_bytes (fw, checksum_types,
+						G_N_ELEMENTS (checksum_types),
+						NULL, NULL);
+	for (guint i = 0; i < hashes->len; i++)
+		fu_device_add_checksum (device, g_ptr_array_index (hashes, i));
 	return fu_device_attach (device, error);
 }
 
@@ -1712,6 +1732,22 @@ void
 fu_plugin_add_udev_subsystem (FuPlugin *self, const gchar *subsystem)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean watched = FALSE;
+
+	/* remember what this plugin asked for so events can be dispatched */
+	if (priv->udev_subsystems_watched == NULL)
+		priv->udev_subsystems_watched = g_ptr_array_new_with_free_func (g_free);
+	for (guint i = 0; i < priv->udev_subsystems_watched->len; i++) {
+		const gchar *subsystem_tmp = g_ptr_array_index (priv->udev_subsystems_watched, i);
+		if (g_strcmp0 (subsystem_tmp, subsystem) == 0) {
+			watched = TRUE;
+			break;
+		}
+	}
+	if (!watched)
+		g_ptr_array_add (priv->udev_subsystems_watched, g_strdup (subsystem));
+
+	/* shared with the daemon */
 	if (priv->udev_subsystems == NULL)
 		priv->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
 	for (guint i = 0; i < priv->udev_subsystems->len; i++) {
@@ -1723,6 +1759,67 @@ fu_plugin_add_udev_subsystem (FuPlugin *self, const gchar *subsystem)
 	g_ptr_array_add (priv->udev_subsystems, g_strdup (subsystem));
 }
 
+/**
+ * fu_plugin_get_udev_subsystems:
+ * @self: a #FuPlugin
+ *
+ * Gets the udev subsystems registered by this plugin using
+ * fu_plugin_add_udev_subsystem(), which is used by the daemon to only deliver
+ * udev change events to the plugins that asked for them.
+ *
+ * Returns: (element-type utf8) (transfer none) (nullable): subsystems, e.g. ['drm']
+ *
+ * Since: 1.5.3
+ **/
+GPtrArray *
+fu_plugin_get_udev_subsystems (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), NULL);
+	return priv->udev_subsystems_watched;
+}
+
+/**
+ * fu_plugin_add_thread_flag:
+ * @self: a #FuPlugin
+ * @flag: a #FuPluginThreadFlags, e.g. %FU_PLUGIN_THREAD_FLAG_COLDPLUG
+ *
+ * Tells the daemon that the vfuncs described by @flag do not share any
+ * unlocked state with other plugins or other devices, and so can be run from
+ * a worker thread.
+ *
+ * Plugins can use this method only in fu_plugin_init()
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_plugin_add_thread_flag (FuPlugin *self, FuPluginThreadFlags flag)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_PLUGIN (self));
+	priv->thread_flags |= flag;
+}
+
+/**
+ * fu_plugin_has_thread_flag:
+ * @self: a #FuPlugin
+ * @flag: a #FuPluginThreadFlags, e.g. %FU_PLUGIN_THREAD_FLAG_COLDPLUG
+ *
+ * Finds out if the plugin allows the vfuncs described by @flag to be run from
+ * a worker thread.
+ *
+ * Returns: %TRUE if the flag was added
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_plugin_has_thread_flag (FuPlugin *self, FuPluginThreadFlags flag)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), FALSE);
+	return (priv->thread_flags & flag) > 0;
+}
+
 /**
  * fu_plugin_set_device_gtype:
  * @self: a #FuPlugin
@@ -1790,6 +1887,8 @@ fu_plugin_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError **error)
 	/* create new device and incorporate existing properties */
 	dev = g_object_new (device_gtype, NULL);
 	fu_device_incorporate (dev, FU_DEVICE (device));
+	if (priv->probe_cache != NULL)
+		fu_device_set_probe_cache (dev, priv->probe_cache);
 	if (!fu_plugin_runner_device_created (self, dev, error))
 		return FALSE;
 
@@ -1830,6 +1929,8 @@ fu_plugin_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError **erro
 	/* create new device and incorporate existing properties */
 	dev = g_object_new (device_gtype, NULL);
 	fu_device_incorporate (FU_DEVICE (dev), FU_DEVICE (device));
+	if (priv->probe_cache != NULL)
+		fu_device_set_probe_cache (dev, priv->probe_cache);
 	if (!fu_plugin_runner_device_created (self, dev, error))
 		return FALSE;
 
@@ -2838,6 +2939,10 @@ fu_plugin_finalize (GObject *object)
 		g_object_unref (priv->quirks);
 	if (priv->udev_subsystems != NULL)
 		g_ptr_array_unref (priv->udev_subsystems);
+	if (priv->udev_subsystems_watched != NULL)
+		g_ptr_array_unref (priv->udev_subsystems_watched);
+	if (priv->probe_cache != NULL)
+		g_object_unref (priv->probe_cache);
 	if (priv->smbios != NULL)
 		g_object_unref (priv->smbios);
 	if (priv->runtime_versions != NULL)
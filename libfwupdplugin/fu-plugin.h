@@ -94,6 +94,23 @@ typedef enum {
 	FU_PLUGIN_RULE_LAST
 } FuPluginRule;
 
+/**
+ * FuPluginThreadFlags:
+ * @FU_PLUGIN_THREAD_FLAG_NONE:		No flags set
+ * @FU_PLUGIN_THREAD_FLAG_COLDPLUG:	Coldplug can run on a worker thread at the same time as other plugins
+ * @FU_PLUGIN_THREAD_FLAG_UPDATE:	More than one device from the plugin can be updated at the same time
+ *
+ * The plugin vfuncs the daemon is allowed to run from worker threads.
+ * Plugins are expected to add flags in fu_plugin_init().
+ **/
+typedef enum {
+	FU_PLUGIN_THREAD_FLAG_NONE		= 0,
+	FU_PLUGIN_THREAD_FLAG_COLDPLUG		= 1 << 0,	/* Since: 1.5.3 */
+	FU_PLUGIN_THREAD_FLAG_UPDATE		= 1 << 1,	/* Since: 1.5.3 */
+	/*< private >*/
+	FU_PLUGIN_THREAD_FLAG_LAST
+} FuPluginThreadFlags;
+
 typedef struct	FuPluginData	FuPluginData;
 
 /* for plugins to use */
@@ -149,6 +166,10 @@ void		 fu_plugin_add_rule			(FuPlugin	*self,
 							 const gchar	*name);
 void		 fu_plugin_add_udev_subsystem		(FuPlugin	*self,
 							 const gchar	*subsystem);
+void		 fu_plugin_add_thread_flag		(FuPlugin	*self,
+							 FuPluginThreadFlags flag);
+gboolean	 fu_plugin_has_thread_flag		(FuPlugin	*self,
+							 FuPluginThreadFlags flag);
 FuQuirks	*fu_plugin_get_quirks			(FuPlugin	*self);
 const gchar	*fu_plugin_lookup_quirk_by_id		(FuPlugin	*self,
 							 const gchar	*group,
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuProbeCache"
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "fwupd-error.h"
+
+#include "fu-common.h"
+#include "fu-probe-cache.h"
+
+/**
+ * SECTION:fu-probe-cache
+ * @short_description: a cache of device state from a previous run
+ *
+ * An object that stores the device state after the slow fu_device_setup()
+ * stage so that the daemon can publish devices quickly when restarted.
+ *
+ * Only the entries that were used or added are saved, so devices that are no
+ * longer present are dropped automatically.
+ *
+ * The whole cache is also tied to a firmware state, e.g. a checksum of the
+ * update history, so that a device updated while the daemon was not running
+ * is never published with the version from before the update.
+ *
+ * See also: #FuDevice
+ */
+
+#define FU_PROBE_CACHE_FORMAT		"(ssa{sv})"
+
+struct _FuProbeCache {
+	GObject			 parent_instance;
+	gchar			*state;		/* (nullable) */
+	GHashTable		*entries;	/* key:FuProbeCacheEntry */
+	GRWLock			 entries_mutex;
+	guint			 hits;
+	guint			 misses;
+};
+
+typedef struct {
+	GVariant		*value;
+	gboolean		 used;
+} FuProbeCacheEntry;
+
+G_DEFINE_TYPE (FuProbeCache, fu_probe_cache, G_TYPE_OBJECT)
+
+static void
+fu_probe_cache_entry_free (FuProbeCacheEntry *entry)
+{
+	g_variant_unref (entry->value);
+	g_free (entry);
+}
+
+static void
+fu_probe_cache_insert (FuProbeCache *self, const gchar *key, GVariant *value, gboolean used)
+{
+	FuProbeCacheEntry *entry = g_new0 (FuProbeCacheEntry, 1);
+	entry->value = g_variant_ref_sink (value);
+	entry->used = used;
+	g_hash_table_insert (self->entries, g_strdup (key), entry);
+}
+
+/**
+ * fu_probe_cache_set_state:
+ * @self: A #FuProbeCache
+ * @state: (nullable): a string that changes when any firmware is updated
+ *
+ * Sets the firmware state. A file saved with a different state is ignored
+ * when loading, and the current state is written when saving.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_probe_cache_set_state (FuProbeCache *self, const gchar *state)
+{
+	g_return_if_fail (FU_IS_PROBE_CACHE (self));
+	g_free (self->state);
+	self->state = g_strdup (state);
+}
+
+/**
+ * fu_probe_cache_load:
+ * @self: A #FuProbeCache
+ * @filename: a filename
+ * @error: A #GError, or %NULL
+ *
+ * Loads the cache from a file saved by fu_probe_cache_save().
+ *
+ * If the file was written by a different daemon version it is ignored, as the
+ * plugins may now set up the devices differently. It is also ignored if the
+ * firmware state has changed since the file was saved.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_probe_cache_load (FuProbeCache *self, const gchar *filename, GError **error)
+{
+	GVariant *value_tmp;
+	const gchar *key;
+	const gchar *state = NULL;
+	const gchar *version = NULL;
+	gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(GVariant) value_normal = NULL;
+	g_autoptr(GVariantIter) iter = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* the file could have been modified, so check before use */
+	if (!g_file_get_contents (filename, &buf, &bufsz, error))
+		return FALSE;
+	blob = g_bytes_new_take (buf, bufsz);
+	value = g_variant_new_from_bytes (G_VARIANT_TYPE (FU_PROBE_CACHE_FORMAT), blob, FALSE);
+	value_normal = g_variant_get_normal_form (value);
+	g_variant_get (value_normal, "(&s&sa{sv})", &version, &state, &iter);
+	if (g_strcmp0 (version, PACKAGE_VERSION) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "probe cache version %s does not match %s",
+			     version, PACKAGE_VERSION);
+		return FALSE;
+	}
+	if (g_strcmp0 (state, self->state != NULL ? self->state : "") != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "probe cache state %s does not match %s",
+			     state, self->state);
+		return FALSE;
+	}
+	locker = g_rw_lock_writer_locker_new (&self->entries_mutex);
+	while (g_variant_iter_next (iter, "{&sv}", &key, &value_tmp)) {
+		fu_probe_cache_insert (self, key, value_tmp, FALSE);
+		g_variant_unref (value_tmp);
+	}
+	return TRUE;
+}
+
+/**
+ * fu_probe_cache_save:
+ * @self: A #FuProbeCache
+ * @filename: a filename
+ * @error: A #GError, or %NULL
+ *
+ * Saves the entries that were either used or added to a file.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_probe_cache_save (FuProbeCache *self, const gchar *filename, GError **error)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	GVariantBuilder builder;
+	g_autoptr(GVariant) blob = NULL;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	locker = g_rw_lock_reader_locker_new (&self->entries_mutex);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		FuProbeCacheEntry *entry = (FuProbeCacheEntry *) value;
+		if (!entry->used)
+			continue;
+		g_variant_builder_add (&builder, "{sv}",
+				       (const gchar *) key,
+				       entry->value);
+	}
+	blob = g_variant_ref_sink (g_variant_new (FU_PROBE_CACHE_FORMAT,
+						  PACKAGE_VERSION,
+						  self->state != NULL ? self->state : "",
+						  &builder));
+	if (!fu_common_mkdir_parent (filename, error))
+		return FALSE;
+	return g_file_set_contents (filename,
+				    g_variant_get_data (blob),
+				    g_variant_get_size (blob),
+				    error);
+}
+
+/**
+ * fu_probe_cache_lookup:
+ * @self: A #FuProbeCache
+ * @key: a device key
+ *
+ * Finds the saved device state, and marks the entry as used.
+ *
+ * Returns: (transfer full) (nullable): a #GVariant, or %NULL if not found
+ *
+ * Since: 1.5.3
+ **/
+GVariant *
+fu_probe_cache_lookup (FuProbeCache *self, const gchar *key)
+{
+	FuProbeCacheEntry *entry;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	locker = g_rw_lock_writer_locker_new (&self->entries_mutex);
+	entry = g_hash_table_lookup (self->entries, key);
+	if (entry == NULL) {
+		self->misses++;
+		return NULL;
+	}
+	self->hits++;
+	entry->used = TRUE;
+	return g_variant_ref (entry->value);
+}
+
+/**
+ * fu_probe_cache_add:
+ * @self: A #FuProbeCache
+ * @key: a device key
+ * @value: a #GVariant of type `a{sv}`
+ *
+ * Adds or replaces the saved device state.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_probe_cache_add (FuProbeCache *self, const gchar *key, GVariant *value)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_PROBE_CACHE (self));
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (value != NULL);
+
+	locker = g_rw_lock_writer_locker_new (&self->entries_mutex);
+	fu_probe_cache_insert (self, key, value, TRUE);
+}
+
+/**
+ * fu_probe_cache_remove:
+ * @self: A #FuProbeCache
+ * @key: a device key
+ *
+ * Removes the saved device state, for instance if the device could not be
+ * set up using the hardware.
+ *
+ * Since: 1.5.3
+ **/
+void
+fu_probe_cache_remove (FuProbeCache *self, const gchar *key)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_PROBE_CACHE (self));
+	g_return_if_fail (key != NULL);
+
+	locker = g_rw_lock_writer_locker_new (&self->entries_mutex);
+	g_hash_table_remove (self->entries, key);
+}
+
+/**
+ * fu_probe_cache_get_hits:
+ * @self: A #FuProbeCache
+ *
+ * Gets the number of successful lookups.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.3
+ **/
+guint
+fu_probe_cache_get_hits (FuProbeCache *self)
+{
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), G_MAXUINT);
+	return self->hits;
+}
+
+/**
+ * fu_probe_cache_get_misses:
+ * @self: A #FuProbeCache
+ *
+ * Gets the number of failed lookups.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.3
+ **/
+guint
+fu_probe_cache_get_misses (FuProbeCache *self)
+{
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), G_MAXUINT);
+	return self->misses;
+}
+
+static void
+fu_probe_cache_finalize (GObject *object)
+{
+	FuProbeCache *self = FU_PROBE_CACHE (object);
+	g_free (self->state);
+	g_hash_table_unref (self->entries);
+	g_rw_lock_clear (&self->entries_mutex);
+	G_OBJECT_CLASS (fu_probe_cache_parent_class)->finalize (object);
+}
+
+static void
+fu_probe_cache_class_init (FuProbeCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_probe_cache_finalize;
+}
+
+static void
+fu_probe_cache_init (FuProbeCache *self)
+{
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) fu_probe_cache_entry_free);
+	g_rw_lock_init (&self->entries_mutex);
+}
+
+/**
+ * fu_probe_cache_new:
+ *
+ * Creates a new probe cache.
+ *
+ * Returns: a #FuProbeCache
+ *
+ * Since: 1.5.3
+ **/
+FuProbeCache *
+fu_probe_cache_new (void)
+{
+	return g_object_new (FU_TYPE_PROBE_CACHE, NULL);
+}
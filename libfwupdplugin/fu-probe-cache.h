@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_PROBE_CACHE (fu_probe_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuProbeCache, fu_probe_cache, FU, PROBE_CACHE, GObject)
+
+FuProbeCache	*fu_probe_cache_new		(void);
+void		 fu_probe_cache_set_state	(FuProbeCache	*self,
+						 const gchar	*state);
+gboolean	 fu_probe_cache_load		(FuProbeCache	*self,
+						 const gchar	*filename,
+						 GError		**error);
+gboolean	 fu_probe_cache_save		(FuProbeCache	*self,
+						 const gchar	*filename,
+						 GError		**error);
+GVariant	*fu_probe_cache_lookup		(FuProbeCache	*self,
+						 const gchar	*key);
+void		 fu_probe_cache_add		(FuProbeCache	*self,
+						 const gchar	*key,
+						 GVariant	*value);
+void		 fu_probe_cache_remove		(FuProbeCache	*self,
+						 const gchar	*key);
+guint		 fu_probe_cache_get_hits	(FuProbeCache	*self);
+guint		 fu_probe_cache_get_misses	(FuProbeCache	*self);
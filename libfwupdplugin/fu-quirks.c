@@ -48,13 +48,48 @@
 
 static void fu_quirks_finalize	 (GObject *obj);
 
+/* the strings point into the silo and so are never freed */
+typedef struct {
+	const gchar		*key;
+	const gchar		*value;
+} FuQuirksEntry;
+
+/* the silo is kept alive for as long as anything is using the index, even
+ * if the quirk files have changed and the silo has since been rebuilt */
+typedef struct {
+	volatile gint		 refcount;
+	XbSilo			*silo;
+	GHashTable		*groups;	/* group-id:GArray of FuQuirksEntry */
+} FuQuirksIndex;
+
 struct _FuQuirks
 {
 	GObject			 parent_instance;
 	FuQuirksLoadFlags	 load_flags;
 	XbSilo			*silo;
+	FuQuirksIndex		*index;		/* (nullable) */
+	GRWLock			 index_mutex;
 };
 
+static FuQuirksIndex *
+fu_quirks_index_ref (FuQuirksIndex *index)
+{
+	g_atomic_int_inc (&index->refcount);
+	return index;
+}
+
+static void
+fu_quirks_index_unref (FuQuirksIndex *index)
+{
+	if (!g_atomic_int_dec_and_test (&index->refcount))
+		return;
+	g_hash_table_unref (index->groups);
+	g_object_unref (index->silo);
+	g_free (index);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuQuirksIndex, fu_quirks_index_unref)
+
 G_DEFINE_TYPE (FuQuirks, fu_quirks, G_TYPE_OBJECT)
 
 static gchar *
@@ -212,6 +247,10 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	if (self->silo != NULL && xb_silo_is_valid (self->silo))
 		return TRUE;
 
+	/* the index holds its own reference to the old silo */
+	g_clear_pointer (&self->index, fu_quirks_index_unref);
+	g_clear_object (&self->silo);
+
 	/* system datadir */
 	builder = xb_builder_new ();
 	datadir = fu_common_get_path (FU_PATH_KIND_DATADIR_PKG);
@@ -238,6 +277,83 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	return self->silo != NULL;
 }
 
+/* all the values are loaded once so that each lookup is a hash probe rather
+ * than an XPath query on the silo */
+static FuQuirksIndex *
+fu_quirks_build_index (FuQuirks *self, GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuQuirksIndex) index = g_new0 (FuQuirksIndex, 1);
+	g_autoptr(GPtrArray) devices = NULL;
+
+	index->refcount = 1;
+	index->silo = g_object_ref (self->silo);
+	index->groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       NULL, (GDestroyNotify) g_array_unref);
+	devices = xb_silo_query (self->silo, "quirk/device", 0, &error_local);
+	if (devices == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+		    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return g_steal_pointer (&index);
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+	for (guint i = 0; i < devices->len; i++) {
+		XbNode *device = g_ptr_array_index (devices, i);
+		const gchar *group_id = xb_node_get_attr (device, "id");
+		GArray *entries;
+		g_autoptr(GPtrArray) children = NULL;
+
+		if (group_id == NULL)
+			continue;
+		entries = g_hash_table_lookup (index->groups, group_id);
+		if (entries == NULL) {
+			entries = g_array_new (FALSE, FALSE, sizeof(FuQuirksEntry));
+			g_hash_table_insert (index->groups, (gpointer) group_id, entries);
+		}
+		children = xb_node_get_children (device);
+		for (guint j = 0; j < children->len; j++) {
+			XbNode *n = g_ptr_array_index (children, j);
+			FuQuirksEntry entry;
+			if (g_strcmp0 (xb_node_get_element (n), "value") != 0)
+				continue;
+			entry.key = xb_node_get_attr (n, "key");
+			entry.value = xb_node_get_text (n);
+			g_array_append_val (entries, entry);
+		}
+	}
+	return g_steal_pointer (&index);
+}
+
+static FuQuirksIndex *
+fu_quirks_get_index (FuQuirks *self, GError **error)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	/* nothing changed */
+	if (self->index != NULL) {
+		g_autoptr(GRWLockReaderLocker) locker_read = NULL;
+		locker_read = g_rw_lock_reader_locker_new (&self->index_mutex);
+		if (self->index != NULL && xb_silo_is_valid (self->silo))
+			return fu_quirks_index_ref (self->index);
+	}
+
+	/* ensure up to date */
+	locker = g_rw_lock_writer_locker_new (&self->index_mutex);
+	if (!fu_quirks_check_silo (self, error))
+		return NULL;
+	if (self->index == NULL) {
+		g_autoptr(GTimer) timer = g_timer_new ();
+		self->index = fu_quirks_build_index (self, error);
+		if (self->index == NULL)
+			return NULL;
+		g_debug ("indexed %u quirk groups in %.1fms",
+			 g_hash_table_size (self->index->groups),
+			 g_timer_elapsed (timer, NULL) * 1000.f);
+	}
+	return fu_quirks_index_ref (self->index);
+}
+
 /**
  * fu_quirks_lookup_by_id:
  * @self: A #FuPlugin
@@ -253,53 +369,33 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 const gchar *
 fu_quirks_lookup_by_id (FuQuirks *self, const gchar *group, const gchar *key)
 {
+	GArray *entries;
 	g_autofree gchar *group_key = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(XbNode) n = NULL;
-	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(FuQuirksIndex) index = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), NULL);
 	g_return_val_if_fail (group != NULL, NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 
 	/* ensure up to date */
-	if (!fu_quirks_check_silo (self, &error)) {
+	index = fu_quirks_get_index (self, &error);
+	if (index == NULL) {
 		g_warning ("failed to build silo: %s", error->message);
 		return NULL;
 	}
 
-	/* query */
+	/* lookup */
 	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value[@key=?]",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to build query: %s", error->message);
-		return NULL;
-	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return NULL;
-	}
-	if (!xb_query_bind_str (query, 1, key, &error)) {
-		g_warning ("failed to bind 1: %s", error->message);
-		return NULL;
-	}
-	n = xb_silo_query_first_full (self->silo, query, &error);
-	if (n == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to query: %s", error->message);
+	entries = g_hash_table_lookup (index->groups, group_key);
+	if (entries == NULL)
 		return NULL;
+	for (guint i = 0; i < entries->len; i++) {
+		FuQuirksEntry *entry = &g_array_index (entries, FuQuirksEntry, i);
+		if (g_strcmp0 (entry->key, key) == 0)
+			return entry->value;
 	}
-	return xb_node_get_text (n);
+	return NULL;
 }
 
 /**
@@ -319,54 +415,30 @@ gboolean
 fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 			     FuQuirksIter iter_cb, gpointer user_data)
 {
+	GArray *entries;
 	g_autofree gchar *group_key = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) results = NULL;
-	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(FuQuirksIndex) index = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
 	g_return_val_if_fail (group != NULL, FALSE);
 	g_return_val_if_fail (iter_cb != NULL, FALSE);
 
 	/* ensure up to date */
-	if (!fu_quirks_check_silo (self, &error)) {
+	index = fu_quirks_get_index (self, &error);
+	if (index == NULL) {
 		g_warning ("failed to build silo: %s", error->message);
 		return FALSE;
 	}
 
-	/* query */
+	/* lookup */
 	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to build query: %s", error->message);
-		return FALSE;
-	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return FALSE;
-	}
-	results = xb_silo_query_full (self->silo, query, &error);
-	if (results == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to query: %s", error->message);
+	entries = g_hash_table_lookup (index->groups, group_key);
+	if (entries == NULL || entries->len == 0)
 		return FALSE;
-	}
-	for (guint i = 0; i < results->len; i++) {
-		XbNode *n = g_ptr_array_index (results, i);
-		iter_cb (self,
-			 xb_node_get_attr (n, "key"),
-			 xb_node_get_text (n),
-			 user_data);
+	for (guint i = 0; i < entries->len; i++) {
+		FuQuirksEntry *entry = &g_array_index (entries, FuQuirksEntry, i);
+		iter_cb (self, entry->key, entry->value, user_data);
 	}
 	return TRUE;
 }
@@ -386,9 +458,11 @@ fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 gboolean
 fu_quirks_load (FuQuirks *self, FuQuirksLoadFlags load_flags, GError **error)
 {
+	g_autoptr(FuQuirksIndex) index = NULL;
 	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
 	self->load_flags = load_flags;
-	return fu_quirks_check_silo (self, error);
+	index = fu_quirks_get_index (self, error);
+	return index != NULL;
 }
 
 static void
@@ -401,14 +475,18 @@ fu_quirks_class_init (FuQuirksClass *klass)
 static void
 fu_quirks_init (FuQuirks *self)
 {
+	g_rw_lock_init (&self->index_mutex);
 }
 
 static void
 fu_quirks_finalize (GObject *obj)
 {
 	FuQuirks *self = FU_QUIRKS (obj);
+	if (self->index != NULL)
+		fu_quirks_index_unref (self->index);
 	if (self->silo != NULL)
 		g_object_unref (self->silo);
+	g_rw_lock_clear (&self->index_mutex);
 	G_OBJECT_CLASS (fu_quirks_parent_class)->finalize (obj);
 }
 
@@ -12,6 +12,7 @@
 #include <libgcab.h>
 #include <glib/gstdio.h>
 
+#include "fu-cabinet-private.h"
 #include "fu-device-private.h"
 #include "fu-plugin-private.h"
 #include "fu-security-attrs-private.h"
@@ -129,9 +130,127 @@ static void
 fu_common_crc_func (void)
 {
 	guint8 buf[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 };
+	guint8 buf_large[1027];
 	g_assert_cmpint (fu_common_crc8 (buf, sizeof(buf)), ==, 0x7A);
 	g_assert_cmpint (fu_common_crc16 (buf, sizeof(buf)), ==, 0x4DF1);
 	g_assert_cmpint (fu_common_crc32 (buf, sizeof(buf)), ==, 0x40EFAB9E);
+
+	/* larger than the table stride, and not a multiple of it */
+	for (guint i = 0; i < sizeof(buf_large); i++)
+		buf_large[i] = (guint8) (i * 7 + 3);
+	g_assert_cmpint (fu_common_crc8 (buf_large, sizeof(buf_large)), ==, 0x1B);
+	g_assert_cmpint (fu_common_crc16 (buf_large, sizeof(buf_large)), ==, 0xB02A);
+	g_assert_cmpint (fu_common_crc32 (buf_large, sizeof(buf_large)), ==, 0x02ADD968);
+}
+
+static void
+fu_common_crc_performance_func (void)
+{
+	const gsize sizes[] = { 0x40, 0x1000, 0x100000 };
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		g_autofree guint8 *buf = g_malloc (sizes[i]);
+		guint loops = 0x4000000 / sizes[i];
+		gdouble elapsed[3];
+
+		for (gsize j = 0; j < sizes[i]; j++)
+			buf[j] = (guint8) g_random_int ();
+
+		/* 64MB for each algorithm */
+		g_timer_reset (timer);
+		for (guint j = 0; j < loops; j++)
+			fu_common_crc8 (buf, sizes[i]);
+		elapsed[0] = g_timer_elapsed (timer, NULL);
+		g_timer_reset (timer);
+		for (guint j = 0; j < loops; j++)
+			fu_common_crc16 (buf, sizes[i]);
+		elapsed[1] = g_timer_elapsed (timer, NULL);
+		g_timer_reset (timer);
+		for (guint j = 0; j < loops; j++)
+			fu_common_crc32 (buf, sizes[i]);
+		elapsed[2] = g_timer_elapsed (timer, NULL);
+		g_test_message ("size=0x%x crc8=%.1fMB/s crc16=%.1fMB/s crc32=%.1fMB/s",
+				(guint) sizes[i],
+				64.f / elapsed[0],
+				64.f / elapsed[1],
+				64.f / elapsed[2]);
+	}
+}
+
+static void
+fu_common_checksums_progress_cb (goffset current, goffset total, gpointer user_data)
+{
+	goffset *last = (goffset *) user_data;
+	g_assert_cmpint (current, >, *last);
+	g_assert_cmpint (current, <=, total);
+	*last = current;
+}
+
+static void
+fu_common_checksums_func (void)
+{
+	gboolean ret;
+	gint fd;
+	goffset last = 0;
+	const GChecksumType kinds[] = { G_CHECKSUM_SHA1, G_CHECKSUM_SHA256 };
+	g_autofree gchar *fn = NULL;
+	g_autofree guint8 *buf = g_malloc (0x30003);
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) csums = NULL;
+	g_autoptr(GPtrArray) csums_file = NULL;
+
+	/* several blocks, and not a multiple of the block size */
+	for (guint i = 0; i < 0x30003; i++)
+		buf[i] = (guint8) (i * 7 + 3);
+	blob = g_bytes_new (buf, 0x30003);
+	csums = fu_common_checksums_for_bytes (blob, kinds, G_N_ELEMENTS (kinds),
+					       fu_common_checksums_progress_cb, &last);
+	g_assert_cmpint (csums->len, ==, G_N_ELEMENTS (kinds));
+	g_assert_cmpint (last, ==, 0x30003);
+	for (guint i = 0; i < G_N_ELEMENTS (kinds); i++) {
+		g_autofree gchar *csum = g_compute_checksum_for_bytes (kinds[i], blob);
+		g_assert_cmpstr (g_ptr_array_index (csums, i), ==, csum);
+	}
+
+	/* same from a mapped file */
+	fd = g_file_open_tmp ("fwupd-checksums-XXXXXX", &fn, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (fd, >=, 0);
+	g_close (fd, NULL);
+	ret = fu_common_set_contents_bytes (fn, blob, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	csums_file = fu_common_checksums_for_filename (fn, kinds, G_N_ELEMENTS (kinds),
+						       NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (csums_file);
+	for (guint i = 0; i < G_N_ELEMENTS (kinds); i++)
+		g_assert_cmpstr (g_ptr_array_index (csums_file, i), ==, g_ptr_array_index (csums, i));
+	g_unlink (fn);
+}
+
+static void
+fu_common_checksums_performance_func (void)
+{
+	const GChecksumType kinds[] = { G_CHECKSUM_SHA1, G_CHECKSUM_SHA256 };
+	g_autoptr(GBytes) blob = g_bytes_new_take (g_malloc0 (64 * 1024 * 1024), 64 * 1024 * 1024);
+	g_autoptr(GPtrArray) csums = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* one pass per digest */
+	for (guint i = 0; i < G_N_ELEMENTS (kinds); i++) {
+		g_autofree gchar *csum = g_compute_checksum_for_bytes (kinds[i], blob);
+		g_assert_nonnull (csum);
+	}
+	g_test_message ("separate=%.3fms", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* all digests in one pass */
+	g_timer_reset (timer);
+	csums = fu_common_checksums_for_bytes (blob, kinds, G_N_ELEMENTS (kinds), NULL, NULL);
+	g_assert_cmpint (csums->len, ==, G_N_ELEMENTS (kinds));
+	g_test_message ("single=%.3fms", g_timer_elapsed (timer, NULL) * 1000.f);
 }
 
 static void
@@ -422,6 +541,35 @@ fu_plugin_delay_func (void)
 	g_clear_object (&device_tmp);
 }
 
+static void
+fu_plugin_udev_subsystems_func (void)
+{
+	GPtrArray *subsystems;
+	g_autoptr(FuPlugin) plugin1 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin2 = fu_plugin_new ();
+	g_autoptr(GPtrArray) udev_subsystems = g_ptr_array_new_with_free_func (g_free);
+
+	/* both plugins share the daemon list */
+	fu_plugin_set_udev_subsystems (plugin1, udev_subsystems);
+	fu_plugin_set_udev_subsystems (plugin2, udev_subsystems);
+	g_assert_null (fu_plugin_get_udev_subsystems (plugin1));
+	fu_plugin_add_udev_subsystem (plugin1, "drm");
+	fu_plugin_add_udev_subsystem (plugin1, "drm");
+	fu_plugin_add_udev_subsystem (plugin2, "drm");
+	fu_plugin_add_udev_subsystem (plugin2, "block");
+	g_assert_cmpint (udev_subsystems->len, ==, 2);
+
+	/* but each only gets what it asked for */
+	subsystems = fu_plugin_get_udev_subsystems (plugin1);
+	g_assert_nonnull (subsystems);
+	g_assert_cmpint (subsystems->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (subsystems, 0), ==, "drm");
+	subsystems = fu_plugin_get_udev_subsystems (plugin2);
+	g_assert_nonnull (subsystems);
+	g_assert_cmpint (subsystems->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (subsystems, 1), ==, "block");
+}
+
 static void
 fu_plugin_quirks_func (void)
 {
@@ -476,6 +624,18 @@ fu_plugin_quirks_performance_func (void)
 		}
 	}
 	g_print ("lookup=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* lookup instance IDs with no quirks, which is the common case */
+	g_timer_reset (timer);
+	for (guint j = 0; j < 10000; j++) {
+		g_autofree gchar *group = NULL;
+		group = g_strdup_printf ("DeviceInstanceId=USB\\VID_FFFF&PID_%04X", j);
+		for (guint i = 0; keys[i] != NULL; i++) {
+			const gchar *tmp = fu_quirks_lookup_by_id (quirks, group, keys[i]);
+			g_assert_cmpstr (tmp, ==, NULL);
+		}
+	}
+	g_test_message ("lookup-missing=%.3fms", g_timer_elapsed (timer, NULL) * 1000.f);
 }
 
 static void
@@ -922,6 +1082,60 @@ fu_common_store_cab_folder_func (void)
 	g_assert_nonnull (blob_tmp);
 }
 
+static void
+fu_common_store_cab_unused_func (void)
+{
+	GBytes *blob_tmp;
+	GCabFile *cabfile;
+	GCabFolder *cabfolder;
+	GPtrArray *folders;
+	gboolean ret;
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) rel = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* payload is decompressed after the metadata, and README.txt never */
+	blob = _build_cab (GCAB_COMPRESSION_MSZIP,
+			   "README.txt", "hello",
+			   "acme.metainfo.xml",
+	"<component type=\"firmware\">\n"
+	"  <id>com.acme.example.firmware</id>\n"
+	"  <releases>\n"
+	"    <release version=\"1.2.3\"/>\n"
+	"  </releases>\n"
+	"</component>",
+			   "firmware.bin", "world",
+			   NULL);
+	fu_cabinet_set_size_max (cabinet, 10240);
+	ret = fu_cabinet_parse (cabinet, blob, FU_CABINET_PARSE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	silo = fu_cabinet_get_silo (cabinet);
+	g_assert_nonnull (silo);
+
+	/* the contents of README.txt were never kept */
+	folders = gcab_cabinet_get_folders (fu_cabinet_get_gcab_cabinet (cabinet));
+	g_assert_cmpint (folders->len, ==, 1);
+	cabfolder = g_ptr_array_index (folders, 0);
+	cabfile = gcab_folder_get_file_by_name (cabfolder, "README.txt");
+	g_assert_nonnull (cabfile);
+	g_assert_null (gcab_file_get_bytes (cabfile));
+	cabfile = gcab_folder_get_file_by_name (cabfolder, "firmware.bin");
+	g_assert_nonnull (cabfile);
+	g_assert_nonnull (gcab_file_get_bytes (cabfile));
+
+	/* verify */
+	rel = xb_silo_query_first (silo, "components/component/releases/release", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (rel);
+	blob_tmp = xb_node_get_data (rel, "fwupd::FirmwareBlob");
+	g_assert_nonnull (blob_tmp);
+	g_assert_cmpint (g_bytes_get_size (blob_tmp), ==, 5);
+	g_assert_cmpint (memcmp (g_bytes_get_data (blob_tmp, NULL), "world", 5), ==, 0);
+}
+
 static void
 fu_common_store_cab_error_no_metadata_func (void)
 {
@@ -1065,6 +1279,95 @@ fu_device_poll_func (void)
 	g_assert_cmpint (fu_device_get_metadata_integer (device, "cnt"), ==, cnt);
 }
 
+static gboolean
+fu_device_probe_cache_setup_cb (FuDevice *device, GError **error)
+{
+	guint64 cnt = fu_device_get_metadata_integer (device, "cnt");
+	const gchar *icon = fu_device_get_metadata (device, "icon");
+	fu_device_set_metadata_integer (device, "cnt", cnt + 1);
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.3");
+	fu_device_set_serial (device, "ABC123");
+	if (icon != NULL)
+		fu_device_add_icon (device, icon);
+	return TRUE;
+}
+
+static void
+fu_device_probe_cache_func (void)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuProbeCache) probe_cache1 = fu_probe_cache_new ();
+	g_autoptr(FuProbeCache) probe_cache2 = fu_probe_cache_new ();
+	g_autoptr(FuProbeCache) probe_cache3 = fu_probe_cache_new ();
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *filename = NULL;
+	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (device1);
+
+	/* first run uses the hardware */
+	klass->setup = fu_device_probe_cache_setup_cb;
+	fu_device_set_metadata_integer (device1, "cnt", 0);
+	fu_device_set_metadata (device1, "icon", "colorimeter");
+	fu_device_set_physical_id (device1, "usb:01:02");
+	fu_device_add_instance_id (device1, "USB\\VID_273F&PID_1004");
+	fu_probe_cache_set_state (probe_cache1, "state1");
+	fu_device_set_probe_cache (device1, probe_cache1);
+	ret = fu_device_setup (device1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_device_get_metadata_integer (device1, "cnt"), ==, 1);
+	g_assert_false (fu_device_get_setup_cached (device1));
+	g_assert_cmpint (fu_probe_cache_get_misses (probe_cache1), ==, 1);
+	filename = g_build_filename ("/tmp/fwupd-self-test", "probe.cache", NULL);
+	ret = fu_probe_cache_save (probe_cache1, filename, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* firmware was updated since the last run */
+	fu_probe_cache_set_state (probe_cache3, "state2");
+	ret = fu_probe_cache_load (probe_cache3, filename, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* second run uses the saved state */
+	fu_probe_cache_set_state (probe_cache2, "state1");
+	ret = fu_probe_cache_load (probe_cache2, filename, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_device_set_metadata_integer (device2, "cnt", 0);
+	fu_device_set_physical_id (device2, "usb:01:02");
+	fu_device_add_instance_id (device2, "USB\\VID_273F&PID_1004");
+	fu_device_set_probe_cache (device2, probe_cache2);
+	ret = fu_device_setup (device2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_device_get_metadata_integer (device2, "cnt"), ==, 0);
+	g_assert_true (fu_device_get_setup_cached (device2));
+	g_assert_cmpint (fu_probe_cache_get_hits (probe_cache2), ==, 1);
+	g_assert_cmpstr (fu_device_get_version (device2), ==, "1.2.3");
+	g_assert_cmpstr (fu_device_get_serial (device2), ==, "ABC123");
+	g_assert_cmpint (fu_device_get_icons (device2)->len, ==, 1);
+
+	/* set by the engine after the hit */
+	fu_device_add_flag (device2, FWUPD_DEVICE_FLAG_SUPPORTED);
+
+	/* revalidating uses the hardware, which no longer reports the icon */
+	ret = fu_device_revalidate_setup (device2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_device_get_metadata_integer (device2, "cnt"), ==, 1);
+	g_assert_false (fu_device_get_setup_cached (device2));
+	g_assert_cmpstr (fu_device_get_version (device2), ==, "1.2.3");
+	g_assert_cmpstr (fu_device_get_serial (device2), ==, "ABC123");
+	g_assert_cmpint (fu_device_get_icons (device2)->len, ==, 0);
+	g_assert_true (fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_SUPPORTED));
+	klass->setup = NULL;
+	g_unlink (filename);
+}
+
 static void
 fu_device_func (void)
 {
@@ -1213,6 +1516,92 @@ fu_chunk_func (void)
 					   "#05: page:02 addr:0004 len:02 ZZ\n");
 }
 
+static void
+fu_chunk_iter_func (void)
+{
+	struct {
+		const gchar *data;
+		guint32 addr_start;
+		guint32 page_sz;
+		guint32 packet_sz;
+	} items[] = {
+		{ "123456",		0x0,	3,	3 },
+		{ "123456",		0x4,	4,	4 },
+		{ "0123456789abcdef",	0x0,	10,	4 },
+		{ "XXXXXXYYYYYYZZZZZZ",	0x0,	6,	4 },
+		{ "XXXXXXYYYYYYZZZZZZ",	0x2,	6,	0 },
+		{ "XXXXXXYYYYYYZZZZZZ",	0x100,	0,	5 },
+		{ "X",			0x0,	0,	0 },
+		{ NULL,			0x0,	0,	0 }
+	};
+
+	/* the iterator returns the same chunks as the array */
+	for (guint i = 0; items[i].data != NULL; i++) {
+		FuChunk chk;
+		FuChunkIter iter;
+		guint32 data_sz = (guint32) strlen (items[i].data);
+		guint cnt = 0;
+		g_autoptr(GPtrArray) chunks = NULL;
+
+		chunks = fu_chunk_array_new ((const guint8 *) items[i].data, data_sz,
+					     items[i].addr_start,
+					     items[i].page_sz,
+					     items[i].packet_sz);
+		fu_chunk_iter_init (&iter, (const guint8 *) items[i].data, data_sz,
+				    items[i].addr_start,
+				    items[i].page_sz,
+				    items[i].packet_sz);
+		g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, chunks->len);
+		while (fu_chunk_iter_next (&iter, &chk)) {
+			FuChunk *chk_tmp = g_ptr_array_index (chunks, cnt++);
+			g_assert_cmpint (chk.idx, ==, chk_tmp->idx);
+			g_assert_cmpint (chk.page, ==, chk_tmp->page);
+			g_assert_cmpint (chk.address, ==, chk_tmp->address);
+			g_assert (chk.data == chk_tmp->data);
+			g_assert_cmpint (chk.data_sz, ==, chk_tmp->data_sz);
+		}
+		g_assert_cmpint (cnt, ==, chunks->len);
+	}
+}
+
+static void
+fu_chunk_diff_func (void)
+{
+	const gchar *data_old = "AAAABBBBCCCCDDDD";
+	const gchar *data_new = "AAAAXBBBCCCCDDDZEEEE";
+	guint32 bytes_written = 0;
+	g_autofree gchar *chunks_str = NULL;
+	g_autoptr(GPtrArray) chunks = NULL;
+	g_autoptr(GPtrArray) chunks_same = NULL;
+	g_autoptr(GPtrArray) chunks_blank = NULL;
+
+	/* only the changed blocks, and the new one at the end */
+	chunks = fu_chunk_array_new_diff ((const guint8 *) data_old, (guint32) strlen (data_old),
+					  (const guint8 *) data_new, (guint32) strlen (data_new),
+					  0x0, 4, 0);
+	chunks_str = fu_chunk_array_to_string (chunks);
+	g_assert_cmpstr (chunks_str, ==, "#01: page:01 addr:0000 len:04 XBBB\n"
+					 "#03: page:03 addr:0000 len:04 DDDZ\n"
+					 "#04: page:04 addr:0000 len:04 EEEE\n");
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		bytes_written += chk->data_sz;
+	}
+	g_assert_cmpint (bytes_written, ==, 12);
+
+	/* nothing to do */
+	chunks_same = fu_chunk_array_new_diff ((const guint8 *) data_old, (guint32) strlen (data_old),
+					       (const guint8 *) data_old, (guint32) strlen (data_old),
+					       0x0, 4, 0);
+	g_assert_cmpint (chunks_same->len, ==, 0);
+
+	/* no existing data, so everything is written */
+	chunks_blank = fu_chunk_array_new_diff (NULL, 0,
+						(const guint8 *) data_old, (guint32) strlen (data_old),
+						0x0, 4, 0);
+	g_assert_cmpint (chunks_blank->len, ==, 4);
+}
+
 static void
 fu_common_strstrip_func (void)
 {
@@ -1605,6 +1994,123 @@ fu_firmware_srec_tokenization_func (void)
 	g_assert_cmpint (rcd->buf->data[0], ==, 0x50);
 }
 
+static void
+fu_firmware_strparse_hex_func (void)
+{
+	gboolean ret;
+	guint8 buf[4] = { 0x0 };
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_firmware_strparse_hex ("00aBcDfF", buf, sizeof(buf), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (buf[0], ==, 0x00);
+	g_assert_cmpint (buf[1], ==, 0xab);
+	g_assert_cmpint (buf[2], ==, 0xcd);
+	g_assert_cmpint (buf[3], ==, 0xff);
+
+	/* not NUL terminated */
+	ret = fu_firmware_strparse_hex ("1234XX", buf, 2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (buf[1], ==, 0x34);
+
+	/* invalid */
+	ret = fu_firmware_strparse_hex ("12G4", buf, 2, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_false (ret);
+}
+
+static GBytes *
+fu_firmware_performance_payload (void)
+{
+	gsize bufsz = 4 * 1024 * 1024;
+	guint8 *buf = g_malloc (bufsz);
+	for (gsize i = 0; i < bufsz; i++)
+		buf[i] = (guint8) (i * 7);
+	return g_bytes_new_take (buf, bufsz);
+}
+
+static void
+fu_firmware_ihex_performance_func (void)
+{
+	gboolean ret;
+	gsize bufsz;
+	g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmware) firmware_verify = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GBytes) data_bin = fu_firmware_performance_payload ();
+	g_autoptr(GBytes) data_fw = NULL;
+	g_autoptr(GBytes) data_hex = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* build a large image */
+	img = fu_firmware_image_new (data_bin);
+	fu_firmware_add_image (firmware, img);
+	data_hex = fu_firmware_write (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_hex);
+
+	/* parse it back */
+	bufsz = g_bytes_get_size (data_hex);
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware_verify, data_hex, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_test_message ("%.1fMB/s", (bufsz / (1024.f * 1024.f)) / g_timer_elapsed (timer, NULL));
+	data_fw = fu_firmware_get_image_default_bytes (firmware_verify, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_fw);
+	ret = fu_common_bytes_compare (data_fw, data_bin, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
+static void
+fu_firmware_srec_performance_func (void)
+{
+	gboolean ret;
+	gsize bufsz = 0;
+	const guint8 *buf;
+	g_autoptr(FuFirmware) firmware = fu_srec_firmware_new ();
+	g_autoptr(GBytes) data_bin = fu_firmware_performance_payload ();
+	g_autoptr(GBytes) data_fw = NULL;
+	g_autoptr(GBytes) data_srec = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) str = g_string_new ("S00600004844521B\n");
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* S3 records with 32 bytes of data each */
+	buf = g_bytes_get_data (data_bin, &bufsz);
+	for (gsize i = 0; i < bufsz; i += 32) {
+		guint8 csum = 32 + 4 + 1;
+		g_string_append_printf (str, "S3%02X%08X", 32 + 4 + 1, (guint) i);
+		for (guint j = 0; j < 4; j++)
+			csum += (guint8) (i >> (j * 8));
+		for (guint j = 0; j < 32; j++) {
+			g_string_append_printf (str, "%02X", buf[i + j]);
+			csum += buf[i + j];
+		}
+		g_string_append_printf (str, "%02X\n", (guint) (csum ^ 0xff));
+	}
+	g_string_append (str, "S70500000000FA\n");
+	data_srec = g_bytes_new (str->str, str->len);
+
+	/* parse it */
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware, data_srec, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_test_message ("%.1fMB/s", (str->len / (1024.f * 1024.f)) / g_timer_elapsed (timer, NULL));
+	data_fw = fu_firmware_get_image_default_bytes (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_fw);
+	ret = fu_common_bytes_compare (data_fw, data_bin, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
 static void
 fu_firmware_build_func (void)
 {
@@ -2109,12 +2615,20 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/fwupd/security-attrs{hsi}", fu_security_attrs_hsi_func);
 	g_test_add_func ("/fwupd/plugin{delay}", fu_plugin_delay_func);
+	g_test_add_func ("/fwupd/plugin{udev-subsystems}", fu_plugin_udev_subsystems_func);
 	g_test_add_func ("/fwupd/plugin{quirks}", fu_plugin_quirks_func);
 	g_test_add_func ("/fwupd/plugin{quirks-performance}", fu_plugin_quirks_performance_func);
 	g_test_add_func ("/fwupd/plugin{quirks-device}", fu_plugin_quirks_device_func);
 	g_test_add_func ("/fwupd/chunk", fu_chunk_func);
+	g_test_add_func ("/fwupd/chunk{iter}", fu_chunk_iter_func);
+	g_test_add_func ("/fwupd/chunk{diff}", fu_chunk_diff_func);
 	g_test_add_func ("/fwupd/common{byte-array}", fu_common_byte_array_func);
 	g_test_add_func ("/fwupd/common{crc}", fu_common_crc_func);
+	if (g_test_slow ())
+		g_test_add_func ("/fwupd/common{crc-performance}", fu_common_crc_performance_func);
+	g_test_add_func ("/fwupd/common{checksums}", fu_common_checksums_func);
+	if (g_test_slow ())
+		g_test_add_func ("/fwupd/common{checksums-performance}", fu_common_checksums_performance_func);
 	g_test_add_func ("/fwupd/common{string-append-kv}", fu_common_string_append_kv_func);
 	g_test_add_func ("/fwupd/common{version-guess-format}", fu_common_version_guess_format_func);
 	g_test_add_func ("/fwupd/common{version}", fu_common_version_func);
@@ -2124,6 +2638,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{cab-success}", fu_common_store_cab_func);
 	g_test_add_func ("/fwupd/common{cab-success-unsigned}", fu_common_store_cab_unsigned_func);
 	g_test_add_func ("/fwupd/common{cab-success-folder}", fu_common_store_cab_folder_func);
+	g_test_add_func ("/fwupd/common{cab-success-unused}", fu_common_store_cab_unused_func);
 	g_test_add_func ("/fwupd/common{cab-error-no-metadata}", fu_common_store_cab_error_no_metadata_func);
 	g_test_add_func ("/fwupd/common{cab-error-wrong-size}", fu_common_store_cab_error_wrong_size_func);
 	g_test_add_func ("/fwupd/common{cab-error-wrong-checksum}", fu_common_store_cab_error_wrong_checksum_func);
@@ -2141,11 +2656,16 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/firmware", fu_firmware_func);
 	g_test_add_func ("/fwupd/firmware{dedupe}", fu_firmware_dedupe_func);
 	g_test_add_func ("/fwupd/firmware{build}", fu_firmware_build_func);
+	g_test_add_func ("/fwupd/firmware{strparse-hex}", fu_firmware_strparse_hex_func);
 	g_test_add_func ("/fwupd/firmware{ihex}", fu_firmware_ihex_func);
 	g_test_add_func ("/fwupd/firmware{ihex-offset}", fu_firmware_ihex_offset_func);
 	g_test_add_func ("/fwupd/firmware{ihex-signed}", fu_firmware_ihex_signed_func);
 	g_test_add_func ("/fwupd/firmware{srec-tokenization}", fu_firmware_srec_tokenization_func);
 	g_test_add_func ("/fwupd/firmware{srec}", fu_firmware_srec_func);
+	if (g_test_slow ()) {
+		g_test_add_func ("/fwupd/firmware{ihex-performance}", fu_firmware_ihex_performance_func);
+		g_test_add_func ("/fwupd/firmware{srec-performance}", fu_firmware_srec_performance_func);
+	}
 	g_test_add_func ("/fwupd/firmware{dfu}", fu_firmware_dfu_func);
 	g_test_add_func ("/fwupd/archive{invalid}", fu_archive_invalid_func);
 	g_test_add_func ("/fwupd/archive{cab}", fu_archive_cab_func);
@@ -2155,6 +2675,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/device{incorporate}", fu_device_incorporate_func);
 	if (g_test_slow ())
 		g_test_add_func ("/fwupd/device{poll}", fu_device_poll_func);
+	g_test_add_func ("/fwupd/device{probe-cache}", fu_device_probe_cache_func);
 	g_test_add_func ("/fwupd/device-locker{success}", fu_device_locker_func);
 	g_test_add_func ("/fwupd/device-locker{fail}", fu_device_locker_fail_func);
 	g_test_add_func ("/fwupd/device{metadata}", fu_device_metadata_func);
@@ -10,7 +10,6 @@
 
 #include <string.h>
 
-#include "fu-common.h"
 #include "fu-firmware-common.h"
 #include "fu-srec-firmware.h"
 
@@ -87,24 +86,31 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 	FuSrecFirmware *self = FU_SREC_FIRMWARE (firmware);
 	const gchar *data;
 	gboolean got_eof = FALSE;
+	gboolean verbose = g_getenv ("FWUPD_SREC_VERBOSE") != NULL;
+	gsize offset = 0;
 	gsize sz = 0;
-	g_auto(GStrv) lines = NULL;
 
-	/* parse records */
+	/* parse records, walking the lines in place rather than splitting a copy */
 	data = g_bytes_get_data (fw, &sz);
-	lines = fu_common_strnsplit (data, sz, "\n", -1);
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
+	for (guint ln = 0; offset < sz; ln++) {
 		FuSrecFirmwareRecord *rcd;
-		const gchar *line = lines[ln];
-		gsize linesz;
-		guint32 rec_addr32;
+		const gchar *line = data + offset;
+		const gchar *eol = memchr (line, '\n', sz - offset);
+		gsize linesz = eol != NULL ? (gsize) (eol - line) : sz - offset;
+		guint8 buf[0xff] = { 0x0 };	/* address, data, checksum */
+		guint32 rec_addr32 = 0;
 		guint8 addrsz = 0;		/* bytes */
-		guint8 rec_count;		/* words */
+		guint8 rec_count = 0;		/* words */
 		guint8 rec_kind;
 
 		/* ignore blank lines */
-		g_strdelimit (lines[ln], "\r", '\0');
-		linesz = strlen (line);
+		offset += linesz + 1;
+		for (gsize i = 0; i < linesz; i++) {
+			if (line[i] == '\r' || line[i] == '\0') {
+				linesz = i;
+				break;
+			}
+		}
 		if (linesz == 0)
 			continue;
 
@@ -130,8 +136,11 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 
 		/* kind, count, address, (data), checksum, linefeed */
 		rec_kind = line[1] - '0';
-		rec_count = fu_firmware_strparse_uint8 (line + 2);
-		if (rec_count * 2 != linesz - 4) {
+		if (!fu_firmware_strparse_hex (line + 2, &rec_count, 1, error)) {
+			g_prefix_error (error, "invalid count at line %u: ", ln + 1);
+			return FALSE;
+		}
+		if ((gsize) rec_count * 2 != linesz - 4) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
@@ -141,14 +150,19 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			return FALSE;
 		}
 
+		/* decode the rest of the record in one go */
+		if (!fu_firmware_strparse_hex (line + 4, buf, rec_count, error)) {
+			g_prefix_error (error, "invalid record at line %u: ", ln + 1);
+			return FALSE;
+		}
+
 		/* checksum check */
 		if ((flags & FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM) == 0) {
-			guint8 rec_csum = 0;
-			guint8 rec_csum_expected;
-			for (guint8 i = 0; i < rec_count; i++)
-				rec_csum += fu_firmware_strparse_uint8 (line + (i * 2) + 2);
+			guint8 rec_csum = rec_count;
+			guint8 rec_csum_expected = buf[rec_count - 1];
+			for (guint8 i = 0; i < rec_count - 1; i++)
+				rec_csum += buf[i];
 			rec_csum ^= 0xff;
-			rec_csum_expected = fu_firmware_strparse_uint8 (line + (rec_count * 2) + 2);
 			if (rec_csum != rec_csum_expected) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -202,33 +216,30 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			return FALSE;
 		}
 
-		/* parse address */
-		switch (addrsz) {
-		case 2:
-			rec_addr32 = fu_firmware_strparse_uint16 (line + 4);
-			break;
-		case 3:
-			rec_addr32 = fu_firmware_strparse_uint24 (line + 4);
-			break;
-		case 4:
-			rec_addr32 = fu_firmware_strparse_uint32 (line + 4);
-			break;
-		default:
-			g_assert_not_reached ();
+		/* address and checksum */
+		if (rec_count < addrsz + 1) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "record too short at line %u, count %u",
+				     ln + 1, (guint) rec_count);
+			return FALSE;
 		}
 
-		g_debug ("line %03u S%u addr:0x%04x datalen:0x%02x",
-			 ln + 1, rec_kind, rec_addr32,
-			 (guint) rec_count - addrsz - 1);
+		/* parse address */
+		for (guint8 i = 0; i < addrsz; i++)
+			rec_addr32 = (rec_addr32 << 8) | buf[i];
+
+		if (verbose) {
+			g_debug ("line %03u S%u addr:0x%04x datalen:0x%02x",
+				 ln + 1, rec_kind, rec_addr32,
+				 (guint) rec_count - addrsz - 1);
+		}
 
 		/* data */
 		rcd = fu_srec_firmware_record_new (ln + 1, rec_kind, rec_addr32);
-		if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3) {
-			for (guint8 i = 4 + (addrsz * 2); i <= rec_count * 2; i += 2) {
-				guint8 tmp = fu_firmware_strparse_uint8 (line + i);
-				fu_byte_array_append_uint8 (rcd->buf, tmp);
-			}
-		}
+		if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3)
+			g_byte_array_append (rcd->buf, buf + addrsz, rec_count - addrsz - 1);
 		g_ptr_array_add (self->records, rcd);
 	}
 
@@ -256,9 +267,17 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 	guint16 data_cnt = 0;
 	guint32 addr32_last = 0;
 	guint32 img_address = 0;
+	guint outbufsz = 0;
 	g_autoptr(FuFirmwareImage) img = fu_firmware_image_new (NULL);
 	g_autoptr(GBytes) img_bytes = NULL;
-	g_autoptr(GByteArray) outbuf = g_byte_array_new ();
+	g_autoptr(GByteArray) outbuf = NULL;
+
+	/* only the holes can make the image any larger than this */
+	for (guint j = 0; j < self->records->len; j++) {
+		FuSrecFirmwareRecord *rcd = g_ptr_array_index (self->records, j);
+		outbufsz += rcd->buf->len;
+	}
+	outbuf = g_byte_array_sized_new (outbufsz);
 
 	/* parse records */
 	for (guint j = 0; j < self->records->len; j++) {
@@ -345,10 +364,11 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 					return FALSE;
 				}
 				if (addr32_last > 0x0 && len_hole > 1) {
+					guint outbuf_len = outbuf->len;
 					g_debug ("filling address 0x%08x to 0x%08x at line %u",
 						 addr32_last + 1, addr32_last + len_hole - 1, rcd->ln);
-					for (guint i = 0; i < len_hole; i++)
-						fu_byte_array_append_uint8 (outbuf, 0xff);
+					g_byte_array_set_size (outbuf, outbuf_len + len_hole);
+					memset (outbuf->data + outbuf_len, 0xff, len_hole);
 				}
 
 				/* add data */
@@ -362,7 +382,7 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 	}
 
 	/* add single image */
-	img_bytes = g_bytes_new (outbuf->data, outbuf->len);
+	img_bytes = g_byte_array_free_to_bytes (g_steal_pointer (&outbuf));
 	fu_firmware_image_set_bytes (img, img_bytes);
 	fu_firmware_image_set_addr (img, img_address);
 	fu_firmware_add_image (firmware, img);
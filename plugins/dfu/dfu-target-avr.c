@@ -502,7 +502,9 @@ dfu_target_avr_download_element (DfuTarget *target,
 	guint16 page_last = G_MAXUINT16;
 	guint32 address;
 	guint32 address_offset = 0x0;
-	g_autoptr(GPtrArray) chunks = NULL;
+	guint32 chunks_cnt;
+	FuChunk chk_tmp;
+	FuChunkIter iter;
 	const guint8 footer[] = { 0x00, 0x00, 0x00, 0x00,	/* CRC */
 				  16,				/* len */
 				  'D', 'F', 'U',		/* signature */
@@ -555,18 +557,20 @@ dfu_target_avr_download_element (DfuTarget *target,
 
 	/* chunk up the memory space into pages */
 	data = g_bytes_get_data (blob, NULL);
-	chunks = fu_chunk_array_new (data + address_offset,
-				     g_bytes_get_size (blob) - address_offset,
-				     dfu_sector_get_address (sector),
-				     ATMEL_64KB_PAGE,
-				     ATMEL_MAX_TRANSFER_SIZE);
+	fu_chunk_iter_init (&iter,
+			    data + address_offset,
+			    g_bytes_get_size (blob) - address_offset,
+			    dfu_sector_get_address (sector),
+			    ATMEL_64KB_PAGE,
+			    ATMEL_MAX_TRANSFER_SIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 
 	/* update UI */
 	dfu_target_set_action (target, FWUPD_STATUS_DEVICE_WRITE);
 
 	/* process each chunk */
-	for (guint i = 0; i < chunks->len; i++) {
-		const FuChunk *chk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk_tmp)) {
+		const FuChunk *chk = &chk_tmp;
 		g_autofree guint8 *buf = NULL;
 		g_autoptr(GBytes) chunk_tmp = NULL;
 
@@ -600,11 +604,11 @@ dfu_target_avr_download_element (DfuTarget *target,
 		chunk_tmp = g_bytes_new_static (buf, chk->data_sz + header_sz + sizeof(footer));
 		g_debug ("sending %" G_GSIZE_FORMAT " bytes to the hardware",
 			 g_bytes_get_size (chunk_tmp));
-		if (!dfu_target_download_chunk (target, i, chunk_tmp, error))
+		if (!dfu_target_download_chunk (target, chk->idx, chunk_tmp, error))
 			return FALSE;
 
 		/* update UI */
-		dfu_target_set_percentage (target, i + 1, chunks->len);
+		dfu_target_set_percentage (target, chk->idx + 1, chunks_cnt);
 	}
 
 	/* done */
@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "fu-chunk.h"
+
 #include "dfu-common.h"
 #include "dfu-sector.h"
 #include "dfu-target-stm.h"
@@ -245,9 +247,12 @@ dfu_target_stm_download_element (DfuTarget *target,
 	GBytes *bytes;
 	guint nr_chunks;
 	guint zone_last = G_MAXUINT;
+	guint i_base = 0;
+	guint i_next = 0;
 	guint16 transfer_size = dfu_device_get_transfer_size (device);
 	g_autoptr(GPtrArray) sectors_array = NULL;
 	g_autoptr(GHashTable) sectors_hash = NULL;
+	g_autoptr(GHashTable) chunks_changed = NULL;
 
 	/* round up as we have to transfer incomplete blocks */
 	bytes = dfu_element_get_contents (element);
@@ -261,6 +266,42 @@ dfu_target_stm_download_element (DfuTarget *target,
 		return FALSE;
 	}
 
+	/* only write the chunks that are different to what is on the device */
+	if (fu_device_has_custom_flag (FU_DEVICE (device), "differential-write")) {
+		g_autoptr(DfuElement) element_old = NULL;
+		g_autoptr(GError) error_local = NULL;
+		element_old = dfu_target_stm_upload_element (target,
+							     dfu_element_get_address (element),
+							     g_bytes_get_size (bytes),
+							     0, /* maximum_size */
+							     &error_local);
+		if (element_old == NULL) {
+			g_debug ("failed to read existing image, writing everything: %s",
+				 error_local->message);
+		} else {
+			gsize bufsz = 0;
+			gsize bufsz_old = 0;
+			const guint8 *buf = g_bytes_get_data (bytes, &bufsz);
+			const guint8 *buf_old;
+			g_autoptr(GPtrArray) chunks = NULL;
+
+			buf_old = g_bytes_get_data (dfu_element_get_contents (element_old),
+						    &bufsz_old);
+			chunks = fu_chunk_array_new_diff (buf_old, (guint32) bufsz_old,
+							  buf, (guint32) bufsz,
+							  dfu_element_get_address (element),
+							  0x0, transfer_size);
+			chunks_changed = g_hash_table_new (g_direct_hash, g_direct_equal);
+			for (guint i = 0; i < chunks->len; i++) {
+				FuChunk *chk = g_ptr_array_index (chunks, i);
+				g_hash_table_insert (chunks_changed,
+						     GUINT_TO_POINTER (chk->idx),
+						     GINT_TO_POINTER (1));
+			}
+			g_debug ("%u of %u chunks changed", chunks->len, nr_chunks);
+		}
+	}
+
 	/* 1st pass: work out which sectors need erasing */
 	sectors_array = g_ptr_array_new ();
 	sectors_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -288,8 +329,10 @@ dfu_target_stm_download_element (DfuTarget *target,
 			return FALSE;
 		}
 
-		/* if it's erasable and not yet blanked */
+		/* if it's erasable, has changed, and not yet blanked */
 		if (dfu_sector_has_cap (sector, DFU_SECTOR_CAP_ERASEABLE) &&
+		    (chunks_changed == NULL ||
+		     g_hash_table_contains (chunks_changed, GUINT_TO_POINTER (i))) &&
 		    g_hash_table_lookup (sectors_hash, sector) == NULL) {
 			g_hash_table_insert (sectors_hash,
 					     sector,
@@ -332,6 +375,26 @@ dfu_target_stm_download_element (DfuTarget *target,
 		sector = dfu_target_get_sector_for_addr (target, offset_dev);
 		g_assert (sector != NULL);
 
+		/* unchanged, and the sector it is in was not erased */
+		if (chunks_changed != NULL &&
+		    !g_hash_table_contains (chunks_changed, GUINT_TO_POINTER (i)) &&
+		    g_hash_table_lookup (sectors_hash, sector) == NULL)
+			continue;
+
+		/* skipped some chunks, so the block number restarts at the
+		 * new address */
+		if (i != i_next) {
+			g_debug ("setting address to 0x%04x",
+				 (guint) offset_dev);
+			if (!dfu_target_stm_set_address (target,
+							 (guint32) offset_dev,
+							 error))
+				return FALSE;
+			zone_last = dfu_sector_get_zone (sector);
+			i_base = i;
+		}
+		i_next = i + 1;
+
 		/* manually set the sector address */
 		if (dfu_sector_get_zone (sector) != zone_last) {
 			g_debug ("setting address to 0x%04x",
@@ -353,7 +416,7 @@ dfu_target_stm_download_element (DfuTarget *target,
 			 g_bytes_get_size (bytes_tmp));
 		/* ST uses wBlockNum=0 for DfuSe commands and wBlockNum=1 is reserved */
 		if (!dfu_target_download_chunk (target,
-						(guint8) (i + 2),
+						(guint8) (i - i_base + 2),
 						bytes_tmp,
 						error))
 			return FALSE;
@@ -31,6 +31,8 @@
 #include "fwupd-error.h"
 
 #define DFU_TARGET_MANIFEST_MAX_POLLING_TRIES	200
+#define DFU_TARGET_DNBUSY_MAX_POLLING_TRIES	1000
+#define DFU_TARGET_DNBUSY_POLL_MIN		1	/* ms */
 
 static void dfu_target_finalize			 (GObject *object);
 
@@ -715,6 +717,42 @@ dfu_target_mass_erase (DfuTarget *target, GError **error)
 	return klass->mass_erase (target, error);
 }
 
+/* poll until the device leaves dfuDNBUSY, only sleeping for what is left of
+ * the bwPollTimeout once the time spent since the GetStatus reply is taken
+ * into account */
+static gboolean
+dfu_target_download_chunk_wait (DfuTarget *target, GError **error)
+{
+	DfuTargetPrivate *priv = GET_PRIVATE (target);
+	guint polling_count = 0;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	while (dfu_device_get_state (priv->device) == DFU_STATE_DFU_DNBUSY) {
+		guint64 elapsed = (guint64) (g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC);
+		guint64 poll_timeout;
+
+		/* a device returning a zero bwPollTimeout must not be hammered */
+		poll_timeout = MAX (dfu_device_get_download_timeout (priv->device),
+				    DFU_TARGET_DNBUSY_POLL_MIN) * 1000;
+		if (polling_count++ > DFU_TARGET_DNBUSY_MAX_POLLING_TRIES) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INTERNAL,
+					     "device stayed in dfuDNBUSY");
+			return FALSE;
+		}
+		if (poll_timeout > elapsed) {
+			g_debug ("sleeping for %" G_GUINT64_FORMAT "us…",
+				 poll_timeout - elapsed);
+			g_usleep (poll_timeout - elapsed);
+		}
+		if (!dfu_device_refresh (priv->device, error))
+			return FALSE;
+		g_timer_reset (timer);
+	}
+	return TRUE;
+}
+
 gboolean
 dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GError **error)
 {
@@ -754,11 +792,19 @@ dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GErr
 		return FALSE;
 	}
 
-	/* for STM32 devices, the action only occurs when we do GetStatus */
-	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE) {
-		if (!dfu_device_refresh (priv->device, error))
-			return FALSE;
+	/* for STM32 devices the action only occurs when we do GetStatus, and
+	 * the reply tells us how long to wait before asking again -- so ask
+	 * straight away rather than sleeping for the bwPollTimeout of the
+	 * previous chunk; other devices may not expect this */
+	if (dfu_device_get_version (priv->device) != DFU_VERSION_DFUSE &&
+	    !fu_device_has_custom_flag (FU_DEVICE (priv->device), "get-status-after-download") &&
+	    dfu_device_get_download_timeout (priv->device) > 0) {
+		g_debug ("sleeping for %ums…",
+			 dfu_device_get_download_timeout (priv->device));
+		g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
 	}
+	if (!dfu_device_refresh (priv->device, error))
+		return FALSE;
 
 	/* wait for the device to write contents to the EEPROM */
 	if (g_bytes_get_size (bytes) == 0 &&
@@ -766,14 +812,7 @@ dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GErr
 		dfu_target_set_action (target, FWUPD_STATUS_IDLE);
 		dfu_target_set_action (target, FWUPD_STATUS_DEVICE_BUSY);
 	}
-	if (dfu_device_get_download_timeout (priv->device) > 0) {
-		g_debug ("sleeping for %ums…",
-			 dfu_device_get_download_timeout (priv->device));
-		g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
-	}
-
-	/* find out if the write was successful */
-	if (!dfu_device_refresh (priv->device, error))
+	if (!dfu_target_download_chunk_wait (target, error))
 		return FALSE;
 
 	g_assert (actual_length == g_bytes_get_size (bytes));
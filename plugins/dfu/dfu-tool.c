@@ -885,9 +885,11 @@ static gboolean
 dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 {
 	FwupdInstallFlags flags = FWUPD_INSTALL_FLAG_NONE;
+	gdouble elapsed;
 	g_autoptr(DfuDevice) device = NULL;
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(FuDeviceLocker) locker  = NULL;
+	g_autoptr(GTimer) timer = NULL;
 
 	/* check args */
 	if (g_strv_length (values) < 1) {
@@ -934,8 +936,10 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 			  G_CALLBACK (fu_tool_action_changed_cb), priv);
 	g_signal_connect (device, "notify::progress",
 			  G_CALLBACK (fu_tool_action_changed_cb), priv);
+	timer = g_timer_new ();
 	if (!fu_device_write_firmware (FU_DEVICE (device), fw, flags, error))
 		return FALSE;
+	elapsed = g_timer_elapsed (timer, NULL);
 
 	/* do host reset */
 	if (!fu_device_attach (FU_DEVICE (device), error))
@@ -949,6 +953,10 @@ dfu_tool_write (DfuToolPrivate *priv, gchar **values, GError **error)
 	/* success */
 	g_print ("%u bytes successfully downloaded to device\n",
 		 (guint) g_bytes_get_size (fw));
+	if (elapsed > 0.f) {
+		g_print ("Transfer took %.2fs (%.1f KB/s)\n", elapsed,
+			 (gdouble) g_bytes_get_size (fw) / (elapsed * 1024.f));
+	}
 	return TRUE;
 }
 
@@ -15,12 +15,6 @@
 /* From kernel linux/major.h */
 #define MMC_BLOCK_MAJOR			179
 
-/* From kernel linux/mmc/mmc.h */
-#define MMC_SWITCH			6	/* ac	[31:0] See below	R1b */
-#define MMC_SEND_EXT_CSD		8	/* adtc				R1  */
-#define MMC_SWITCH_MODE_WRITE_BYTE	0x03	/* Set target to value */
-#define MMC_WRITE_BLOCK			24	/* adtc [31:0] data addr	R1  */
-
 /* From kernel linux/mmc/core.h */
 #define MMC_RSP_PRESENT	(1 << 0)
 #define MMC_RSP_CRC	(1 << 2)		/* expect valid crc */
@@ -311,74 +305,95 @@ fu_emmc_device_prepare_firmware (FuDevice *device,
 	return fu_firmware_new_from_bytes (fw);
 }
 
-static gboolean
-fu_emmc_device_write_firmware (FuDevice *device,
-			       FuFirmware *firmware,
-			       FwupdInstallFlags flags,
-			       GError **error)
+static void
+fu_emmc_device_set_mode_cmd (struct mmc_ioc_cmd *cmd, guint8 mode)
 {
-	FuEmmcDevice *self= FU_EMMC_DEVICE (device);
-	gsize fw_size = 0;
-	gsize total_done;
-	guint32 arg;
-	guint32 sect_done = 0;
-	guint8 ext_csd[512];
-	guint failure_cnt = 0;
-	g_autofree struct mmc_ioc_multi_cmd *multi_cmd = NULL;
-	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
-
-	if (!fu_emmc_read_extcsd (FU_EMMC_DEVICE (device), ext_csd, sizeof (ext_csd), error))
-		return FALSE;
-
-	fw = fu_firmware_get_image_default_bytes (firmware, error);
-	if (fw == NULL)
-		return FALSE;
-	fw_size = g_bytes_get_size (fw);
+	cmd->opcode = MMC_SWITCH;
+	cmd->arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
+		   (EXT_CSD_MODE_CONFIG << 16) |
+		   (mode << 8) |
+		    EXT_CSD_CMD_SET_NORMAL;
+	cmd->flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	cmd->write_flag = 1;
+}
 
-	/* set CMD ARG */
-	arg = ext_csd[EXT_CSD_FFU_ARG_0] |
-	      ext_csd[EXT_CSD_FFU_ARG_1] << 8 |
-	      ext_csd[EXT_CSD_FFU_ARG_2] << 16 |
-	      ext_csd[EXT_CSD_FFU_ARG_3] << 24;
+static guint32
+fu_emmc_device_get_sect_done (const guint8 *ext_csd)
+{
+	return ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_0] |
+	       ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_1] << 8 |
+	       ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_2] << 16 |
+	       ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_3] << 24;
+}
 
-	/* prepare multi_cmd to be sent */
+/* enters FFU mode, writes as many MMC_WRITE_MULTIPLE_BLOCK batches as the
+ * kernel allows in one ioctl starting from @offset, and then exits FFU mode */
+struct mmc_ioc_multi_cmd *
+fu_emmc_device_ffu_multi_cmd_new (const guint8 *buf,
+				  gsize bufsz,
+				  guint32 sect_size,
+				  guint32 arg,
+				  gsize *offset)
+{
+	gsize batchsz = (MMC_IOC_MAX_BYTES / sect_size) * sect_size;
+	gsize offset_tmp = *offset;
+	guint num_of_cmds = 2;
+	struct mmc_ioc_multi_cmd *multi_cmd;
+
+	/* each batch needs the block count setting and then the data */
+	while (offset_tmp < bufsz && num_of_cmds + 2 <= MMC_IOC_MAX_CMDS) {
+		offset_tmp += MIN (bufsz - offset_tmp, batchsz);
+		num_of_cmds += 2;
+	}
 	multi_cmd = g_malloc0 (sizeof(struct mmc_ioc_multi_cmd) +
-			       3 * sizeof(struct mmc_ioc_cmd));
-	multi_cmd->num_of_cmds = 3;
+			       num_of_cmds * sizeof(struct mmc_ioc_cmd));
+	multi_cmd->num_of_cmds = num_of_cmds;
 
 	/* put device into ffu mode */
-	multi_cmd->cmds[0].opcode = MMC_SWITCH;
-	multi_cmd->cmds[0].arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-				 (EXT_CSD_MODE_CONFIG << 16) |
-				 (EXT_CSD_FFU_MODE << 8) |
-				  EXT_CSD_CMD_SET_NORMAL;
-	multi_cmd->cmds[0].flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-	multi_cmd->cmds[0].write_flag = 1;
-
-	/* send image chunk */
-	multi_cmd->cmds[1].opcode = MMC_WRITE_BLOCK;
-	multi_cmd->cmds[1].blksz = self->sect_size;
-	multi_cmd->cmds[1].blocks = 1;
-	multi_cmd->cmds[1].arg = arg;
-	multi_cmd->cmds[1].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-	multi_cmd->cmds[1].write_flag = 1;
+	fu_emmc_device_set_mode_cmd (&multi_cmd->cmds[0], EXT_CSD_FFU_MODE);
+
+	/* send image in batches, using a predefined block count so that the
+	 * kernel does not have to send STOP_TRANSMISSION */
+	for (guint i = 1; i < num_of_cmds - 1; i += 2) {
+		guint32 blocks = MIN (bufsz - *offset, batchsz) / sect_size;
+		multi_cmd->cmds[i].opcode = MMC_SET_BLOCK_COUNT;
+		multi_cmd->cmds[i].arg = blocks;
+		multi_cmd->cmds[i].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_AC;
+		multi_cmd->cmds[i + 1].opcode = MMC_WRITE_MULTIPLE_BLOCK;
+		multi_cmd->cmds[i + 1].blksz = sect_size;
+		multi_cmd->cmds[i + 1].blocks = blocks;
+		multi_cmd->cmds[i + 1].arg = arg;
+		multi_cmd->cmds[i + 1].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+		multi_cmd->cmds[i + 1].write_flag = 1;
+		mmc_ioc_cmd_set_data (multi_cmd->cmds[i + 1], buf + *offset);
+		*offset += (gsize) blocks * sect_size;
+	}
 
 	/* return device into normal mode */
-	multi_cmd->cmds[2].opcode = MMC_SWITCH;
-	multi_cmd->cmds[2].arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-				 (EXT_CSD_MODE_CONFIG << 16) |
-				 (EXT_CSD_NORMAL_MODE << 8) |
-				  EXT_CSD_CMD_SET_NORMAL;
-	multi_cmd->cmds[2].flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-	multi_cmd->cmds[2].write_flag = 1;
+	fu_emmc_device_set_mode_cmd (&multi_cmd->cmds[num_of_cmds - 1], EXT_CSD_NORMAL_MODE);
+	return multi_cmd;
+}
+
+/* one ioctl for each sector, entering and leaving FFU mode each time */
+static gboolean
+fu_emmc_device_write_single (FuEmmcDevice *self,
+			     struct mmc_ioc_multi_cmd *multi_cmd,
+			     GBytes *fw,
+			     guint8 *ext_csd,
+			     gsize ext_csd_sz,
+			     guint32 *sect_done,
+			     GError **error)
+{
+	guint failure_cnt = 0;
+	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* build packets */
 	chunks = fu_chunk_array_new_from_bytes (fw,
 						0x00,	/* start addr */
 						0x00,	/* page_sz */
 						self->sect_size);
-	while (sect_done == 0) {
+	*sect_done = 0;
+	while (*sect_done == 0) {
 		for (guint i = 0; i < chunks->len; i++) {
 			FuChunk *chk = g_ptr_array_index (chunks, i);
 
@@ -395,15 +410,12 @@ fu_emmc_device_write_firmware (FuDevice *device,
 				return FALSE;
 			}
 
-			if (!fu_emmc_read_extcsd (self, ext_csd, sizeof (ext_csd), error))
+			if (!fu_emmc_read_extcsd (self, ext_csd, ext_csd_sz, error))
 				return FALSE;
 
 			/* if we need to restart the download */
-			sect_done = ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_0] |
-				    ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_1] << 8 |
-				    ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_2] << 16 |
-				    ext_csd[EXT_CSD_NUM_OF_FW_SEC_PROG_3] << 24;
-			if (sect_done == 0) {
+			*sect_done = fu_emmc_device_get_sect_done (ext_csd);
+			if (*sect_done == 0) {
 				if (failure_cnt >= 3) {
 					g_set_error_literal (error,
 							     G_IO_ERROR,
@@ -417,8 +429,127 @@ fu_emmc_device_write_firmware (FuDevice *device,
 			}
 
 			/* update progress */
-			fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len - 1);
+			fu_device_set_progress_full (FU_DEVICE (self), (gsize) i, (gsize) chunks->len - 1);
+		}
+	}
+	return TRUE;
+}
+
+/* enter FFU mode once and write many blocks in each ioctl */
+static gboolean
+fu_emmc_device_write_multiple (FuEmmcDevice *self,
+			       struct mmc_ioc_cmd *cmd_normal,
+			       GBytes *fw,
+			       guint32 arg,
+			       guint8 *ext_csd,
+			       gsize ext_csd_sz,
+			       guint32 *sect_done,
+			       GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+	guint failure_cnt = 0;
+
+	*sect_done = 0;
+	while (*sect_done == 0) {
+		gsize offset = 0;
+		while (offset < bufsz) {
+			g_autofree struct mmc_ioc_multi_cmd *multi_cmd = NULL;
+			multi_cmd = fu_emmc_device_ffu_multi_cmd_new (buf, bufsz,
+								      self->sect_size,
+								      arg, &offset);
+			g_debug ("sending %u commands", (guint) multi_cmd->num_of_cmds);
+			if (!fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
+						   MMC_IOC_MULTI_CMD, (guint8 *) multi_cmd,
+						   NULL, error)) {
+				g_prefix_error (error, "multi-cmd failed: ");
+				/* multi-cmd ioctl failed before exiting from ffu mode */
+				fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
+						      MMC_IOC_CMD, (guint8 *) cmd_normal,
+						      NULL, NULL);
+				return FALSE;
+			}
+			fu_device_set_progress_full (FU_DEVICE (self), offset, bufsz);
 		}
+
+		/* if we need to restart the download */
+		if (!fu_emmc_read_extcsd (self, ext_csd, ext_csd_sz, error))
+			return FALSE;
+		*sect_done = fu_emmc_device_get_sect_done (ext_csd);
+		if (*sect_done == 0) {
+			if (failure_cnt >= 3) {
+				g_set_error_literal (error,
+						     G_IO_ERROR,
+						     G_IO_ERROR_FAILED,
+						     "programming failed");
+				return FALSE;
+			}
+			failure_cnt++;
+			g_debug ("programming failed: retrying (%u)", failure_cnt);
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_emmc_device_write_firmware (FuDevice *device,
+			       FuFirmware *firmware,
+			       FwupdInstallFlags flags,
+			       GError **error)
+{
+	FuEmmcDevice *self= FU_EMMC_DEVICE (device);
+	gsize fw_size = 0;
+	gsize total_done;
+	guint32 arg;
+	guint32 sect_done = 0;
+	guint8 ext_csd[512];
+	g_autofree struct mmc_ioc_multi_cmd *multi_cmd = NULL;
+	g_autoptr(GBytes) fw = NULL;
+
+	if (!fu_emmc_read_extcsd (FU_EMMC_DEVICE (device), ext_csd, sizeof (ext_csd), error))
+		return FALSE;
+
+	fw = fu_firmware_get_image_default_bytes (firmware, error);
+	if (fw == NULL)
+		return FALSE;
+	fw_size = g_bytes_get_size (fw);
+
+	/* set CMD ARG */
+	arg = ext_csd[EXT_CSD_FFU_ARG_0] |
+	      ext_csd[EXT_CSD_FFU_ARG_1] << 8 |
+	      ext_csd[EXT_CSD_FFU_ARG_2] << 16 |
+	      ext_csd[EXT_CSD_FFU_ARG_3] << 24;
+
+	/* prepare multi_cmd to be sent */
+	multi_cmd = g_malloc0 (sizeof(struct mmc_ioc_multi_cmd) +
+			       3 * sizeof(struct mmc_ioc_cmd));
+	multi_cmd->num_of_cmds = 3;
+
+	/* put device into ffu mode */
+	fu_emmc_device_set_mode_cmd (&multi_cmd->cmds[0], EXT_CSD_FFU_MODE);
+
+	/* send image chunk */
+	multi_cmd->cmds[1].opcode = MMC_WRITE_BLOCK;
+	multi_cmd->cmds[1].blksz = self->sect_size;
+	multi_cmd->cmds[1].blocks = 1;
+	multi_cmd->cmds[1].arg = arg;
+	multi_cmd->cmds[1].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	multi_cmd->cmds[1].write_flag = 1;
+
+	/* return device into normal mode */
+	fu_emmc_device_set_mode_cmd (&multi_cmd->cmds[2], EXT_CSD_NORMAL_MODE);
+
+	/* some cards cannot do multiple block writes in FFU mode */
+	if (fu_device_has_custom_flag (device, "ffu-single-block")) {
+		if (!fu_emmc_device_write_single (self, multi_cmd, fw,
+						  ext_csd, sizeof (ext_csd),
+						  &sect_done, error))
+			return FALSE;
+	} else {
+		if (!fu_emmc_device_write_multiple (self, &multi_cmd->cmds[2], fw, arg,
+						    ext_csd, sizeof (ext_csd),
+						    &sect_done, error))
+			return FALSE;
 	}
 
 	/* sanity check */
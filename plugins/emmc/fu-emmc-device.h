@@ -6,7 +6,31 @@
 
 #pragma once
 
+#include <linux/mmc/ioctl.h>
+
 #include "fu-plugin.h"
 
+/* From kernel linux/mmc/mmc.h */
+#define MMC_SWITCH			6	/* ac	[31:0] See below	R1b */
+#define MMC_SEND_EXT_CSD		8	/* adtc				R1  */
+#define MMC_SWITCH_MODE_WRITE_BYTE	0x03	/* Set target to value */
+#define MMC_SET_BLOCK_COUNT		23	/* adtc [31:0] data addr	R1  */
+#define MMC_WRITE_BLOCK			24	/* adtc [31:0] data addr	R1  */
+#define MMC_WRITE_MULTIPLE_BLOCK	25	/* adtc [31:0] data addr	R1  */
+
+/* From kernel linux/mmc/ioctl.h, not defined in older headers */
+#ifndef MMC_IOC_MAX_BYTES
+#define MMC_IOC_MAX_BYTES		(512L * 256)
+#endif
+#ifndef MMC_IOC_MAX_CMDS
+#define MMC_IOC_MAX_CMDS		255
+#endif
+
 #define FU_TYPE_EMMC_DEVICE (fu_emmc_device_get_type ())
 G_DECLARE_FINAL_TYPE (FuEmmcDevice, fu_emmc_device, FU, EMMC_DEVICE, FuUdevDevice)
+
+struct mmc_ioc_multi_cmd *fu_emmc_device_ffu_multi_cmd_new	(const guint8	*buf,
+								 gsize		 bufsz,
+								 guint32	 sect_size,
+								 guint32	 arg,
+								 gsize		*offset);
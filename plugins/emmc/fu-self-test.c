@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#include "config.h"
+
+#include <fwupd.h>
+
+#include "fu-emmc-device.h"
+
+static void
+fu_emmc_multi_cmd_func (void)
+{
+	gsize bufsz = 3 * 1024 * 1024;
+	gsize offset = 0;
+	guint ioctls = 0;
+	guint cmds = 0;
+	g_autofree guint8 *buf = g_malloc0 (bufsz);
+
+	/* a 3MB image, which would be 6144 ioctls one sector at a time */
+	while (offset < bufsz) {
+		g_autofree struct mmc_ioc_multi_cmd *multi_cmd = NULL;
+		multi_cmd = fu_emmc_device_ffu_multi_cmd_new (buf, bufsz, 512, 0xdead, &offset);
+		g_assert_cmpint (multi_cmd->num_of_cmds, <=, MMC_IOC_MAX_CMDS);
+
+		/* enters and leaves FFU mode once */
+		g_assert_cmpint (multi_cmd->cmds[0].opcode, ==, MMC_SWITCH);
+		g_assert_cmpint (multi_cmd->cmds[multi_cmd->num_of_cmds - 1].opcode, ==, MMC_SWITCH);
+		for (guint i = 1; i < multi_cmd->num_of_cmds - 1; i += 2) {
+			g_assert_cmpint (multi_cmd->cmds[i].opcode, ==, MMC_SET_BLOCK_COUNT);
+			g_assert_cmpint (multi_cmd->cmds[i + 1].opcode, ==, MMC_WRITE_MULTIPLE_BLOCK);
+			g_assert_cmpint (multi_cmd->cmds[i + 1].arg, ==, 0xdead);
+			g_assert_cmpint (multi_cmd->cmds[i].arg, ==, multi_cmd->cmds[i + 1].blocks);
+			g_assert_cmpint (multi_cmd->cmds[i + 1].blksz * multi_cmd->cmds[i + 1].blocks,
+					 <=, MMC_IOC_MAX_BYTES);
+		}
+		cmds += multi_cmd->num_of_cmds;
+		ioctls++;
+	}
+	g_assert_cmpint (offset, ==, bufsz);
+	g_assert_cmpint (ioctls, ==, 1);
+	g_assert_cmpint (cmds, ==, 2 + 2 * (bufsz / MMC_IOC_MAX_BYTES));
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	/* only critical and error are fatal */
+	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
+
+	/* tests go here */
+	g_test_add_func ("/fwupd/multi-cmd", fu_emmc_multi_cmd_func);
+	return g_test_run ();
+}
@@ -15,10 +15,20 @@
 
 #define FU_NVME_ID_CTRL_SIZE	0x1000
 
+/* the minimum memory page size is in the CAP register, which we cannot read,
+ * but it is always 4kB in practice */
+#define FU_NVME_PAGE_SIZE		0x1000
+
+/* large MDTS values are capped below what the kernel allows for each
+ * passthru command */
+#define FU_NVME_MAX_TRANSFER_SIZE	0x100000
+
 struct _FuNvmeDevice {
 	FuUdevDevice		 parent_instance;
 	guint			 pci_depth;
 	guint64			 write_block_size;
+	guint64			 fw_granularity;
+	guint64			 max_transfer_size;
 };
 
 G_DEFINE_TYPE (FuNvmeDevice, fu_nvme_device, FU_TYPE_UDEV_DEVICE)
@@ -28,6 +38,10 @@ fu_nvme_device_to_string (FuUdevDevice *device, guint idt, GString *str)
 {
 	FuNvmeDevice *self = FU_NVME_DEVICE (device);
 	fu_common_string_append_ku (str, idt, "PciDepth", self->pci_depth);
+	fu_common_string_append_kx (str, idt, "FwGranularity", self->fw_granularity);
+	fu_common_string_append_kx (str, idt, "MaxTransferSize", self->max_transfer_size);
+	fu_common_string_append_kx (str, idt, "TransferSize",
+				    fu_nvme_device_get_transfer_size (self));
 }
 
 /* @addr_start and @addr_end are *inclusive* to match the NMVe specification */
@@ -183,11 +197,47 @@ fu_nvme_device_parse_cns_maybe_dell (FuNvmeDevice *self, const guint8 *buf)
 		fu_device_add_guid (FU_DEVICE (self), guid_efi);
 }
 
+/* the largest firmware download that can be sent in one command, limited by
+ * MDTS and aligned to FWUG unless overridden by the NvmeBlockSize quirk;
+ * returns 0 if FWUG is larger than MDTS as no size satisfies both */
+guint64
+fu_nvme_device_get_transfer_size (FuNvmeDevice *self)
+{
+	guint64 transfer_size;
+
+	/* quirked */
+	if (self->write_block_size > 0)
+		return self->write_block_size;
+
+	/* no limit set by the controller, so use one page or the granularity
+	 * as always done before MDTS was used */
+	if (self->max_transfer_size == 0)
+		return MAX (self->fw_granularity, FU_NVME_PAGE_SIZE);
+
+	/* each download has to be a multiple of the granularity */
+	transfer_size = MIN (self->max_transfer_size, FU_NVME_MAX_TRANSFER_SIZE);
+	if (self->fw_granularity > 0)
+		transfer_size -= transfer_size % self->fw_granularity;
+	return transfer_size;
+}
+
+/* the size the image is padded to when using force-align, which is the
+ * quirked block size or the granularity, but never the transfer size as a
+ * larger MDTS would otherwise pad the image with up to 1MB of 0xff */
+guint64
+fu_nvme_device_get_align_size (FuNvmeDevice *self)
+{
+	if (self->write_block_size > 0)
+		return self->write_block_size;
+	return MAX (self->fw_granularity, FU_NVME_PAGE_SIZE);
+}
+
 static gboolean
 fu_nvme_device_parse_cns (FuNvmeDevice *self, const guint8 *buf, gsize sz, GError **error)
 {
 	guint8 fawr;
 	guint8 fwug;
+	guint8 mdts;
 	guint8 nfws;
 	guint8 s1ro;
 	g_autofree gchar *gu = NULL;
@@ -217,10 +267,15 @@ fu_nvme_device_parse_cns (FuNvmeDevice *self, const guint8 *buf, gsize sz, GErro
 	if (sr != NULL)
 		fu_device_set_version (FU_DEVICE (self), sr);
 
+	/* maximum data transfer size (MDTS), as a power of two pages */
+	mdts = buf[77];
+	if (mdts != 0x00 && mdts < 32)
+		self->max_transfer_size = ((guint64) FU_NVME_PAGE_SIZE) << mdts;
+
 	/* firmware update granularity (FWUG) */
 	fwug = buf[319];
 	if (fwug != 0x00 && fwug != 0xff)
-		self->write_block_size = ((guint64) fwug) * 0x1000;
+		self->fw_granularity = ((guint64) fwug) * 0x1000;
 
 	/* firmware slot information */
 	fawr = (buf[260] & 0x10) >> 4;
@@ -311,11 +366,24 @@ fu_nvme_device_write_firmware (FuDevice *device,
 			       GError **error)
 {
 	FuNvmeDevice *self = FU_NVME_DEVICE (device);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autoptr(GBytes) fw2 = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
-	guint64 block_size = self->write_block_size > 0 ?
-			     self->write_block_size : 0x1000;
+	guint64 block_size = fu_nvme_device_get_transfer_size (self);
+
+	/* controller limits cannot both be met */
+	if (block_size == 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "firmware update granularity 0x%x larger than "
+			     "maximum data transfer size 0x%x, set NvmeBlockSize",
+			     (guint) self->fw_granularity,
+			     (guint) self->max_transfer_size);
+		return FALSE;
+	}
 
 	/* get default image */
 	fw = fu_firmware_get_image_default_bytes (firmware, error);
@@ -325,30 +393,29 @@ fu_nvme_device_write_firmware (FuDevice *device,
 	/* some vendors provide firmware files whose sizes are not multiples
 	 * of blksz *and* the device won't accept blocks of different sizes */
 	if (fu_device_has_custom_flag (device, "force-align")) {
-		fw2 = fu_common_bytes_align (fw, block_size, 0xff);
+		fw2 = fu_common_bytes_align (fw, fu_nvme_device_get_align_size (self), 0xff);
 	} else {
 		fw2 = g_bytes_ref (fw);
 	}
 
-	/* build packets */
-	chunks = fu_chunk_array_new_from_bytes (fw2,
-						0x00,		/* start_addr */
-						0x00,		/* page_sz */
-						block_size);	/* block size */
-
-	/* write each block */
+	/* write each block directly from the firmware buffer */
+	fu_chunk_iter_init_from_bytes (&iter, fw2,
+				       0x00,			/* start_addr */
+				       0x00,			/* page_sz */
+				       (guint32) block_size);	/* block size */
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	g_debug ("writing %u blocks of 0x%x", chunks_cnt, (guint) block_size);
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (!fu_nvme_device_fw_download (self,
-						 chk->address,
-						 chk->data,
-						 chk->data_sz,
+						 chk.address,
+						 chk.data,
+						 chk.data_sz,
 						 error)) {
-			g_prefix_error (error, "failed to write chunk %u: ", i);
+			g_prefix_error (error, "failed to write chunk %u: ", chk.idx);
 			return FALSE;
 		}
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len + 1);
+		fu_device_set_progress_full (device, (gsize) chk.idx, (gsize) chunks_cnt + 1);
 	}
 
 	/* commit */
@@ -14,3 +14,5 @@ G_DECLARE_FINAL_TYPE (FuNvmeDevice, fu_nvme_device, FU, NVME_DEVICE, FuUdevDevic
 FuNvmeDevice	*fu_nvme_device_new_from_blob		(const guint8	*buf,
 							 gsize		 sz,
 							 GError		**error);
+guint64		 fu_nvme_device_get_transfer_size	(FuNvmeDevice	*self);
+guint64		 fu_nvme_device_get_align_size		(FuNvmeDevice	*self);
@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <string.h>
 
 #include "fu-device-private.h"
 #include "fu-nvme-device.h"
@@ -78,6 +79,44 @@ fu_nvme_cns_all_func (void)
 	}
 }
 
+static void
+fu_nvme_transfer_size_func (void)
+{
+	struct {
+		guint8 mdts;
+		guint8 fwug;
+		guint64 transfer_size;
+		guint64 align_size;
+	} items[] = {
+		{ 5,	0x00,	0x20000,	0x1000 },	/* MDTS only */
+		{ 5,	0x03,	0x1e000,	0x3000 },	/* aligned down to FWUG */
+		{ 12,	0x00,	0x100000,	0x1000 },	/* capped */
+		{ 0,	0xff,	0x1000,		0x1000 },	/* no limits */
+		{ 0,	0x04,	0x4000,		0x4000 },	/* FWUG only */
+		{ 1,	0x04,	0,		0x4000 },	/* FWUG larger than MDTS */
+	};
+
+	for (guint i = 0; i < G_N_ELEMENTS (items); i++) {
+		guint8 buf[0x1000] = { 0x0 };
+		g_autoptr(FuNvmeDevice) dev = NULL;
+		g_autoptr(GError) error = NULL;
+
+		/* canned identify controller data */
+		memcpy (buf + 4, "SERIAL", 6);
+		memcpy (buf + 24, "MODEL", 5);
+		memcpy (buf + 64, "1.2.3", 5);
+		buf[77] = items[i].mdts;
+		buf[319] = items[i].fwug;
+		dev = fu_nvme_device_new_from_blob (buf, sizeof(buf), &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (dev);
+		g_assert_cmpint (fu_nvme_device_get_transfer_size (dev), ==, items[i].transfer_size);
+
+		/* force-align pads to the granularity, not the transfer size */
+		g_assert_cmpint (fu_nvme_device_get_align_size (dev), ==, items[i].align_size);
+	}
+}
+
 int
 main (int argc, char **argv)
 {
@@ -89,5 +128,6 @@ main (int argc, char **argv)
 	/* tests go here */
 	g_test_add_func ("/fwupd/cns", fu_nvme_cns_func);
 	g_test_add_func ("/fwupd/cns{all}", fu_nvme_cns_all_func);
+	g_test_add_func ("/fwupd/transfer-size", fu_nvme_transfer_size_func);
 	return g_test_run ();
 }
@@ -12,8 +12,13 @@
 #include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
+/* other plugins also trigger a recoldplug, so only fetch the inventory again
+ * after this many seconds unless a device has been updated */
+#define FU_REDFISH_RECOLDPLUG_INTERVAL	60
+
 struct FuPluginData {
 	FuRedfishClient		*client;
+	gint64			 coldplug_time;
 };
 
 gboolean
@@ -25,7 +30,12 @@ fu_plugin_update (FuPlugin *plugin,
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 
-	return fu_redfish_client_update (data->client, device, blob_fw, error);
+	if (!fu_redfish_client_update (data->client, device, blob_fw, error))
+		return FALSE;
+
+	/* the inventory has changed */
+	data->coldplug_time = 0;
+	return TRUE;
 }
 
 gboolean
@@ -42,6 +52,57 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		FuDevice *device = g_ptr_array_index (devices, i);
 		fu_plugin_device_add (plugin, device);
 	}
+	data->coldplug_time = g_get_monotonic_time ();
+	return TRUE;
+}
+
+static gboolean
+fu_plugin_redfish_has_device_id (GPtrArray *devices, const gchar *id)
+{
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_id (device), id) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+fu_plugin_recoldplug (FuPlugin *plugin, GError **error)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	GPtrArray *devices;
+	gint64 elapsed;
+	g_autoptr(GPtrArray) devices_old = NULL;
+
+	/* fetched recently enough */
+	elapsed = g_get_monotonic_time () - data->coldplug_time;
+	if (data->coldplug_time > 0 &&
+	    elapsed < FU_REDFISH_RECOLDPLUG_INTERVAL * G_USEC_PER_SEC) {
+		g_debug ("inventory fetched %" G_GINT64_FORMAT "s ago, ignoring",
+			 elapsed / G_USEC_PER_SEC);
+		return TRUE;
+	}
+
+	/* the client replaces its devices, so keep the old ones */
+	devices_old = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	devices = fu_redfish_client_get_devices (data->client);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_ptr_array_add (devices_old, g_object_ref (device));
+	}
+
+	/* unchanged resources are not downloaded again thanks to the ETag */
+	if (!fu_plugin_coldplug (plugin, error))
+		return FALSE;
+
+	/* remove any devices no longer in the inventory */
+	devices = fu_redfish_client_get_devices (data->client);
+	for (guint i = 0; i < devices_old->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices_old, i);
+		if (!fu_plugin_redfish_has_device_id (devices, fu_device_get_id (device)))
+			fu_plugin_device_remove (plugin, device);
+	}
 	return TRUE;
 }
 
@@ -118,6 +179,7 @@ fu_plugin_init (FuPlugin *plugin)
 	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 	data->client = fu_redfish_client_new ();
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+	fu_plugin_add_thread_flag (plugin, FU_PLUGIN_THREAD_FLAG_COLDPLUG);
 }
 
 void
@@ -19,6 +19,9 @@
 #include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
+/* maximum number of requests in flight at any one time */
+#define FU_REDFISH_CLIENT_MAX_REQUESTS		8
+
 struct _FuRedfishClient
 {
 	GObject			 parent_instance;
@@ -32,9 +35,16 @@ struct _FuRedfishClient
 	gboolean		 auth_created;
 	gboolean		 use_https;
 	gboolean		 cacheck;
+	gboolean		 expand_supported;
 	GPtrArray		*devices;
+	GHashTable		*etags;		/* uri_path:FuRedfishClientEtag */
 };
 
+typedef struct {
+	gchar			*etag;
+	GBytes			*blob;
+} FuRedfishClientEtag;
+
 G_DEFINE_TYPE (FuRedfishClient, fu_redfish_client, G_TYPE_OBJECT)
 
 static void
@@ -59,17 +69,29 @@ fu_redfish_client_set_auth (FuRedfishClient *self, SoupURI *uri,
 	}
 }
 
-static GBytes *
-fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+static void
+fu_redfish_client_etag_free (FuRedfishClientEtag *item)
 {
-	guint status_code;
-	g_autoptr(SoupMessage) msg = NULL;
+	g_free (item->etag);
+	g_bytes_unref (item->blob);
+	g_free (item);
+}
+
+static SoupMessage *
+fu_redfish_client_new_message (FuRedfishClient *self, const gchar *uri_path, GError **error)
+{
+	FuRedfishClientEtag *item;
+	SoupMessage *msg;
+	g_auto(GStrv) split = NULL;
 	g_autoptr(SoupURI) uri = NULL;
 
-	/* create URI */
+	/* create URI, which may include a query */
+	split = g_strsplit (uri_path, "?", 2);
 	uri = soup_uri_new (NULL);
 	soup_uri_set_scheme (uri, self->use_https ? "https" : "http");
-	soup_uri_set_path (uri, uri_path);
+	soup_uri_set_path (uri, split[0]);
+	if (split[1] != NULL)
+		soup_uri_set_query (uri, split[1]);
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
 	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
@@ -82,17 +104,155 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 		return NULL;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_autofree gchar *tmp = soup_uri_to_string (uri, FALSE);
+
+	/* only download the resource again if it has changed */
+	item = g_hash_table_lookup (self->etags, uri_path);
+	if (item != NULL) {
+		soup_message_headers_append (msg->request_headers,
+					     "If-None-Match", item->etag);
+	}
+	return msg;
+}
+
+static GBytes *
+fu_redfish_client_process_message (FuRedfishClient *self,
+				   const gchar *uri_path,
+				   SoupMessage *msg,
+				   GError **error)
+{
+	FuRedfishClientEtag *item;
+	const gchar *etag;
+	GBytes *blob;
+
+	/* use the copy from last time */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		item = g_hash_table_lookup (self->etags, uri_path);
+		if (item != NULL)
+			return g_bytes_ref (item->blob);
+	}
+	if (msg->status_code != SOUP_STATUS_OK) {
+		g_autofree gchar *tmp = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to download %s: %s",
-			     tmp, soup_status_get_phrase (status_code));
+			     tmp, soup_status_get_phrase (msg->status_code));
 		return NULL;
 	}
-	return g_bytes_new (msg->response_body->data, msg->response_body->length);
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+
+	/* save for the next coldplug */
+	etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	if (etag != NULL) {
+		item = g_new0 (FuRedfishClientEtag, 1);
+		item->etag = g_strdup (etag);
+		item->blob = g_bytes_ref (blob);
+		g_hash_table_insert (self->etags, g_strdup (uri_path), item);
+	}
+	return blob;
+}
+
+static GBytes *
+fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+{
+	g_autoptr(SoupMessage) msg = NULL;
+
+	msg = fu_redfish_client_new_message (self, uri_path, error);
+	if (msg == NULL)
+		return NULL;
+	soup_session_send_message (self->session, msg);
+	return fu_redfish_client_process_message (self, uri_path, msg, error);
+}
+
+typedef struct {
+	FuRedfishClient		*self;
+	GPtrArray		*uri_paths;	/* (element-type utf8) */
+	GPtrArray		*blobs;		/* (element-type GBytes) */
+	guint			 idx;
+	guint			 in_flight;
+	GError			*error;
+} FuRedfishClientFetchHelper;
+
+typedef struct {
+	FuRedfishClientFetchHelper *helper;
+	guint			 idx;
+} FuRedfishClientFetchItem;
+
+static void fu_redfish_client_fetch_queue (FuRedfishClientFetchHelper *helper);
+
+static void
+fu_redfish_client_fetch_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientFetchItem *item = (FuRedfishClientFetchItem *) user_data;
+	FuRedfishClientFetchHelper *helper = item->helper;
+	const gchar *uri_path = g_ptr_array_index (helper->uri_paths, item->idx);
+	GBytes *blob;
+	g_autoptr(GError) error_local = NULL;
+
+	helper->in_flight--;
+	blob = fu_redfish_client_process_message (helper->self, uri_path,
+						  msg, &error_local);
+	if (blob != NULL) {
+		g_bytes_unref (g_ptr_array_index (helper->blobs, item->idx));
+		helper->blobs->pdata[item->idx] = blob;
+	} else if (helper->error == NULL) {
+		helper->error = g_steal_pointer (&error_local);
+	}
+	g_free (item);
+
+	/* keep the pipeline full */
+	fu_redfish_client_fetch_queue (helper);
+}
+
+static void
+fu_redfish_client_fetch_queue (FuRedfishClientFetchHelper *helper)
+{
+	while (helper->error == NULL &&
+	       helper->in_flight < FU_REDFISH_CLIENT_MAX_REQUESTS &&
+	       helper->idx < helper->uri_paths->len) {
+		const gchar *uri_path = g_ptr_array_index (helper->uri_paths, helper->idx);
+		FuRedfishClientFetchItem *item;
+		SoupMessage *msg;
+
+		msg = fu_redfish_client_new_message (helper->self, uri_path, &helper->error);
+		if (msg == NULL)
+			return;
+		item = g_new0 (FuRedfishClientFetchItem, 1);
+		item->helper = helper;
+		item->idx = helper->idx++;
+		helper->in_flight++;
+		soup_session_queue_message (helper->self->session, msg,
+					    fu_redfish_client_fetch_cb, item);
+	}
+}
+
+/* fetches all the URIs, with a bounded number of requests in flight, and
+ * returns the data in the same order */
+static GPtrArray *
+fu_redfish_client_fetch_data_multiple (FuRedfishClient *self,
+				       GPtrArray *uri_paths,
+				       GError **error)
+{
+	FuRedfishClientFetchHelper helper = { self, uri_paths, NULL, 0, 0, NULL };
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GPtrArray) blobs = NULL;
+
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	for (guint i = 0; i < uri_paths->len; i++)
+		g_ptr_array_add (blobs, g_bytes_new (NULL, 0));
+	helper.blobs = blobs;
+
+	/* the session dispatches the callbacks in the thread-default context */
+	g_main_context_push_thread_default (context);
+	fu_redfish_client_fetch_queue (&helper);
+	while (helper.in_flight > 0)
+		g_main_context_iteration (context, TRUE);
+	g_main_context_pop_thread_default (context);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return NULL;
+	}
+	return g_steal_pointer (&blobs);
 }
 
 static gboolean
@@ -157,15 +317,22 @@ fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 	JsonArray *members;
 	JsonNode *node_root;
 	JsonObject *member;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) uri_paths = g_ptr_array_new ();
 
 	members = json_object_get_array_member (collection, "Members");
 	for (guint i = 0; i < json_array_get_length (members); i++) {
-		g_autoptr(JsonParser) parser = json_parser_new ();
-		g_autoptr(GBytes) blob = NULL;
 		JsonObject *member_id;
 		const gchar *member_uri;
 
 		member_id = json_array_get_object_element (members, i);
+
+		/* already expanded by the service */
+		if (json_object_has_member (member_id, "Id")) {
+			if (!fu_redfish_client_coldplug_member (self, member_id, error))
+				return FALSE;
+			continue;
+		}
 		member_uri = json_object_get_string_member (member_id, "@odata.id");
 		if (member_uri == NULL) {
 			g_set_error_literal (error,
@@ -174,11 +341,16 @@ fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 					     "no @odata.id string");
 			return FALSE;
 		}
+		g_ptr_array_add (uri_paths, (gpointer) member_uri);
+	}
 
-		/* try to connect */
-		blob = fu_redfish_client_fetch_data (self, member_uri, error);
-		if (blob == NULL)
-			return FALSE;
+	/* try to connect */
+	blobs = fu_redfish_client_fetch_data_multiple (self, uri_paths, error);
+	if (blobs == NULL)
+		return FALSE;
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		g_autoptr(JsonParser) parser = json_parser_new ();
 
 		/* get the member object */
 		if (!json_parser_load_from_data (parser,
@@ -222,6 +394,7 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 	JsonNode *node_root;
 	JsonObject *collection;
 	const gchar *collection_uri;
+	g_autofree gchar *collection_uri_query = NULL;
 
 	if (inventory == NULL) {
 		g_set_error_literal (error,
@@ -240,8 +413,14 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 		return FALSE;
 	}
 
+	/* get all the members in one request if possible */
+	if (self->expand_supported)
+		collection_uri_query = g_strdup_printf ("%s?$expand=.($levels=1)", collection_uri);
+	else
+		collection_uri_query = g_strdup (collection_uri);
+
 	/* try to connect */
-	blob = fu_redfish_client_fetch_data (self, collection_uri, error);
+	blob = fu_redfish_client_fetch_data (self, collection_uri_query, error);
 	if (blob == NULL)
 		return FALSE;
 
@@ -290,6 +469,9 @@ fu_redfish_client_coldplug (FuRedfishClient *self, GError **error)
 		return FALSE;
 	}
 
+	/* this may be a recoldplug */
+	g_ptr_array_set_size (self->devices, 0);
+
 	/* try to connect */
 	blob = fu_redfish_client_fetch_data (self, self->update_uri_path, error);
 	if (blob == NULL)
@@ -333,6 +515,7 @@ fu_redfish_client_coldplug (FuRedfishClient *self, GError **error)
 				     "HttpPushUri is not available");
 		return FALSE;
 	}
+	g_free (self->push_uri_path);
 	self->push_uri_path = g_strdup (json_object_get_string_member (obj_root, "HttpPushUri"));
 	if (self->push_uri_path == NULL) {
 		g_set_error_literal (error,
@@ -666,6 +849,8 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	user_agent = g_strdup_printf ("%s/%s", PACKAGE_NAME, PACKAGE_VERSION);
 	self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, user_agent,
 						       SOUP_SESSION_TIMEOUT, 60,
+						       SOUP_SESSION_MAX_CONNS, FU_REDFISH_CLIENT_MAX_REQUESTS,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST, FU_REDFISH_CLIENT_MAX_REQUESTS,
 						       NULL);
 	if (self->session == NULL) {
 		g_set_error_literal (error,
@@ -745,6 +930,17 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	g_debug ("UUID:     %s",
 		 json_object_get_string_member (obj_root, "UUID"));
 
+	/* the "." expand option is only allowed if NoLinks is supported */
+	if (json_object_has_member (obj_root, "ProtocolFeaturesSupported")) {
+		JsonObject *obj_features = json_object_get_object_member (obj_root, "ProtocolFeaturesSupported");
+		if (obj_features != NULL && json_object_has_member (obj_features, "ExpandQuery")) {
+			JsonObject *obj_expand = json_object_get_object_member (obj_features, "ExpandQuery");
+			if (obj_expand != NULL && json_object_has_member (obj_expand, "NoLinks"))
+				self->expand_supported = json_object_get_boolean_member (obj_expand, "NoLinks");
+		}
+	}
+	g_debug ("Expand:   %s", self->expand_supported ? "supported" : "unsupported");
+
 	if (json_object_has_member (obj_root, "UpdateService"))
 		obj_update_service = json_object_get_object_member (obj_root, "UpdateService");
 	if (obj_update_service == NULL) {
@@ -823,6 +1019,7 @@ fu_redfish_client_finalize (GObject *object)
 	g_free (self->username);
 	g_free (self->password);
 	g_ptr_array_unref (self->devices);
+	g_hash_table_unref (self->etags);
 	G_OBJECT_CLASS (fu_redfish_client_parent_class)->finalize (object);
 }
 
@@ -837,6 +1034,8 @@ static void
 fu_redfish_client_init (FuRedfishClient *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->etags = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) fu_redfish_client_etag_free);
 }
 
 FuRedfishClient *
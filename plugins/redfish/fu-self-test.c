@@ -7,11 +7,26 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <libsoup/soup.h>
 
 #include "fu-plugin-private.h"
 
+#include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
+#define FU_TEST_REDFISH_MEMBERS		20
+#define FU_TEST_REDFISH_ETAG		"\"abc123\""
+
+typedef struct {
+	GMainContext	*context;
+	GMainLoop	*loop;
+	SoupServer	*server;
+	guint		 port;
+	gboolean	 expand_supported;
+	gint		 cnt_requests;
+	gint		 cnt_not_modified;
+} FuTestRedfishServer;
+
 static void
 fu_test_redfish_common_func (void)
 {
@@ -26,11 +41,207 @@ fu_test_redfish_common_func (void)
 	g_assert_cmpstr (ipv6, ==, "00010203:04050607:08090a0b:0c0d0e0f");
 }
 
+static void
+fu_test_redfish_server_add_member (GString *str, guint idx)
+{
+	g_string_append_printf (str,
+				"{\"@odata.id\": \"/redfish/v1/UpdateService/FirmwareInventory/%u\", "
+				"\"Id\": \"%u\", "
+				"\"Name\": \"Device %u\", "
+				"\"SoftwareId\": \"%08x-0000-0000-0000-000000000000\", "
+				"\"Version\": \"1.2.%u\"}",
+				idx, idx, idx, idx, idx);
+}
+
+static void
+fu_test_redfish_server_cb (SoupServer *server,
+			   SoupMessage *msg,
+			   const gchar *path,
+			   GHashTable *query,
+			   SoupClientContext *client,
+			   gpointer user_data)
+{
+	FuTestRedfishServer *helper = (FuTestRedfishServer *) user_data;
+	const gchar *etag;
+	guint idx = 0;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	g_atomic_int_inc (&helper->cnt_requests);
+
+	/* nothing ever changes */
+	etag = soup_message_headers_get_one (msg->request_headers, "If-None-Match");
+	if (g_strcmp0 (etag, FU_TEST_REDFISH_ETAG) == 0) {
+		g_atomic_int_inc (&helper->cnt_not_modified);
+		soup_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED);
+		return;
+	}
+
+	if (g_strcmp0 (path, "/redfish/v1/") == 0) {
+		g_string_append (str, "{\"RedfishVersion\": \"1.6.0\", "
+				      "\"UUID\": \"92384634-2938-2342-8820-489239905423\", ");
+		if (helper->expand_supported) {
+			g_string_append (str, "\"ProtocolFeaturesSupported\": "
+					      "{\"ExpandQuery\": {\"Levels\": true, "
+					      "\"MaxLevels\": 1, \"NoLinks\": true}}, ");
+		}
+		g_string_append (str, "\"UpdateService\": "
+				      "{\"@odata.id\": \"/redfish/v1/UpdateService\"}}");
+	} else if (g_strcmp0 (path, "/redfish/v1/UpdateService") == 0) {
+		g_string_append (str, "{\"ServiceEnabled\": true, "
+				      "\"HttpPushUri\": \"/FWUpdate\", "
+				      "\"FirmwareInventory\": "
+				      "{\"@odata.id\": \"/redfish/v1/UpdateService/FirmwareInventory\"}}");
+	} else if (g_strcmp0 (path, "/redfish/v1/UpdateService/FirmwareInventory") == 0) {
+		gboolean expand = query != NULL && g_hash_table_contains (query, "$expand");
+		g_string_append (str, "{\"Members\": [");
+		for (guint i = 0; i < FU_TEST_REDFISH_MEMBERS; i++) {
+			if (i > 0)
+				g_string_append (str, ", ");
+			if (expand) {
+				fu_test_redfish_server_add_member (str, i);
+			} else {
+				g_string_append_printf (str, "{\"@odata.id\": "
+							"\"/redfish/v1/UpdateService/FirmwareInventory/%u\"}",
+							i);
+			}
+		}
+		g_string_append (str, "]}");
+	} else if (g_str_has_prefix (path, "/redfish/v1/UpdateService/FirmwareInventory/")) {
+		idx = (guint) g_ascii_strtoull (path + 44, NULL, 10);
+		fu_test_redfish_server_add_member (str, idx);
+	} else {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+	soup_message_headers_append (msg->response_headers, "ETag", FU_TEST_REDFISH_ETAG);
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json",
+				   SOUP_MEMORY_COPY, str->str, str->len);
+}
+
+static gpointer
+fu_test_redfish_server_thread_cb (gpointer user_data)
+{
+	FuTestRedfishServer *helper = (FuTestRedfishServer *) user_data;
+	g_main_context_push_thread_default (helper->context);
+	g_main_loop_run (helper->loop);
+	g_main_context_pop_thread_default (helper->context);
+	return NULL;
+}
+
+/* the client blocks the calling thread, so the server needs its own */
+static GThread *
+fu_test_redfish_server_start (FuTestRedfishServer *helper)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSList) uris = NULL;
+
+	helper->context = g_main_context_new ();
+	helper->loop = g_main_loop_new (helper->context, FALSE);
+	helper->server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (helper->server, NULL,
+				 fu_test_redfish_server_cb,
+				 helper, NULL);
+	g_main_context_push_thread_default (helper->context);
+	ret = soup_server_listen_local (helper->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_main_context_pop_thread_default (helper->context);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	uris = soup_server_get_uris (helper->server);
+	g_assert_nonnull (uris);
+	helper->port = soup_uri_get_port (uris->data);
+	g_slist_free_full (g_steal_pointer (&uris), (GDestroyNotify) soup_uri_free);
+	return g_thread_new ("redfish-server", fu_test_redfish_server_thread_cb, helper);
+}
+
+static void
+fu_test_redfish_server_stop (FuTestRedfishServer *helper, GThread *thread)
+{
+	g_main_loop_quit (helper->loop);
+	g_thread_join (thread);
+	g_object_unref (helper->server);
+	g_main_loop_unref (helper->loop);
+	g_main_context_unref (helper->context);
+}
+
+static void
+fu_test_redfish_client_func (void)
+{
+	gboolean ret;
+	GPtrArray *devices;
+	GThread *thread;
+	FuTestRedfishServer helper = { NULL };
+	g_autoptr(FuRedfishClient) client = fu_redfish_client_new ();
+	g_autoptr(GError) error = NULL;
+
+	thread = fu_test_redfish_server_start (&helper);
+	fu_redfish_client_set_hostname (client, "127.0.0.1");
+	fu_redfish_client_set_port (client, helper.port);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* each member is fetched separately */
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, FU_TEST_REDFISH_MEMBERS);
+	g_assert_cmpstr (fu_device_get_name (g_ptr_array_index (devices, 7)), ==, "Device 7");
+	g_assert_cmpstr (fu_device_get_version (g_ptr_array_index (devices, 7)), ==, "1.2.7");
+	g_assert_cmpint (g_atomic_int_get (&helper.cnt_requests), ==, FU_TEST_REDFISH_MEMBERS + 3);
+	g_assert_cmpint (g_atomic_int_get (&helper.cnt_not_modified), ==, 0);
+
+	/* nothing changed, so everything is answered from the cache */
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, FU_TEST_REDFISH_MEMBERS);
+	g_assert_cmpstr (fu_device_get_name (g_ptr_array_index (devices, 7)), ==, "Device 7");
+	g_assert_cmpint (g_atomic_int_get (&helper.cnt_not_modified), ==, FU_TEST_REDFISH_MEMBERS + 2);
+
+	fu_test_redfish_server_stop (&helper, thread);
+}
+
+static void
+fu_test_redfish_client_expand_func (void)
+{
+	gboolean ret;
+	GPtrArray *devices;
+	GThread *thread;
+	FuTestRedfishServer helper = { NULL };
+	g_autoptr(FuRedfishClient) client = fu_redfish_client_new ();
+	g_autoptr(GError) error = NULL;
+
+	helper.expand_supported = TRUE;
+	thread = fu_test_redfish_server_start (&helper);
+	fu_redfish_client_set_hostname (client, "127.0.0.1");
+	fu_redfish_client_set_port (client, helper.port);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the members are included in the collection */
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, FU_TEST_REDFISH_MEMBERS);
+	g_assert_cmpstr (fu_device_get_version (g_ptr_array_index (devices, 7)), ==, "1.2.7");
+	g_assert_cmpint (g_atomic_int_get (&helper.cnt_requests), ==, 3);
+
+	fu_test_redfish_server_stop (&helper, thread);
+}
+
 int
 main (int argc, char **argv)
 {
 	g_test_init (&argc, &argv, NULL);
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_test_add_func ("/redfish/common", fu_test_redfish_common_func);
+	g_test_add_func ("/redfish/client", fu_test_redfish_client_func);
+	g_test_add_func ("/redfish/client{expand}", fu_test_redfish_client_expand_func);
 	return g_test_run ();
 }
@@ -9,27 +9,35 @@
 #include "fu-efi-signature-common.h"
 #include "fu-efi-signature-list.h"
 
-gboolean
-fu_efi_signature_list_array_has_checksum (GPtrArray *siglists, const gchar *checksum)
+/* returns a set of all the checksums, which is only valid while @siglists
+ * is alive */
+GHashTable *
+fu_efi_signature_list_array_get_checksums (GPtrArray *siglists)
 {
-	for (guint i = 0; i < siglists->len; i++) {
-		FuEfiSignatureList *siglist = g_ptr_array_index (siglists, i);
-		if (fu_efi_signature_list_has_checksum (siglist, checksum))
-			return TRUE;
+	GHashTable *checksums = g_hash_table_new (g_str_hash, g_str_equal);
+	for (guint j = 0; j < siglists->len; j++) {
+		FuEfiSignatureList *siglist = g_ptr_array_index (siglists, j);
+		GPtrArray *items = fu_efi_signature_list_get_all (siglist);
+		for (guint i = 0; i < items->len; i++) {
+			FuEfiSignature *sig = g_ptr_array_index (items, i);
+			const gchar *checksum = fu_efi_signature_get_checksum (sig);
+			g_hash_table_add (checksums, (gpointer) checksum);
+		}
 	}
-	return FALSE;
+	return checksums;
 }
 
 gboolean
 fu_efi_signature_list_array_inclusive (GPtrArray *outer, GPtrArray *inner)
 {
+	g_autoptr(GHashTable) checksums = fu_efi_signature_list_array_get_checksums (outer);
 	for (guint j = 0; j < inner->len; j++) {
 		FuEfiSignatureList *siglist = g_ptr_array_index (inner, j);
 		GPtrArray *items = fu_efi_signature_list_get_all (siglist);
 		for (guint i = 0; i < items->len; i++) {
 			FuEfiSignature *sig = g_ptr_array_index (items, i);
 			const gchar *checksum = fu_efi_signature_get_checksum (sig);
-			if (!fu_efi_signature_list_array_has_checksum (outer, checksum))
+			if (!g_hash_table_contains (checksums, checksum))
 				return FALSE;
 		}
 	}
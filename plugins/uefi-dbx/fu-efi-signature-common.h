@@ -11,5 +11,4 @@
 gboolean	 fu_efi_signature_list_array_inclusive	(GPtrArray	*outer,
 							 GPtrArray	*inner);
 guint		 fu_efi_signature_list_array_version	(GPtrArray	*siglists);
-gboolean	 fu_efi_signature_list_array_has_checksum (GPtrArray	*siglists,
-							 const gchar	*checksum);
+GHashTable	*fu_efi_signature_list_array_get_checksums (GPtrArray	*siglists);
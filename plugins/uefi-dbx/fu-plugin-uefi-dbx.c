@@ -19,6 +19,7 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_METADATA_SOURCE, "uefi");
+	fu_plugin_add_thread_flag (plugin, FU_PLUGIN_THREAD_FLAG_COLDPLUG);
 }
 
 gboolean
@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <glib/gstdio.h>
 
 #include "fu-common.h"
 #include "fu-uefi-dbx-common.h"
@@ -40,6 +41,59 @@ fu_efi_image_func (void)
 	g_assert_cmpstr (csum, ==, "e99707d4378140c01eb3f867240d5cc9e237b126d3db0c3b4bbcd3da1720ddff");
 }
 
+static void
+fu_uefi_dbx_validate_cache_func (void)
+{
+	gboolean ret;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_cache = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(FuProbeCache) cache1 = fu_probe_cache_new ();
+	g_autoptr(FuProbeCache) cache2 = fu_probe_cache_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) siglists = g_ptr_array_new ();
+
+	/* a fake ESP with a file that is not a PE image */
+	tmpdir = g_dir_make_tmp ("fwupd-dbx-XXXXXX", &error);
+	g_assert_no_error (error);
+	fn = g_build_filename (tmpdir, "EFI", "grub.cfg", NULL);
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn, "set timeout=0", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* nothing cached */
+	ret = fu_uefi_dbx_signature_list_validate_path (siglists, tmpdir, cache1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_probe_cache_get_hits (cache1), ==, 0);
+	g_assert_cmpint (fu_probe_cache_get_misses (cache1), ==, 1);
+	fn_cache = g_build_filename (tmpdir, "authenticode.cache", NULL);
+	ret = fu_probe_cache_save (cache1, fn_cache, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the file is not hashed again */
+	ret = fu_probe_cache_load (cache2, fn_cache, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_unlink (fn_cache);
+	ret = fu_uefi_dbx_signature_list_validate_path (siglists, tmpdir, cache2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_probe_cache_get_hits (cache2), ==, 1);
+	g_assert_cmpint (fu_probe_cache_get_misses (cache2), ==, 0);
+
+	/* clean up */
+	dirname = g_path_get_dirname (fn);
+	g_unlink (fn);
+	g_rmdir (dirname);
+	g_rmdir (tmpdir);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -51,5 +105,6 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/uefi-dbx/image", fu_efi_image_func);
+	g_test_add_func ("/uefi-dbx/validate{cache}", fu_uefi_dbx_validate_cache_func);
 	return g_test_run ();
 }
@@ -6,11 +6,14 @@
 
 #include "config.h"
 
+#include <glib/gstdio.h>
+
 #include "fwupd-error.h"
 
 #include "fu-common.h"
 #include "fu-efi-image.h"
 #include "fu-efi-signature-common.h"
+#include "fu-probe-cache.h"
 #include "fu-volume.h"
 
 #include "fu-uefi-dbx-common.h"
@@ -35,41 +38,113 @@ fu_uefi_dbx_get_authenticode_hash (const gchar *fn, GError **error)
 	return g_strdup (fu_efi_image_get_checksum (img));
 }
 
-static gboolean
-fu_uefi_dbx_signature_list_validate_volume (GPtrArray *siglists, FuVolume *esp, GError **error)
+typedef struct {
+	gchar			*fn;
+	gchar			*key;
+	gchar			*checksum;	/* (nullable) */
+} FuUefiDbxFile;
+
+static void
+fu_uefi_dbx_file_free (FuUefiDbxFile *item)
 {
-	g_autofree gchar *esp_path = NULL;
+	g_free (item->fn);
+	g_free (item->key);
+	g_free (item->checksum);
+	g_free (item);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUefiDbxFile, fu_uefi_dbx_file_free)
+
+static void
+fu_uefi_dbx_hash_thread_cb (gpointer data, gpointer user_data)
+{
+	FuUefiDbxFile *item = (FuUefiDbxFile *) data;
+	g_autoptr(GError) error_local = NULL;
+
+	/* files that are not PE images are cached as an empty string */
+	item->checksum = fu_uefi_dbx_get_authenticode_hash (item->fn, &error_local);
+	if (item->checksum == NULL) {
+		g_debug ("failed to get checksum for %s: %s", item->fn, error_local->message);
+		item->checksum = g_strdup ("");
+	}
+}
+
+/* the cache is keyed on the file metadata so that it is invalidated when the
+ * file is replaced or modified; the inode is not used as vfat does not have
+ * stable inode numbers and the ESP would be hashed again after each boot */
+static gchar *
+fu_uefi_dbx_get_cache_key (const gchar *fn)
+{
+	GStatBuf st = { 0x0 };
+	if (g_stat (fn, &st) != 0)
+		return NULL;
+	return g_strdup_printf ("%s:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+				fn,
+				(guint64) st.st_size,
+				(gint64) st.st_mtime,
+				(gint64) st.st_ctime);
+}
+
+gboolean
+fu_uefi_dbx_signature_list_validate_path (GPtrArray *siglists,
+					  const gchar *path,
+					  FuProbeCache *cache,
+					  GError **error)
+{
+	GThreadPool *pool;
+	g_autoptr(GHashTable) checksums = NULL;
 	g_autoptr(GPtrArray) files = NULL;
+	g_autoptr(GPtrArray) items = NULL;
 
 	/* get list of files contained in the ESP */
-	esp_path = fu_volume_get_mount_point (esp);
-	if (esp_path == NULL)
-		return TRUE;
-	files = fu_common_get_files_recursive (esp_path, error);
+	files = fu_common_get_files_recursive (path, error);
 	if (files == NULL)
 		return FALSE;
 
-	/* verify each file does not exist in the ESP */
+	/* get the Authenticode hash of each file not already in the cache */
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_uefi_dbx_file_free);
+	pool = g_thread_pool_new (fu_uefi_dbx_hash_thread_cb, NULL,
+				  (gint) g_get_num_processors (), FALSE, error);
+	if (pool == NULL)
+		return FALSE;
 	for (guint i = 0; i < files->len; i++) {
 		const gchar *fn = g_ptr_array_index (files, i);
-		g_autofree gchar *checksum = NULL;
-		g_autoptr(GError) error_local = NULL;
+		g_autoptr(FuUefiDbxFile) item = g_new0 (FuUefiDbxFile, 1);
+		item->fn = g_strdup (fn);
+		item->key = fu_uefi_dbx_get_cache_key (fn);
+		if (item->key != NULL) {
+			g_autoptr(GVariant) value = fu_probe_cache_lookup (cache, item->key);
+			if (value != NULL &&
+			    g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+				item->checksum = g_variant_dup_string (value, NULL);
+		}
+		if (item->checksum == NULL) {
+			if (!g_thread_pool_push (pool, item, error)) {
+				g_thread_pool_free (pool, TRUE, TRUE);
+				return FALSE;
+			}
+		}
+		g_ptr_array_add (items, g_steal_pointer (&item));
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
 
-		/* get checksum of file */
-		checksum = fu_uefi_dbx_get_authenticode_hash (fn, &error_local);
-		if (checksum == NULL) {
-			g_debug ("failed to get checksum for %s: %s", fn, error_local->message);
+	/* verify each file does not exist in the dbx */
+	checksums = fu_efi_signature_list_array_get_checksums (siglists);
+	for (guint i = 0; i < items->len; i++) {
+		FuUefiDbxFile *item = g_ptr_array_index (items, i);
+		if (item->key != NULL)
+			fu_probe_cache_add (cache, item->key, g_variant_new_string (item->checksum));
+		if (item->checksum[0] == '\0')
 			continue;
-		}
 
 		/* Authenticode signature is present in dbx! */
-		g_debug ("fn=%s, checksum=%s", fn, checksum);
-		if (fu_efi_signature_list_array_has_checksum (siglists, checksum)) {
+		g_debug ("fn=%s, checksum=%s", item->fn, item->checksum);
+		if (g_hash_table_contains (checksums, item->checksum)) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NEEDS_USER_ACTION,
 				     "%s Authenticode checksum [%s] is present in dbx",
-				     fn, checksum);
+				     item->fn, item->checksum);
 			return FALSE;
 		}
 	}
@@ -78,10 +153,38 @@ fu_uefi_dbx_signature_list_validate_volume (GPtrArray *siglists, FuVolume *esp,
 	return TRUE;
 }
 
+static gboolean
+fu_uefi_dbx_signature_list_validate_volume (GPtrArray *siglists,
+					    FuVolume *esp,
+					    FuProbeCache *cache,
+					    GError **error)
+{
+	g_autofree gchar *esp_path = NULL;
+
+	esp_path = fu_volume_get_mount_point (esp);
+	if (esp_path == NULL)
+		return TRUE;
+	return fu_uefi_dbx_signature_list_validate_path (siglists, esp_path, cache, error);
+}
+
 gboolean
 fu_uefi_dbx_signature_list_validate (GPtrArray *siglists, GError **error)
 {
+	g_autofree gchar *cachedir = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuProbeCache) cache = fu_probe_cache_new ();
+	g_autoptr(GError) error_cache = NULL;
 	g_autoptr(GPtrArray) volumes = NULL;
+
+	/* the Authenticode hashes from the last run */
+	cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	filename = g_build_filename (cachedir, "uefi-dbx", "authenticode.cache", NULL);
+	if (g_file_test (filename, G_FILE_TEST_EXISTS) &&
+	    !fu_probe_cache_load (cache, filename, &error_cache)) {
+		g_debug ("ignoring Authenticode cache: %s", error_cache->message);
+		g_clear_error (&error_cache);
+	}
+
 	volumes = fu_common_get_volumes_by_kind (FU_VOLUME_KIND_ESP, error);
 	if (volumes == NULL)
 		return FALSE;
@@ -91,8 +194,15 @@ fu_uefi_dbx_signature_list_validate (GPtrArray *siglists, GError **error)
 		locker = fu_volume_locker (esp, error);
 		if (locker == NULL)
 			return FALSE;
-		if (!fu_uefi_dbx_signature_list_validate_volume (siglists, esp, error))
+		if (!fu_uefi_dbx_signature_list_validate_volume (siglists, esp, cache, error))
 			return FALSE;
 	}
+
+	/* only the files that still exist are saved */
+	g_debug ("Authenticode cache hits: %u, misses: %u",
+		 fu_probe_cache_get_hits (cache),
+		 fu_probe_cache_get_misses (cache));
+	if (!fu_probe_cache_save (cache, filename, &error_cache))
+		g_debug ("failed to save Authenticode cache: %s", error_cache->message);
 	return TRUE;
 }
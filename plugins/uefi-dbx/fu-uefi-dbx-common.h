@@ -8,7 +8,13 @@
 
 #include <gio/gio.h>
 
+#include "fu-probe-cache.h"
+
 gchar		*fu_uefi_dbx_get_authenticode_hash	(const gchar	*fn,
 							 GError		**error);
 gboolean	 fu_uefi_dbx_signature_list_validate	(GPtrArray	*siglists,
 							 GError		**error);
+gboolean	 fu_uefi_dbx_signature_list_validate_path (GPtrArray	*siglists,
+							 const gchar	*path,
+							 FuProbeCache	*cache,
+							 GError		**error);
@@ -255,23 +255,25 @@ fu_vli_device_spi_erase_sector (FuVliDevice *self, guint32 addr, GError **error)
 GBytes *
 fu_vli_device_spi_read (FuVliDevice *self, guint32 address, gsize bufsz, GError **error)
 {
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autofree guint8 *buf = g_malloc0 (bufsz);
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* get data from hardware */
-	chunks = fu_chunk_array_new (buf, bufsz, address, 0x0, FU_VLI_DEVICE_TXSIZE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, buf, bufsz, address, 0x0, FU_VLI_DEVICE_TXSIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (!fu_vli_device_spi_read_block (self,
-						  chk->address,
-						  (guint8 *) chk->data,
-						  chk->data_sz,
+						  chk.address,
+						  (guint8 *) chk.data,
+						  chk.data_sz,
 						  error)) {
-			g_prefix_error (error, "SPI data read failed @0x%x: ", chk->address);
+			g_prefix_error (error, "SPI data read failed @0x%x: ", chk.address);
 			return NULL;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
 }
@@ -323,38 +325,157 @@ fu_vli_device_spi_write (FuVliDevice *self,
 			 gsize bufsz,
 			 GError **error)
 {
-	FuChunk *chk;
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunk chk_crc;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 
 	/* write SPI data, then CRC bytes last */
 	g_debug ("writing 0x%x bytes @0x%x", (guint) bufsz, address);
-	chunks = fu_chunk_array_new (buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
-	if (chunks->len > 1) {
-		for (guint i = 1; i < chunks->len; i++) {
-			chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	if (!fu_chunk_iter_next (&iter, &chk_crc)) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no data to write");
+		return FALSE;
+	}
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		if (!fu_vli_device_spi_write_block (self,
+						    chk.address + address,
+						    chk.data,
+						    chk.data_sz,
+						    error)) {
+			g_prefix_error (error, "failed to write block 0x%x: ", chk.idx);
+			return FALSE;
+		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) chk.idx - 1,
+					     (gsize) chunks_cnt);
+	}
+	if (!fu_vli_device_spi_write_block (self,
+					    chk_crc.address + address,
+					    chk_crc.data,
+					    chk_crc.data_sz,
+					    error)) {
+		g_prefix_error (error, "failed to write CRC block: ");
+		return FALSE;
+	}
+	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks_cnt, (gsize) chunks_cnt);
+	return TRUE;
+}
+
+/* only erase and write the sectors that are different to the existing image,
+ * but always include the first sector as the CRC block is written last; if
+ * the existing image cannot be read then everything is erased and written */
+gboolean
+fu_vli_device_spi_write_diff (FuVliDevice *self,
+			      guint32 address,
+			      const guint8 *buf,
+			      gsize bufsz,
+			      GError **error)
+{
+	const guint32 sectorsz = 0x1000;
+	const guint8 *buf_old;
+	gsize bufsz_old = 0;
+	gsize total = 0;
+	gsize written = 0;
+	FuChunk chk_crc = { 0x0 };
+	g_autoptr(GBytes) fw_old = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) chunks = NULL;
+
+	/* read what is already on the flash */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_READ);
+	fw_old = fu_vli_device_spi_read (self, address, bufsz, &error_local);
+	if (fw_old == NULL) {
+		g_debug ("failed to read existing image, writing everything: %s",
+			 error_local->message);
+		fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
+		if (!fu_vli_device_spi_erase (self, address, bufsz, error))
+			return FALSE;
+		fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
+		return fu_vli_device_spi_write (self, address, buf, bufsz, error);
+	}
+	buf_old = g_bytes_get_data (fw_old, &bufsz_old);
+	chunks = fu_chunk_array_new_diff (buf_old, (guint32) bufsz_old,
+					  buf, (guint32) bufsz,
+					  address, sectorsz, 0x0);
+	if (chunks->len == 0) {
+		g_debug ("no changes to write @0x%x", address);
+		return TRUE;
+	}
+	if (((FuChunk *) g_ptr_array_index (chunks, 0))->idx != 0) {
+		FuChunkIter iter;
+		FuChunk chk_first;
+		fu_chunk_iter_init (&iter, buf, (guint32) bufsz, address, sectorsz, 0x0);
+		if (!fu_chunk_iter_next (&iter, &chk_first)) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "no data to write");
+			return FALSE;
+		}
+		g_ptr_array_insert (chunks, 0,
+				    fu_chunk_new (chk_first.idx,
+						  chk_first.page,
+						  chk_first.address,
+						  chk_first.data,
+						  chk_first.data_sz));
+	}
+
+	/* erase the changed sectors */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		guint32 addr = (chk->page * sectorsz) + chk->address;
+		if (!fu_vli_device_spi_erase_sector (self, addr, error)) {
+			g_prefix_error (error, "failed to erase sector @0x%x: ", addr);
+			return FALSE;
+		}
+		fu_device_set_progress_full (FU_DEVICE (self), (gsize) i, (gsize) chunks->len);
+		total += chk->data_sz;
+	}
+	g_debug ("writing 0x%x of 0x%x bytes @0x%x",
+		 (guint) total, (guint) bufsz, address);
+
+	/* write the changed sectors, then CRC bytes last */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		FuChunk chk_blk;
+		FuChunkIter iter;
+		guint32 addr = (chk->page * sectorsz) + chk->address;
+
+		fu_chunk_iter_init (&iter, chk->data, chk->data_sz, addr, 0x0, FU_VLI_DEVICE_TXSIZE);
+		while (fu_chunk_iter_next (&iter, &chk_blk)) {
+			if (chk_blk.address == address) {
+				chk_crc = chk_blk;
+				continue;
+			}
 			if (!fu_vli_device_spi_write_block (self,
-							    chk->address + address,
-							    chk->data,
-							    chk->data_sz,
+							    chk_blk.address,
+							    chk_blk.data,
+							    chk_blk.data_sz,
 							    error)) {
-				g_prefix_error (error, "failed to write block 0x%x: ", chk->idx);
+				g_prefix_error (error, "failed to write block @0x%x: ",
+						chk_blk.address);
 				return FALSE;
 			}
-			fu_device_set_progress_full (FU_DEVICE (self),
-						     (gsize) i - 1,
-						     (gsize) chunks->len);
+			written += chk_blk.data_sz;
+			fu_device_set_progress_full (FU_DEVICE (self), written, total);
 		}
 	}
-	chk = g_ptr_array_index (chunks, 0);
 	if (!fu_vli_device_spi_write_block (self,
-					    chk->address + address,
-					    chk->data,
-					    chk->data_sz,
+					    chk_crc.address,
+					    chk_crc.data,
+					    chk_crc.data_sz,
 					    error)) {
 		g_prefix_error (error, "failed to write CRC block: ");
 		return FALSE;
 	}
-	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks->len, (gsize) chunks->len);
+	fu_device_set_progress_full (FU_DEVICE (self), total, total);
 	return TRUE;
 }
 
@@ -397,20 +518,24 @@ fu_vli_device_spi_erase_all (FuVliDevice *self, GError **error)
 gboolean
 fu_vli_device_spi_erase (FuVliDevice *self, guint32 addr, gsize sz, GError **error)
 {
-	g_autoptr(GPtrArray) chunks = fu_chunk_array_new (NULL, sz, addr, 0x0, 0x1000);
+	FuChunk chunk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
+
+	fu_chunk_iter_init (&iter, NULL, sz, addr, 0x0, 0x1000);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 	g_debug ("erasing 0x%x bytes @0x%x", (guint) sz, addr);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chunk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chunk)) {
 		if (g_getenv ("FWUPD_VLI_USBHUB_VERBOSE") != NULL)
-			g_debug ("erasing @0x%x", chunk->address);
-		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chunk->address, error)) {
+			g_debug ("erasing @0x%x", chunk.address);
+		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chunk.address, error)) {
 			g_prefix_error (error,
 					"failed to erase FW sector @0x%x: ",
-					chunk->address);
+					chunk.address);
 			return FALSE;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chunk.idx, (gsize) chunks_cnt);
 	}
 	return TRUE;
 }
@@ -99,3 +99,8 @@ gboolean	 fu_vli_device_spi_write		(FuVliDevice	*self,
 							 const guint8	*buf,
 							 gsize		 bufsz,
 							 GError		**error);
+gboolean	 fu_vli_device_spi_write_diff		(FuVliDevice	*self,
+							 guint32	 address,
+							 const guint8	*buf,
+							 gsize		 bufsz,
+							 GError		**error);
@@ -883,18 +883,12 @@ fu_vli_usbhub_device_update_v2 (FuVliUsbhubDevice *self, FuFirmware *firmware, G
 	g_debug ("FW2 @0x%x (length 0x%x, offset 0x%x)",
 		 hd2_fw_addr, hd2_fw_sz, hd2_fw_offset);
 
-	/* make space */
-	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
-	if (!fu_vli_device_spi_erase (FU_VLI_DEVICE (self), hd2_fw_addr, hd2_fw_sz, error))
-		return FALSE;
-
-	/* perform the actual write */
-	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
-	if (!fu_vli_device_spi_write (FU_VLI_DEVICE (self),
-				      hd2_fw_addr,
-				      buf_fw + hd2_fw_offset,
-				      hd2_fw_sz,
-				      error)) {
+	/* only erase and write the sectors that changed */
+	if (!fu_vli_device_spi_write_diff (FU_VLI_DEVICE (self),
+					   hd2_fw_addr,
+					   buf_fw + hd2_fw_offset,
+					   hd2_fw_sz,
+					   error)) {
 		g_prefix_error (error, "failed to write payload: ");
 		return FALSE;
 	}
@@ -518,7 +518,8 @@ fu_wac_device_write_firmware (FuDevice *device,
 	for (guint16 i = 0; i < self->flash_descriptors->len; i++) {
 		FuWacFlashDescriptor *fd = g_ptr_array_index (self->flash_descriptors, i);
 		GBytes *blob_block;
-		g_autoptr(GPtrArray) chunks = NULL;
+		FuChunk chk;
+		FuChunkIter iter;
 
 		/* if page is protected */
 		if (fu_wav_device_flash_descriptor_is_wp (fd))
@@ -541,14 +542,13 @@ fu_wac_device_write_firmware (FuDevice *device,
 			return FALSE;
 
 		/* write block in chunks */
-		chunks = fu_chunk_array_new_from_bytes (blob_block,
-							fd->start_addr,
-							0, /* page_sz */
-							self->write_block_sz);
-		for (guint j = 0; j < chunks->len; j++) {
-			FuChunk *chk = g_ptr_array_index (chunks, j);
-			g_autoptr(GBytes) blob_chunk = g_bytes_new (chk->data, chk->data_sz);
-			if (!fu_wac_device_write_block (self, chk->address, blob_chunk, error))
+		fu_chunk_iter_init_from_bytes (&iter, blob_block,
+					       fd->start_addr,
+					       0, /* page_sz */
+					       self->write_block_sz);
+		while (fu_chunk_iter_next (&iter, &chk)) {
+			g_autoptr(GBytes) blob_chunk = g_bytes_new (chk.data, chk.data_sz);
+			if (!fu_wac_device_write_block (self, chk.address, blob_chunk, error))
 				return FALSE;
 		}
 
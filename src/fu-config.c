@@ -33,6 +33,8 @@ struct _FuConfig
 	GPtrArray		*blocked_firmware;	/* (element-type utf-8) */
 	guint64			 archive_size_max;
 	guint			 idle_timeout;
+	guint			 coldplug_threads_max;
+	guint			 install_threads_max;
 	gchar			*config_file;
 	gboolean		 update_motd;
 	gboolean		 enumerate_all_devices;
@@ -52,6 +54,8 @@ fu_config_reload (FuConfig *self, GError **error)
 {
 	guint64 archive_size_max;
 	guint idle_timeout;
+	guint64 coldplug_threads_max;
+	guint64 install_threads_max;
 	g_auto(GStrv) approved_firmware = NULL;
 	g_auto(GStrv) blocked_firmware = NULL;
 	g_auto(GStrv) devices = NULL;
@@ -60,6 +64,7 @@ fu_config_reload (FuConfig *self, GError **error)
 	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
 	g_autoptr(GError) error_update_motd = NULL;
 	g_autoptr(GError) error_enumerate_all = NULL;
+	g_autoptr(GError) error_install_threads_max = NULL;
 
 	g_debug ("loading config values from %s", self->config_file);
 	if (!g_key_file_load_from_file (keyfile, self->config_file,
@@ -138,6 +143,28 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (idle_timeout > 0)
 		self->idle_timeout = idle_timeout;
 
+	/* get the number of plugins that can be coldplugged in parallel,
+	 * defaulting to one at a time */
+	if (g_key_file_has_key (keyfile, "fwupd", "ColdplugThreadsMax", NULL)) {
+		coldplug_threads_max = g_key_file_get_uint64 (keyfile,
+							      "fwupd",
+							      "ColdplugThreadsMax",
+							      NULL);
+	} else {
+		coldplug_threads_max = 1;
+	}
+	self->coldplug_threads_max = MIN (coldplug_threads_max, G_MAXUINT);
+
+	/* get the number of unrelated devices that can be updated in parallel,
+	 * defaulting to one at a time */
+	install_threads_max = g_key_file_get_uint64 (keyfile,
+						     "fwupd",
+						     "InstallThreadsMax",
+						     &error_install_threads_max);
+	if (error_install_threads_max != NULL)
+		install_threads_max = 1;
+	self->install_threads_max = MIN (install_threads_max, G_MAXUINT);
+
 	/* get the domains to run in verbose */
 	domains = g_key_file_get_string (keyfile,
 					 "fwupd",
@@ -236,6 +263,20 @@ fu_config_get_idle_timeout (FuConfig *self)
 	return self->idle_timeout;
 }
 
+guint
+fu_config_get_coldplug_threads_max (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->coldplug_threads_max;
+}
+
+guint
+fu_config_get_install_threads_max (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->install_threads_max;
+}
+
 GPtrArray *
 fu_config_get_disabled_devices (FuConfig *self)
 {
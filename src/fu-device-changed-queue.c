@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuDeviceChangedQueue"
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "fu-device-changed-queue.h"
+
+/* rate limits the ::device-changed signal for each device so that the first
+ * change is emitted immediately and then only the latest state is emitted
+ * once per interval until the device stops changing */
+
+static void fu_device_changed_queue_finalize	 (GObject *obj);
+
+struct _FuDeviceChangedQueue
+{
+	GObject			 parent_instance;
+	GHashTable		*items;		/* device-id:FuDeviceChangedQueueItem */
+	GMutex			 items_mutex;	/* for @items */
+	guint			 interval;	/* ms */
+};
+
+typedef struct {
+	FuDeviceChangedQueue	*self;		/* no ref */
+	gchar			*device_id;
+	FuDevice		*device;	/* nullable, the latest pending */
+	guint			 timeout_id;
+} FuDeviceChangedQueueItem;
+
+enum {
+	SIGNAL_DEVICE_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (FuDeviceChangedQueue, fu_device_changed_queue, G_TYPE_OBJECT)
+
+static void
+fu_device_changed_queue_item_free (gpointer data)
+{
+	FuDeviceChangedQueueItem *item = (FuDeviceChangedQueueItem *) data;
+	if (item->device != NULL)
+		g_object_unref (item->device);
+	g_free (item->device_id);
+	g_free (item);
+}
+
+static gboolean
+fu_device_changed_queue_timeout_cb (gpointer user_data)
+{
+	FuDeviceChangedQueueItem *item = (FuDeviceChangedQueueItem *) user_data;
+	FuDeviceChangedQueue *self = item->self;
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->items_mutex);
+
+	/* removed from another thread */
+	if (g_source_is_destroyed (g_main_current_source ()))
+		return G_SOURCE_REMOVE;
+
+	/* nothing changed in the last interval, so emit the next one now */
+	if (item->device == NULL) {
+		g_hash_table_remove (self->items, item->device_id);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* just the latest state */
+	device = g_steal_pointer (&item->device);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * fu_device_changed_queue_add:
+ * @self: A #FuDeviceChangedQueue
+ * @device: A #FuDevice
+ *
+ * Emits ::device-changed for the device now if it has not changed in the last
+ * interval, otherwise queues it so that only the latest state is emitted when
+ * the interval expires.
+ *
+ * This can be called from any thread, but the interval timeout is always
+ * dispatched in the default main context.
+ **/
+void
+fu_device_changed_queue_add (FuDeviceChangedQueue *self, FuDevice *device)
+{
+	FuDeviceChangedQueueItem *item;
+	const gchar *device_id = fu_device_get_id (device);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_DEVICE_CHANGED_QUEUE (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+
+	/* already emitted in this interval */
+	locker = g_mutex_locker_new (&self->items_mutex);
+	item = g_hash_table_lookup (self->items, device_id);
+	if (item != NULL) {
+		g_set_object (&item->device, device);
+		return;
+	}
+
+	/* emit now, and start the interval for this device only */
+	item = g_new0 (FuDeviceChangedQueueItem, 1);
+	item->self = self;
+	item->device_id = g_strdup (device_id);
+	item->timeout_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+					       self->interval,
+					       fu_device_changed_queue_timeout_cb,
+					       item,
+					       fu_device_changed_queue_item_free);
+	g_hash_table_insert (self->items, item->device_id, item);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
+}
+
+/**
+ * fu_device_changed_queue_remove:
+ * @self: A #FuDeviceChangedQueue
+ * @device_id: A device ID
+ *
+ * Drops any pending change for the device, typically because it was removed.
+ **/
+void
+fu_device_changed_queue_remove (FuDeviceChangedQueue *self, const gchar *device_id)
+{
+	FuDeviceChangedQueueItem *item;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_DEVICE_CHANGED_QUEUE (self));
+	g_return_if_fail (device_id != NULL);
+
+	locker = g_mutex_locker_new (&self->items_mutex);
+	item = g_hash_table_lookup (self->items, device_id);
+	if (item == NULL)
+		return;
+	g_hash_table_remove (self->items, device_id);
+	g_source_remove (item->timeout_id);
+}
+
+static void
+fu_device_changed_queue_class_init (FuDeviceChangedQueueClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_device_changed_queue_finalize;
+
+	signals[SIGNAL_DEVICE_CHANGED] =
+		g_signal_new ("device-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, FU_TYPE_DEVICE);
+}
+
+static void
+fu_device_changed_queue_init (FuDeviceChangedQueue *self)
+{
+	/* the items are owned by the timeout sources */
+	self->items = g_hash_table_new (g_str_hash, g_str_equal);
+	g_mutex_init (&self->items_mutex);
+}
+
+static void
+fu_device_changed_queue_finalize (GObject *obj)
+{
+	FuDeviceChangedQueue *self = FU_DEVICE_CHANGED_QUEUE (obj);
+	GList *items = g_hash_table_get_values (self->items);
+
+	g_hash_table_remove_all (self->items);
+	for (GList *l = items; l != NULL; l = l->next) {
+		FuDeviceChangedQueueItem *item = (FuDeviceChangedQueueItem *) l->data;
+		g_source_remove (item->timeout_id);
+	}
+	g_list_free (items);
+	g_hash_table_unref (self->items);
+	g_mutex_clear (&self->items_mutex);
+
+	G_OBJECT_CLASS (fu_device_changed_queue_parent_class)->finalize (obj);
+}
+
+/**
+ * fu_device_changed_queue_new:
+ * @interval: the minimum time between emissions for each device, in ms
+ *
+ * Creates a new device changed queue.
+ *
+ * Returns: (transfer full): a #FuDeviceChangedQueue
+ **/
+FuDeviceChangedQueue *
+fu_device_changed_queue_new (guint interval)
+{
+	FuDeviceChangedQueue *self;
+	self = g_object_new (FU_TYPE_DEVICE_CHANGED_QUEUE, NULL);
+	self->interval = interval;
+	return FU_DEVICE_CHANGED_QUEUE (self);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "fu-device.h"
+
+#define FU_TYPE_DEVICE_CHANGED_QUEUE (fu_device_changed_queue_get_type ())
+G_DECLARE_FINAL_TYPE (FuDeviceChangedQueue, fu_device_changed_queue, FU, DEVICE_CHANGED_QUEUE, GObject)
+
+FuDeviceChangedQueue *fu_device_changed_queue_new	(guint			 interval);
+void		 fu_device_changed_queue_add		(FuDeviceChangedQueue	*self,
+							 FuDevice		*device);
+void		 fu_device_changed_queue_remove		(FuDeviceChangedQueue	*self,
+							 const gchar		*device_id);
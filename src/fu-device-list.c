@@ -33,11 +33,23 @@
 
 static void fu_device_list_finalize	 (GObject *obj);
 
+typedef enum {
+	FU_DEVICE_LIST_INDEX_KIND_GUID,
+	FU_DEVICE_LIST_INDEX_KIND_GUID_OLD,
+	FU_DEVICE_LIST_INDEX_KIND_CONNECTION,
+	FU_DEVICE_LIST_INDEX_KIND_CONNECTION_OLD,
+	FU_DEVICE_LIST_INDEX_KIND_LAST
+} FuDeviceListIndexKind;
+
 struct _FuDeviceList
 {
 	GObject			 parent_instance;
 	GPtrArray		*devices;	/* of FuDeviceItem */
 	GRWLock			 devices_mutex;
+	GHashTable		*index[FU_DEVICE_LIST_INDEX_KIND_LAST];	/* key:GPtrArray of FuDeviceItem */
+	GPtrArray		*index_ids;	/* of FuDeviceListIdEntry, sorted by ID */
+	guint64			 serial_next;
+	gboolean		 concurrent_replug;
 };
 
 enum {
@@ -54,10 +66,271 @@ typedef struct {
 	FuDevice		*device_old;
 	FuDeviceList		*self;		/* no ref */
 	guint			 remove_id;
+	guint64			 serial;	/* the order added to the list */
+	GPtrArray		*index_keys;	/* of FuDeviceListIndexKey */
+	GPtrArray		*index_ids;	/* of FuDeviceListIdEntry, no ref */
 } FuDeviceItem;
 
+typedef struct {
+	FuDeviceListIndexKind	 kind;
+	gchar			*key;
+} FuDeviceListIndexKey;
+
+typedef struct {
+	gchar			*id;
+	FuDeviceItem		*item;		/* no ref */
+	gboolean		 is_old;
+} FuDeviceListIdEntry;
+
 G_DEFINE_TYPE (FuDeviceList, fu_device_list, G_TYPE_OBJECT)
 
+static void
+fu_device_list_index_key_free (FuDeviceListIndexKey *key)
+{
+	g_free (key->key);
+	g_free (key);
+}
+
+static void
+fu_device_list_id_entry_free (FuDeviceListIdEntry *entry)
+{
+	g_free (entry->id);
+	g_free (entry);
+}
+
+/* the index is only ever queried for valid GUIDs, so convert like
+ * fu_device_has_guid() would have done */
+static gchar *
+fu_device_list_index_guid_key (const gchar *guid)
+{
+	if (!fwupd_guid_is_valid (guid))
+		return fwupd_guid_hash_string (guid);
+	return g_strdup (guid);
+}
+
+static gchar *
+fu_device_list_index_connection_key (const gchar *physical_id, const gchar *logical_id)
+{
+	if (logical_id == NULL)
+		return g_strdup (physical_id);
+	return g_strdup_printf ("%s\n%s", physical_id, logical_id);
+}
+
+/* must be called with the devices_mutex held for writing */
+static void
+fu_device_list_index_add_key (FuDeviceList *self,
+			      FuDeviceItem *item,
+			      FuDeviceListIndexKind kind,
+			      const gchar *key)
+{
+	FuDeviceListIndexKey *index_key;
+	GPtrArray *items = g_hash_table_lookup (self->index[kind], key);
+
+	if (items == NULL) {
+		items = g_ptr_array_new ();
+		g_hash_table_insert (self->index[kind], g_strdup (key), items);
+	}
+	for (guint i = 0; i < items->len; i++) {
+		if (g_ptr_array_index (items, i) == item)
+			return;
+	}
+	g_ptr_array_add (items, item);
+
+	/* so we can remove it again without using the device */
+	index_key = g_new0 (FuDeviceListIndexKey, 1);
+	index_key->kind = kind;
+	index_key->key = g_strdup (key);
+	g_ptr_array_add (item->index_keys, index_key);
+}
+
+/* returns the position of the first ID that is not less than @id */
+static guint
+fu_device_list_index_ids_lower_bound (FuDeviceList *self, const gchar *id)
+{
+	guint lo = 0;
+	guint hi = self->index_ids->len;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		FuDeviceListIdEntry *entry = g_ptr_array_index (self->index_ids, mid);
+		if (g_strcmp0 (entry->id, id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* must be called with the devices_mutex held for writing */
+static void
+fu_device_list_index_add_id (FuDeviceList *self,
+			     FuDeviceItem *item,
+			     const gchar *id,
+			     gboolean is_old)
+{
+	FuDeviceListIdEntry *entry = g_new0 (FuDeviceListIdEntry, 1);
+	entry->id = g_strdup (id);
+	entry->item = item;
+	entry->is_old = is_old;
+	g_ptr_array_insert (self->index_ids,
+			    fu_device_list_index_ids_lower_bound (self, id),
+			    entry);
+	g_ptr_array_add (item->index_ids, entry);
+}
+
+/* must be called with the devices_mutex held for writing */
+static void
+fu_device_list_index_add_device (FuDeviceList *self,
+				 FuDeviceItem *item,
+				 FuDevice *device,
+				 gboolean is_old)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+	const gchar *physical_id = fu_device_get_physical_id (device);
+
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		fu_device_list_index_add_key (self, item,
+					      is_old ? FU_DEVICE_LIST_INDEX_KIND_GUID_OLD :
+						       FU_DEVICE_LIST_INDEX_KIND_GUID,
+					      guid);
+	}
+	if (physical_id != NULL) {
+		g_autofree gchar *key = NULL;
+		key = fu_device_list_index_connection_key (physical_id,
+							   fu_device_get_logical_id (device));
+		fu_device_list_index_add_key (self, item,
+					      is_old ? FU_DEVICE_LIST_INDEX_KIND_CONNECTION_OLD :
+						       FU_DEVICE_LIST_INDEX_KIND_CONNECTION,
+					      key);
+	}
+	if (fu_device_get_id (device) != NULL) {
+		fu_device_list_index_add_id (self, item, fu_device_get_id (device), is_old);
+		if (fu_device_get_equivalent_id (device) != NULL) {
+			fu_device_list_index_add_id (self, item,
+						     fu_device_get_equivalent_id (device),
+						     is_old);
+		}
+	}
+}
+
+/* must be called with the devices_mutex held for writing */
+static void
+fu_device_list_index_remove_item (FuDeviceList *self, FuDeviceItem *item)
+{
+	for (guint i = 0; i < item->index_keys->len; i++) {
+		FuDeviceListIndexKey *index_key = g_ptr_array_index (item->index_keys, i);
+		GPtrArray *items = g_hash_table_lookup (self->index[index_key->kind],
+							 index_key->key);
+		if (items == NULL)
+			continue;
+		g_ptr_array_remove (items, item);
+		if (items->len == 0)
+			g_hash_table_remove (self->index[index_key->kind], index_key->key);
+	}
+	g_ptr_array_set_size (item->index_keys, 0);
+	for (guint i = 0; i < item->index_ids->len; i++) {
+		FuDeviceListIdEntry *entry = g_ptr_array_index (item->index_ids, i);
+		for (guint j = fu_device_list_index_ids_lower_bound (self, entry->id);
+		     j < self->index_ids->len; j++) {
+			if (g_ptr_array_index (self->index_ids, j) == entry) {
+				g_ptr_array_remove_index (self->index_ids, j);
+				break;
+			}
+		}
+	}
+	g_ptr_array_set_size (item->index_ids, 0);
+}
+
+/* must be called with the devices_mutex held for writing */
+static void
+fu_device_list_index_update_item (FuDeviceList *self, FuDeviceItem *item)
+{
+	fu_device_list_index_remove_item (self, item);
+	if (item->device != NULL)
+		fu_device_list_index_add_device (self, item, item->device, FALSE);
+	if (item->device_old != NULL)
+		fu_device_list_index_add_device (self, item, item->device_old, TRUE);
+}
+
+/* must be called with the devices_mutex held for reading; returns whichever
+ * of @best or the items matching @key was added to the list first */
+static FuDeviceItem *
+fu_device_list_index_lookup (FuDeviceList *self,
+			     FuDeviceListIndexKind kind,
+			     const gchar *key,
+			     gboolean removed_only,
+			     FuDeviceItem *best)
+{
+	GPtrArray *items = g_hash_table_lookup (self->index[kind], key);
+	if (items == NULL)
+		return best;
+	for (guint i = 0; i < items->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (items, i);
+		if (removed_only && item->remove_id == 0)
+			continue;
+		if (best == NULL || item->serial < best->serial)
+			best = item;
+	}
+	return best;
+}
+
+/* must be called with the devices_mutex held for reading */
+static FuDeviceItem *
+fu_device_list_index_lookup_guids (FuDeviceList *self,
+				   FuDeviceListIndexKind kind,
+				   GPtrArray *guids,
+				   gboolean removed_only)
+{
+	FuDeviceItem *best = NULL;
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		g_autofree gchar *key = fu_device_list_index_guid_key (guid);
+		best = fu_device_list_index_lookup (self, kind, key, removed_only, best);
+	}
+	return best;
+}
+
+static void
+fu_device_list_item_notify_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	FuDeviceItem *item = (FuDeviceItem *) user_data;
+	FuDeviceList *self = FU_DEVICE_LIST (item->self);
+	g_autoptr(GRWLockWriterLocker) locker = g_rw_lock_writer_locker_new (&self->devices_mutex);
+	g_return_if_fail (locker != NULL);
+	fu_device_list_index_update_item (self, item);
+}
+
+static void
+fu_device_list_item_watch (FuDeviceItem *item)
+{
+	FuDevice *devices[] = { item->device, item->device_old, NULL };
+	const gchar *signal_names[] = {
+		"notify::id",
+		"notify::guids",
+		"notify::physical-id",
+		"notify::logical-id",
+		"notify::equivalent-id",
+		NULL };
+	for (guint i = 0; devices[i] != NULL; i++) {
+		if (i > 0 && devices[i] == devices[0])
+			continue;
+		for (guint j = 0; signal_names[j] != NULL; j++) {
+			g_signal_connect (devices[i], signal_names[j],
+					  G_CALLBACK (fu_device_list_item_notify_cb),
+					  item);
+		}
+	}
+}
+
+static void
+fu_device_list_item_unwatch (FuDeviceItem *item)
+{
+	if (item->device != NULL)
+		g_signal_handlers_disconnect_by_data (item->device, item);
+	if (item->device_old != NULL)
+		g_signal_handlers_disconnect_by_data (item->device_old, item);
+}
+
 static void
 fu_device_list_emit_device_added (FuDeviceList *self, FuDevice *device)
 {
@@ -215,21 +488,16 @@ fu_device_list_find_by_device (FuDeviceList *self, FuDevice *device)
 static FuDeviceItem *
 fu_device_list_find_by_guid (FuDeviceList *self, const gchar *guid)
 {
+	FuDeviceItem *item;
+	g_autofree gchar *key = fu_device_list_index_guid_key (guid);
 	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (fu_device_has_guid (item->device, guid))
-			return item;
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		if (fu_device_has_guid (item->device_old, guid))
-			return item;
-	}
-	return NULL;
+	item = fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_KIND_GUID,
+					    key, FALSE, NULL);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_KIND_GUID_OLD,
+					    key, FALSE, NULL);
 }
 
 static FuDeviceItem *
@@ -237,28 +505,46 @@ fu_device_list_find_by_connection (FuDeviceList *self,
 				   const gchar *physical_id,
 				   const gchar *logical_id)
 {
+	FuDeviceItem *item;
+	g_autofree gchar *key = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	if (physical_id == NULL)
 		return NULL;
+	key = fu_device_list_index_connection_key (physical_id, logical_id);
 	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device_old;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
+	item = fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_KIND_CONNECTION,
+					    key, FALSE, NULL);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup (self, FU_DEVICE_LIST_INDEX_KIND_CONNECTION_OLD,
+					    key, FALSE, NULL);
+}
+
+/* must be called with the devices_mutex held for reading */
+static FuDeviceItem *
+fu_device_list_find_by_id_prefix (FuDeviceList *self,
+				  const gchar *device_id,
+				  gboolean is_old,
+				  gboolean *multiple_matches)
+{
+	FuDeviceItem *item = NULL;
+	gsize device_id_len = strlen (device_id);
+
+	/* all the IDs starting with the prefix are sorted together */
+	for (guint i = fu_device_list_index_ids_lower_bound (self, device_id);
+	     i < self->index_ids->len; i++) {
+		FuDeviceListIdEntry *entry = g_ptr_array_index (self->index_ids, i);
+		if (strncmp (entry->id, device_id, device_id_len) != 0)
+			break;
+		if (entry->is_old != is_old)
+			continue;
+		if (item != NULL && multiple_matches != NULL)
+			*multiple_matches = TRUE;
+		if (item == NULL || entry->item->serial > item->serial)
+			item = entry->item;
 	}
-	return NULL;
+	return item;
 }
 
 static FuDeviceItem *
@@ -266,8 +552,8 @@ fu_device_list_find_by_id (FuDeviceList *self,
 			   const gchar *device_id,
 			   gboolean *multiple_matches)
 {
-	FuDeviceItem *item = NULL;
-	gsize device_id_len;
+	FuDeviceItem *item;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	/* sanity check */
 	if (device_id == NULL) {
@@ -276,45 +562,14 @@ fu_device_list_find_by_id (FuDeviceList *self,
 	}
 
 	/* support abbreviated hashes */
-	device_id_len = strlen (device_id);
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		const gchar *ids[] = {
-			fu_device_get_id (item_tmp->device),
-			fu_device_get_equivalent_id (item_tmp->device),
-			NULL };
-		for (guint j = 0; ids[j] != NULL; j++) {
-			if (strncmp (ids[j], device_id, device_id_len) == 0) {
-				if (item != NULL && multiple_matches != NULL)
-					*multiple_matches = TRUE;
-				item = item_tmp;
-			}
-		}
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
+	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+	g_return_val_if_fail (locker != NULL, NULL);
+	item = fu_device_list_find_by_id_prefix (self, device_id, FALSE, multiple_matches);
 	if (item != NULL)
 		return item;
 
 	/* only search old devices if we didn't find the active device */
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		const gchar *ids[3] = { NULL };
-		if (item_tmp->device_old == NULL)
-			continue;
-		ids[0] = fu_device_get_id (item_tmp->device_old);
-		ids[1] = fu_device_get_equivalent_id (item_tmp->device_old);
-		for (guint j = 0; ids[j] != NULL; j++) {
-			if (strncmp (ids[j], device_id, device_id_len) == 0) {
-				if (item != NULL && multiple_matches != NULL)
-					*multiple_matches = TRUE;
-				item = item_tmp;
-			}
-		}
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
-	return item;
+	return fu_device_list_find_by_id_prefix (self, device_id, TRUE, multiple_matches);
 }
 
 /**
@@ -342,57 +597,29 @@ fu_device_list_get_old (FuDeviceList *self, FuDevice *device)
 static FuDeviceItem *
 fu_device_list_get_by_guids (FuDeviceList *self, GPtrArray *guids)
 {
+	FuDeviceItem *item;
 	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
-	}
-	return NULL;
+	item = fu_device_list_index_lookup_guids (self, FU_DEVICE_LIST_INDEX_KIND_GUID,
+						  guids, FALSE);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup_guids (self, FU_DEVICE_LIST_INDEX_KIND_GUID_OLD,
+						  guids, FALSE);
 }
 
 static FuDeviceItem *
 fu_device_list_get_by_guids_removed (FuDeviceList *self, GPtrArray *guids)
 {
+	FuDeviceItem *item;
 	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
-	}
-	return NULL;
+	item = fu_device_list_index_lookup_guids (self, FU_DEVICE_LIST_INDEX_KIND_GUID,
+						  guids, TRUE);
+	if (item != NULL)
+		return item;
+	return fu_device_list_index_lookup_guids (self, FU_DEVICE_LIST_INDEX_KIND_GUID_OLD,
+						  guids, TRUE);
 }
 
 static gboolean
@@ -635,8 +862,13 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 	}
 
 	/* assign the new device */
+	fu_device_list_item_unwatch (item);
 	g_set_object (&item->device_old, item->device);
 	fu_device_list_item_set_device (item, device);
+	fu_device_list_item_watch (item);
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	fu_device_list_index_update_item (self, item);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
 	fu_device_list_emit_device_changed (self, device);
 
 	/* we were waiting for this... */
@@ -761,9 +993,14 @@ fu_device_list_add (FuDeviceList *self, FuDevice *device)
 	/* add helper */
 	item = g_new0 (FuDeviceItem, 1);
 	item->self = self; /* no ref */
+	item->index_keys = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_index_key_free);
+	item->index_ids = g_ptr_array_new ();
 	fu_device_list_item_set_device (item, device);
+	fu_device_list_item_watch (item);
 	g_rw_lock_writer_lock (&self->devices_mutex);
+	item->serial = self->serial_next++;
 	g_ptr_array_add (self->devices, item);
+	fu_device_list_index_update_item (self, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
 	fu_device_list_emit_device_added (self, device);
 }
@@ -852,8 +1089,9 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 		return TRUE;
 	}
 
-	/* check that no other devices are waiting for replug too */
-	for (guint i = 0; i < self->devices->len; i++) {
+	/* check that no other devices are waiting for replug too, unless
+	 * unrelated devices are being updated at the same time */
+	for (guint i = 0; !self->concurrent_replug && i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
 		if (item_tmp->device != device &&
 		    fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
@@ -905,7 +1143,7 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 	}
 
 	/* check that no other devices are waiting for replug instead */
-	for (guint i = 0; i < self->devices->len; i++) {
+	for (guint i = 0; !self->concurrent_replug && i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
 		if (fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
 			g_warning ("%s is wait-for-replug when %s performed",
@@ -919,6 +1157,21 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 	return TRUE;
 }
 
+/**
+ * fu_device_list_set_concurrent_replug:
+ * @self: A #FuDeviceList
+ * @concurrent_replug: boolean
+ *
+ * Sets if more than one device is allowed to wait for replug at the same time,
+ * which is only expected when unrelated devices are being updated in parallel.
+ **/
+void
+fu_device_list_set_concurrent_replug (FuDeviceList *self, gboolean concurrent_replug)
+{
+	g_return_if_fail (FU_IS_DEVICE_LIST (self));
+	self->concurrent_replug = concurrent_replug;
+}
+
 /**
  * fu_device_list_get_by_id:
  * @self: A #FuDeviceList
@@ -967,14 +1220,19 @@ fu_device_list_get_by_id (FuDeviceList *self, const gchar *device_id, GError **e
 	return g_object_ref (item->device);
 }
 
+/* must be called with the devices_mutex held for writing */
 static void
 fu_device_list_item_free (FuDeviceItem *item)
 {
 	if (item->remove_id != 0)
 		g_source_remove (item->remove_id);
+	fu_device_list_item_unwatch (item);
+	fu_device_list_index_remove_item (item->self, item);
 	if (item->device_old != NULL)
 		g_object_unref (item->device_old);
 	fu_device_list_item_set_device (item, NULL);
+	g_ptr_array_unref (item->index_keys);
+	g_ptr_array_unref (item->index_ids);
 	g_free (item);
 }
 
@@ -1005,6 +1263,11 @@ static void
 fu_device_list_init (FuDeviceList *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_item_free);
+	for (guint i = 0; i < FU_DEVICE_LIST_INDEX_KIND_LAST; i++) {
+		self->index[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, (GDestroyNotify) g_ptr_array_unref);
+	}
+	self->index_ids = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_id_entry_free);
 	g_rw_lock_init (&self->devices_mutex);
 }
 
@@ -1015,6 +1278,9 @@ fu_device_list_finalize (GObject *obj)
 
 	g_rw_lock_clear (&self->devices_mutex);
 	g_ptr_array_unref (self->devices);
+	for (guint i = 0; i < FU_DEVICE_LIST_INDEX_KIND_LAST; i++)
+		g_hash_table_unref (self->index[i]);
+	g_ptr_array_unref (self->index_ids);
 
 	G_OBJECT_CLASS (fu_device_list_parent_class)->finalize (obj);
 }
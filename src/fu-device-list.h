@@ -31,5 +31,7 @@ FuDevice	*fu_device_list_get_by_guid		(FuDeviceList	*self,
 gboolean	 fu_device_list_wait_for_replug		(FuDeviceList	*self,
 							 FuDevice	*device,
 							 GError		**error);
+void		 fu_device_list_set_concurrent_replug	(FuDeviceList	*self,
+							 gboolean	 concurrent_replug);
 void		 fu_device_list_depsolve_order		(FuDeviceList	*self,
 							 FuDevice	*device);
@@ -13,6 +13,7 @@
 #include <gio/gunixinputstream.h>
 #endif
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #ifdef HAVE_GUDEV
 #include <gudev/gudev.h>
 #endif
@@ -67,9 +68,42 @@
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
 #endif
+#ifdef HAVE_ZSTD
+#include "fu-zstd-decompressor.h"
+#endif
+
+/* the compressed metadata is streamed to disk, but is still mapped for
+ * verification and so has to have a sensible limit */
+#define FU_ENGINE_METADATA_SIZE_MAX	0x2000000 /* 32MB */
 
 static void fu_engine_finalize	 (GObject *obj);
 static void fu_engine_ensure_security_attrs	(FuEngine *self);
+static void fu_engine_emit_device_changed	(FuEngine *self,
+						 FuDevice *device);
+static void fu_engine_set_status		(FuEngine *self,
+						 FwupdStatus status);
+static void fu_engine_set_percentage		(FuEngine *self,
+						 guint percentage);
+static void fu_engine_plugin_device_register	(FuEngine *self,
+						 FuDevice *device);
+static void fu_engine_plugin_device_added_cb	(FuPlugin *plugin,
+						 FuDevice *device,
+						 gpointer user_data);
+static void fu_engine_plugin_device_removed_cb	(FuPlugin *plugin,
+						 FuDevice *device,
+						 gpointer user_data);
+static void fu_engine_plugin_rules_changed_cb	(FuPlugin *plugin,
+						 gpointer user_data);
+static void fu_engine_plugin_security_changed_cb (FuPlugin *plugin,
+						 gpointer user_data);
+static void fu_engine_plugin_recoldplug_cb	(FuPlugin *plugin,
+						 FuEngine *self);
+static void fu_engine_plugin_set_coldplug_delay_cb (FuPlugin *plugin,
+						 guint duration,
+						 FuEngine *self);
+static gboolean fu_engine_plugin_check_supported_cb (FuPlugin *plugin,
+						 const gchar *guid,
+						 FuEngine *self);
 
 struct _FuEngine
 {
@@ -87,15 +121,32 @@ struct _FuEngine
 	guint			 percentage;
 	FuHistory		*history;
 	FuIdle			*idle;
-	XbSilo			*silo;
+	GPtrArray		*silos;			/* of XbSilo, one per remote */
+	GHashTable		*silo_guid_index;	/* (nullable): guid:GPtrArray of XbNode */
 	gboolean		 coldplug_running;
 	guint			 coldplug_id;
 	guint			 coldplug_delay;
+	GThread			*coldplug_thread;	/* thread that started coldplug */
+	GAsyncQueue		*coldplug_events;	/* (nullable): of FuEngineColdplugEvent */
+	GMutex			 install_hooks_mutex;	/* for the plugin-wide update hooks */
+	GThread			*install_thread;	/* (nullable): thread that started the install */
+	gboolean		 install_running;	/* main context is dispatched during installs */
+	GHashTable		*install_progress;	/* (nullable): device-id:percentage */
+	GMutex			 install_progress_mutex;
+	FuProbeCache		*probe_cache;		/* (nullable) */
+	GPtrArray		*probe_cache_revalidate;	/* of FuDevice */
+	guint			 probe_cache_revalidate_id;
 	FuPluginList		*plugin_list;
 	GPtrArray		*plugin_filter;
 	GPtrArray		*udev_subsystems;
 #ifdef HAVE_GUDEV
 	GHashTable		*udev_changed_ids;	/* sysfs:FuEngineUdevChangedHelper */
+	GHashTable		*udev_changed_plugins;	/* subsystem:GPtrArray of FuPlugin */
+	gboolean		 udev_changed_plugins_dirty;
+	GHashTable		*udev_devices;		/* sysfs:GPtrArray of FuDevice */
+	gint			 udev_devices_dirty;	/* atomic, set from coldplug threads */
+	guint			 udev_changed_dispatched;
+	guint			 udev_changed_skipped;
 #endif
 	FuSmbios		*smbios;
 	FuHwids			*hwids;
@@ -142,14 +193,97 @@ fu_engine_emit_changed (FuEngine *self)
 	}
 }
 
+typedef enum {
+	FU_ENGINE_SIGNAL_KIND_DEVICE_CHANGED,
+	FU_ENGINE_SIGNAL_KIND_STATUS_CHANGED,
+	FU_ENGINE_SIGNAL_KIND_PERCENTAGE_CHANGED,
+} FuEngineSignalKind;
+
+typedef struct {
+	FuEngine		*self;
+	FuEngineSignalKind	 kind;
+	FuDevice		*device;	/* (nullable) */
+	guint			 value;
+} FuEngineSignalHelper;
+
+static gboolean
+fu_engine_signal_invoke_cb (gpointer user_data)
+{
+	FuEngineSignalHelper *helper = (FuEngineSignalHelper *) user_data;
+	switch (helper->kind) {
+	case FU_ENGINE_SIGNAL_KIND_DEVICE_CHANGED:
+		fu_engine_emit_device_changed (helper->self, helper->device);
+		break;
+	case FU_ENGINE_SIGNAL_KIND_STATUS_CHANGED:
+		fu_engine_set_status (helper->self, helper->value);
+		break;
+	case FU_ENGINE_SIGNAL_KIND_PERCENTAGE_CHANGED:
+		fu_engine_set_percentage (helper->self, helper->value);
+		break;
+	default:
+		break;
+	}
+	if (helper->device != NULL)
+		g_object_unref (helper->device);
+	g_object_unref (helper->self);
+	g_free (helper);
+	return G_SOURCE_REMOVE;
+}
+
+/* the signals are only emitted from the thread that started the install, as
+ * the D-Bus daemon is not thread safe */
+static gboolean
+fu_engine_signal_defer (FuEngine *self,
+			FuEngineSignalKind kind,
+			FuDevice *device,
+			guint value)
+{
+	FuEngineSignalHelper *helper;
+
+	if (self->install_thread == NULL || g_thread_self () == self->install_thread)
+		return FALSE;
+	helper = g_new0 (FuEngineSignalHelper, 1);
+	helper->self = g_object_ref (self);
+	helper->kind = kind;
+	if (device != NULL)
+		helper->device = g_object_ref (device);
+	helper->value = value;
+	g_main_context_invoke (NULL, fu_engine_signal_invoke_cb, helper);
+	return TRUE;
+}
+
 static void
 fu_engine_emit_device_changed (FuEngine *self, FuDevice *device)
 {
+	if (fu_engine_signal_defer (self, FU_ENGINE_SIGNAL_KIND_DEVICE_CHANGED, device, 0))
+		return;
+
 	/* invalidate host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
 }
 
+/* devices set up from the probe cache are not ready until the hardware has
+ * been used to check the cached state, and are removed if that fails */
+static gboolean
+fu_engine_ensure_device_ready (FuEngine *self, FuDevice *device, GError **error)
+{
+	if (!fu_device_get_setup_cached (device))
+		return TRUE;
+	if (!fu_device_revalidate_setup (device, error)) {
+		g_prefix_error (error, "failed to revalidate %s: ",
+				fu_device_get_id (device));
+		fu_device_list_remove (self->device_list, device);
+		return FALSE;
+	}
+
+	/* the plugins were not told about the device until now */
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_REGISTERED))
+		fu_engine_plugin_device_register (self, device);
+	fu_engine_emit_device_changed (self, device);
+	return TRUE;
+}
+
 static gint
 fu_engine_gtypes_sort_cb (gconstpointer a, gconstpointer b)
 {
@@ -201,6 +335,8 @@ fu_engine_get_status (FuEngine *self)
 static void
 fu_engine_set_status (FuEngine *self, FwupdStatus status)
 {
+	if (fu_engine_signal_defer (self, FU_ENGINE_SIGNAL_KIND_STATUS_CHANGED, NULL, status))
+		return;
 	if (self->status == status)
 		return;
 	self->status = status;
@@ -214,6 +350,8 @@ fu_engine_set_status (FuEngine *self, FwupdStatus status)
 static void
 fu_engine_set_percentage (FuEngine *self, guint percentage)
 {
+	if (fu_engine_signal_defer (self, FU_ENGINE_SIGNAL_KIND_PERCENTAGE_CHANGED, NULL, percentage))
+		return;
 	if (self->percentage == percentage)
 		return;
 	self->percentage = percentage;
@@ -222,12 +360,33 @@ fu_engine_set_percentage (FuEngine *self, guint percentage)
 	g_signal_emit (self, signals[SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
 }
 
+/* when devices are being updated in parallel show the average */
+static guint
+fu_engine_install_progress_update (FuEngine *self, FuDevice *device)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint percentage = 0;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_progress_mutex);
+
+	if (self->install_progress == NULL ||
+	    !g_hash_table_contains (self->install_progress, fu_device_get_id (device)))
+		return fu_device_get_progress (device);
+	g_hash_table_insert (self->install_progress,
+			     g_strdup (fu_device_get_id (device)),
+			     GUINT_TO_POINTER (fu_device_get_progress (device)));
+	g_hash_table_iter_init (&iter, self->install_progress);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		percentage += GPOINTER_TO_UINT (value);
+	return percentage / g_hash_table_size (self->install_progress);
+}
+
 static void
 fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
 	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
 		return;
-	fu_engine_set_percentage (self, fu_device_get_progress (device));
+	fu_engine_set_percentage (self, fu_engine_install_progress_update (self, device));
 	fu_engine_emit_device_changed (self, device);
 }
 
@@ -259,6 +418,9 @@ fu_engine_watch_device (FuEngine *self, FuDevice *device)
 static void
 fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+#ifdef HAVE_GUDEV
+	g_atomic_int_set (&self->udev_devices_dirty, TRUE);
+#endif
 	fu_engine_watch_device (self, device);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
@@ -276,6 +438,9 @@ fu_engine_device_runner_device_removed (FuEngine *self, FuDevice *device)
 static void
 fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+#ifdef HAVE_GUDEV
+	g_atomic_int_set (&self->udev_devices_dirty, TRUE);
+#endif
 	fu_engine_device_runner_device_removed (self, device);
 	g_signal_handlers_disconnect_by_data (device, self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
@@ -284,6 +449,9 @@ fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngi
 static void
 fu_engine_device_changed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+#ifdef HAVE_GUDEV
+	g_atomic_int_set (&self->udev_devices_dirty, TRUE);
+#endif
 	fu_engine_watch_device (self, device);
 	fu_engine_emit_device_changed (self, device);
 }
@@ -474,14 +642,16 @@ static const gchar *
 fu_engine_get_remote_id_for_checksum (FuEngine *self, const gchar *csum)
 {
 	g_autofree gchar *xpath = NULL;
-	g_autoptr(XbNode) key = NULL;
 	xpath = g_strdup_printf ("components/component/releases/release/"
 				 "checksum[@target='container'][text()='%s']/../../"
 				 "../../custom/value[@key='fwupd::RemoteId']", csum);
-	key = xb_silo_query_first (self->silo, xpath, NULL);
-	if (key == NULL)
-		return NULL;
-	return xb_node_get_text (key);
+	for (guint i = 0; i < self->silos->len; i++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, i);
+		g_autoptr(XbNode) key = xb_silo_query_first (silo, xpath, NULL);
+		if (key != NULL)
+			return xb_node_get_text (key);
+	}
+	return NULL;
 }
 
 /**
@@ -535,6 +705,7 @@ fu_engine_modify_config (FuEngine *self, const gchar *key, const gchar *value, G
 		"BlockedFirmware",
 		"DisabledPlugins",
 		"IdleTimeout",
+		"ColdplugThreadsMax",
 		"VerboseDomains",
 		"UpdateMotd",
 		"EnumerateAllDevices",
@@ -704,6 +875,8 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return FALSE;
+	if (!fu_engine_ensure_device_ready (self, device, error))
+		return FALSE;
 
 	/* get the plugin */
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -779,22 +952,113 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	return TRUE;
 }
 
+static void
+fu_engine_silo_guid_index_add_component (FuEngine *self, XbNode *component)
+{
+	g_autoptr(GPtrArray) children = xb_node_get_children (component);
+
+	/* equivalent to provides/firmware[@type='flashed'] */
+	for (guint i = 0; i < children->len; i++) {
+		XbNode *provides = g_ptr_array_index (children, i);
+		g_autoptr(GPtrArray) firmwares = NULL;
+		if (g_strcmp0 (xb_node_get_element (provides), "provides") != 0)
+			continue;
+		firmwares = xb_node_get_children (provides);
+		for (guint j = 0; j < firmwares->len; j++) {
+			XbNode *firmware = g_ptr_array_index (firmwares, j);
+			GPtrArray *components;
+			const gchar *guid;
+			if (g_strcmp0 (xb_node_get_element (firmware), "firmware") != 0)
+				continue;
+			if (g_strcmp0 (xb_node_get_attr (firmware, "type"), "flashed") != 0)
+				continue;
+			guid = xb_node_get_text (firmware);
+			if (guid == NULL)
+				continue;
+			components = g_hash_table_lookup (self->silo_guid_index, guid);
+			if (components == NULL) {
+				components = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+				g_hash_table_insert (self->silo_guid_index,
+						     g_strdup (guid), components);
+			}
+
+			/* a component may list the same GUID more than once */
+			if (components->len > 0 &&
+			    g_ptr_array_index (components, components->len - 1) == component)
+				continue;
+			g_ptr_array_add (components, g_object_ref (component));
+		}
+	}
+}
+
+/* the silo is immutable, so this only has to be built once each time it is
+ * replaced rather than doing an XPath query for every device; it is never
+ * built lazily so that readers on other threads do not race to create it */
+static void
+fu_engine_build_silo_guid_index (FuEngine *self)
+{
+	guint components_cnt = 0;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_clear_pointer (&self->silo_guid_index, g_hash_table_unref);
+	self->silo_guid_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free,
+						       (GDestroyNotify) g_ptr_array_unref);
+	for (guint j = 0; j < self->silos->len; j++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, j);
+		g_autoptr(GPtrArray) components = NULL;
+		components = xb_silo_query (silo, "components/component", 0, NULL);
+		if (components == NULL)
+			continue;
+		for (guint i = 0; i < components->len; i++) {
+			XbNode *component = g_ptr_array_index (components, i);
+			fu_engine_silo_guid_index_add_component (self, component);
+		}
+		components_cnt += components->len;
+	}
+	g_debug ("indexed %u GUIDs from %u components in %.1fms",
+		 g_hash_table_size (self->silo_guid_index),
+		 components_cnt,
+		 g_timer_elapsed (timer, NULL) * 1000.f);
+}
+
+/* returns components in the same order as the XPath union of each GUID */
+static GPtrArray *
+fu_engine_get_components_by_guids (FuEngine *self, GPtrArray *guids)
+{
+	GPtrArray *components = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GHashTable) components_seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	/* no metadata loaded */
+	if (self->silo_guid_index == NULL)
+		return components;
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		GPtrArray *components_tmp = g_hash_table_lookup (self->silo_guid_index, guid);
+		if (components_tmp == NULL)
+			continue;
+		for (guint j = 0; j < components_tmp->len; j++) {
+			XbNode *component = g_ptr_array_index (components_tmp, j);
+			if (!g_hash_table_add (components_seen, component))
+				continue;
+			g_ptr_array_add (components, g_object_ref (component));
+		}
+	}
+	return components;
+}
+
 XbNode *
 fu_engine_get_component_by_guids (FuEngine *self, FuDevice *device)
 {
 	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(GString) xpath = g_string_new (NULL);
-	g_autoptr(XbNode) component = NULL;
+	if (self->silo_guid_index == NULL)
+		return NULL;
 	for (guint i = 0; i < guids->len; i++) {
 		const gchar *guid = g_ptr_array_index (guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type='flashed'][text()='%s']/"
-					"../..", guid);
+		GPtrArray *components = g_hash_table_lookup (self->silo_guid_index, guid);
+		if (components != NULL && components->len > 0)
+			return g_object_ref (g_ptr_array_index (components, 0));
 	}
-	component = xb_silo_query_first (self->silo, xpath->str, NULL);
-	if (component != NULL)
-		return g_steal_pointer (&component);
 	return NULL;
 }
 
@@ -855,47 +1119,51 @@ fu_engine_verify_from_system_metadata (FuEngine *self,
 {
 	FwupdVersionFormat fmt = fu_device_get_version_format (device);
 	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(XbQuery) query = NULL;
 
-	/* prepare query with bound GUID parameter */
-	query = xb_query_new_full (self->silo,
-				   "components/component/"
-				   "provides/firmware[@type='flashed'][text()=?]/"
-				   "../../releases/release",
-				   XB_QUERY_FLAG_OPTIMIZE |
-				   XB_QUERY_FLAG_USE_INDEXES,
-				   error);
-	if (query == NULL)
-		return NULL;
+	/* prepare query with bound GUID parameter for each remote */
+	for (guint k = 0; k < self->silos->len; k++) {
+		XbSilo *silo = g_ptr_array_index (self->silos, k);
+		g_autoptr(XbQuery) query = NULL;
+
+		query = xb_query_new_full (silo,
+					   "components/component/"
+					   "provides/firmware[@type='flashed'][text()=?]/"
+					   "../../releases/release",
+					   XB_QUERY_FLAG_OPTIMIZE |
+					   XB_QUERY_FLAG_USE_INDEXES,
+					   error);
+		if (query == NULL)
+			return NULL;
 
-	/* use prepared query for each GUID */
-	for (guint i = 0; i < guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (guids, i);
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GPtrArray) releases = NULL;
+		/* use prepared query for each GUID */
+		for (guint i = 0; i < guids->len; i++) {
+			const gchar *guid = g_ptr_array_index (guids, i);
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(GPtrArray) releases = NULL;
 
-		/* bind GUID and then query */
-		if (!xb_query_bind_str (query, 0, guid, error)) {
-			g_prefix_error (error, "failed to bind string: ");
-			return NULL;
-		}
-		releases = xb_silo_query_full (self->silo, query, &error_local);
-		if (releases == NULL) {
-			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-			    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-				g_debug ("could not find %s: %s",
-					 guid, error_local->message);
-				continue;
+			/* bind GUID and then query */
+			if (!xb_query_bind_str (query, 0, guid, error)) {
+				g_prefix_error (error, "failed to bind string: ");
+				return NULL;
+			}
+			releases = xb_silo_query_full (silo, query, &error_local);
+			if (releases == NULL) {
+				if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+				    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
+					g_debug ("could not find %s: %s",
+						 guid, error_local->message);
+					continue;
+				}
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return NULL;
+			}
+			for (guint j = 0; j < releases->len; j++) {
+				XbNode *rel = g_ptr_array_index (releases, j);
+				const gchar *rel_ver = xb_node_get_attr (rel, "version");
+				g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
+				if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
+					return g_object_ref (rel);
 			}
-			g_propagate_error (error, g_steal_pointer (&error_local));
-			return NULL;
-		}
-		for (guint j = 0; j < releases->len; j++) {
-			XbNode *rel = g_ptr_array_index (releases, j);
-			const gchar *rel_ver = xb_node_get_attr (rel, "version");
-			g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
-			if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
-				return g_object_ref (rel);
 		}
 	}
 
@@ -936,6 +1204,8 @@ fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return FALSE;
+	if (!fu_engine_ensure_device_ready (self, device, error))
+		return FALSE;
 
 	/* get the plugin */
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -1753,30 +2023,278 @@ fu_engine_composite_cleanup (FuEngine *self, GPtrArray *devices, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	GPtrArray		*install_tasks;	/* of FuInstallTask, run in order */
+	GError			*error;
+} FuEngineInstallGroup;
+
+typedef struct {
+	FuEngine		*self;
+	GBytes			*blob_cab;
+	FwupdInstallFlags	 flags;
+	GAsyncQueue		*done;		/* of FuEngineInstallGroup */
+} FuEngineInstallHelper;
+
+static void
+fu_engine_install_group_free (FuEngineInstallGroup *group)
+{
+	g_ptr_array_unref (group->install_tasks);
+	if (group->error != NULL)
+		g_error_free (group->error);
+	g_free (group);
+}
+
+static void
+fu_engine_install_group_run (FuEngineInstallHelper *helper, FuEngineInstallGroup *group)
+{
+	for (guint i = 0; i < group->install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (group->install_tasks, i);
+		if (!fu_engine_install (helper->self, task, helper->blob_cab,
+					helper->flags, &group->error))
+			return;
+	}
+}
+
+static void
+fu_engine_install_group_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineInstallGroup *group = (FuEngineInstallGroup *) data;
+	FuEngineInstallHelper *helper = (FuEngineInstallHelper *) user_data;
+	fu_engine_install_group_run (helper, group);
+	g_async_queue_push (helper->done, group);
+
+	/* the install thread is blocked in the main context */
+	g_main_context_wakeup (NULL);
+}
+
+static guint
+fu_engine_install_tasks_partition_root (guint *roots, guint idx)
+{
+	while (roots[idx] != idx)
+		idx = roots[idx];
+	return idx;
+}
+
+/* devices handled by the same plugin are only updated at the same time if the
+ * plugin has opted in, as most plugins keep per-plugin state */
+static gboolean
+fu_engine_install_tasks_share_plugin (FuEngine *self,
+				      FuInstallTask *task1,
+				      FuInstallTask *task2)
+{
+	FuPlugin *plugin;
+	const gchar *plugin_name;
+	g_autoptr(GError) error_local = NULL;
+
+	plugin_name = fu_device_get_plugin (fu_install_task_get_device (task1));
+	if (plugin_name == NULL ||
+	    g_strcmp0 (plugin_name,
+		       fu_device_get_plugin (fu_install_task_get_device (task2))) != 0)
+		return FALSE;
+	plugin = fu_plugin_list_find_by_name (self->plugin_list, plugin_name, &error_local);
+	if (plugin == NULL)
+		return TRUE;
+	return !fu_plugin_has_thread_flag (plugin, FU_PLUGIN_THREAD_FLAG_UPDATE);
+}
+
 /**
- * fu_engine_install_tasks:
+ * fu_engine_get_install_groups:
  * @self: A #FuEngine
- * @request: A #FuEngineRequest
- * @install_tasks: (element-type FuInstallTask): A #FuDevice
- * @blob_cab: The #GBytes of the .cab file
- * @flags: The #FwupdInstallFlags, e.g. %FWUPD_DEVICE_FLAG_UPDATABLE
- * @error: A #GError, or %NULL
- *
- * Installs a specific firmware file on one or more install tasks.
+ * @install_tasks: (element-type FuInstallTask): tasks with the same order
  *
- * By this point all the requirements and tests should have been done in
- * fu_engine_check_requirements() so this should not fail before running
- * the plugin loader.
+ * Splits the install tasks into groups that can be installed at the same
+ * time. Tasks that depend on each other, directly or through another task,
+ * or that share a plugin that has not opted in to concurrent updates are
+ * put into the same group, keeping the original order.
  *
- * Returns: %TRUE for success
+ * Returns: (transfer container) (element-type GPtrArray): groups of #FuInstallTask
  **/
-gboolean
-fu_engine_install_tasks (FuEngine *self,
-			 FuEngineRequest *request,
-			 GPtrArray *install_tasks,
-			 GBytes *blob_cab,
-			 FwupdInstallFlags flags,
-			 GError **error)
+GPtrArray *
+fu_engine_get_install_groups (FuEngine *self, GPtrArray *install_tasks)
+{
+	GPtrArray *groups = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	g_autofree guint *roots = g_new0 (guint, install_tasks->len);
+	g_autoptr(GHashTable) groups_by_root = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+
+	for (guint i = 0; i < install_tasks->len; i++)
+		roots[i] = i;
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task1 = g_ptr_array_index (install_tasks, i);
+		for (guint j = i + 1; j < install_tasks->len; j++) {
+			FuInstallTask *task2 = g_ptr_array_index (install_tasks, j);
+			guint root_i;
+			guint root_j;
+			if (fu_install_task_is_independent (task1, task2) &&
+			    !fu_engine_install_tasks_share_plugin (self, task1, task2))
+				continue;
+			root_i = fu_engine_install_tasks_partition_root (roots, i);
+			root_j = fu_engine_install_tasks_partition_root (roots, j);
+			roots[MAX (root_i, root_j)] = MIN (root_i, root_j);
+		}
+	}
+	for (guint i = 0; i < install_tasks->len; i++) {
+		GPtrArray *group;
+		guint root = fu_engine_install_tasks_partition_root (roots, i);
+		group = g_hash_table_lookup (groups_by_root, GUINT_TO_POINTER (root));
+		if (group == NULL) {
+			group = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_hash_table_insert (groups_by_root, GUINT_TO_POINTER (root), group);
+			g_ptr_array_add (groups, group);
+		}
+		g_ptr_array_add (group, g_object_ref (g_ptr_array_index (install_tasks, i)));
+	}
+	return groups;
+}
+
+static void
+fu_engine_install_progress_setup (FuEngine *self, GPtrArray *install_tasks)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_progress_mutex);
+	g_clear_pointer (&self->install_progress, g_hash_table_unref);
+	if (install_tasks == NULL)
+		return;
+	self->install_progress = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
+		FuDevice *device = fu_install_task_get_device (task);
+		g_hash_table_insert (self->install_progress,
+				     g_strdup (fu_device_get_id (device)),
+				     GUINT_TO_POINTER (0));
+	}
+}
+
+/* the device events are processed in this thread while the groups are
+ * installed on the pool, as some devices have to replug during the update */
+static gboolean
+fu_engine_install_groups (FuEngine *self,
+			  GPtrArray *install_tasks,
+			  GPtrArray *groups,
+			  guint threads_max,
+			  GBytes *blob_cab,
+			  FwupdInstallFlags flags,
+			  GError **error)
+{
+	FuEngineInstallHelper helper = { self, blob_cab, flags, NULL };
+	GThreadPool *pool;
+	guint done = 0;
+	guint threads_used = MIN (threads_max, groups->len);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	pool = g_thread_pool_new (fu_engine_install_group_thread_cb, &helper,
+				  threads_used, FALSE, error);
+	if (pool == NULL)
+		return FALSE;
+	helper.done = g_async_queue_new ();
+	fu_engine_install_progress_setup (self, install_tasks);
+	fu_device_list_set_concurrent_replug (self->device_list, TRUE);
+
+	/* own the context so the signals from the pool are always deferred
+	 * to this thread rather than being run in the worker */
+	if (!g_main_context_acquire (NULL))
+		g_warning ("failed to acquire main context, signals may be emitted from worker threads");
+	self->install_thread = g_thread_self ();
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!g_thread_pool_push (pool, group, &error_local)) {
+			g_warning ("failed to schedule install, running now: %s",
+				   error_local->message);
+			fu_engine_install_group_run (&helper, group);
+			done++;
+		}
+	}
+
+	/* sleep until there are events or a worker has finished a group */
+	while (done < groups->len) {
+		g_main_context_iteration (NULL, TRUE);
+		while (g_async_queue_try_pop (helper.done) != NULL)
+			done++;
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_async_queue_unref (helper.done);
+
+	/* emit any signals the last group deferred */
+	while (g_main_context_iteration (NULL, FALSE));
+	self->install_thread = NULL;
+	g_main_context_release (NULL);
+	fu_device_list_set_concurrent_replug (self->device_list, FALSE);
+	fu_engine_install_progress_setup (self, NULL);
+	g_debug ("installed %u groups using %u threads in %.1fms",
+		 groups->len, threads_used,
+		 g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* all groups have finished, so report the first failure */
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		if (group->error != NULL) {
+			g_propagate_error (error, g_steal_pointer (&group->error));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* all the tasks in @install_tasks have the same order */
+static gboolean
+fu_engine_install_tasks_stage (FuEngine *self,
+			       GPtrArray *install_tasks,
+			       GBytes *blob_cab,
+			       FwupdInstallFlags flags,
+			       GError **error)
+{
+	guint threads_max = fu_config_get_install_threads_max (self->config);
+
+	/* run the groups of dependent devices at the same time */
+	if (threads_max == 0)
+		threads_max = g_get_num_processors ();
+	if (threads_max > 1 && install_tasks->len > 1) {
+		g_autoptr(GPtrArray) tasks_groups = fu_engine_get_install_groups (self, install_tasks);
+		if (tasks_groups->len > 1) {
+			g_autoptr(GPtrArray) groups = NULL;
+			groups = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_install_group_free);
+			for (guint i = 0; i < tasks_groups->len; i++) {
+				FuEngineInstallGroup *group = g_new0 (FuEngineInstallGroup, 1);
+				group->install_tasks = g_ptr_array_ref (g_ptr_array_index (tasks_groups, i));
+				g_ptr_array_add (groups, group);
+			}
+			return fu_engine_install_groups (self, install_tasks, groups,
+							 threads_max, blob_cab,
+							 flags, error);
+		}
+	}
+
+	/* one at a time */
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
+		if (!fu_engine_install (self, task, blob_cab, flags, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the main context is dispatched while installing, so the D-Bus methods that
+ * change the devices or the metadata can be called again before it returns */
+static gboolean
+fu_engine_check_install_running (FuEngine *self, GError **error)
+{
+	if (!self->install_running)
+		return TRUE;
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "An update is already in progress");
+	return FALSE;
+}
+
+static gboolean
+fu_engine_install_tasks_internal (FuEngine *self,
+				  FuEngineRequest *request,
+				  GPtrArray *install_tasks,
+				  GBytes *blob_cab,
+				  FwupdInstallFlags flags,
+				  GError **error)
 {
 	g_autoptr(FuIdleLocker) locker = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
@@ -1790,19 +2308,32 @@ fu_engine_install_tasks (FuEngine *self,
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < install_tasks->len; i++) {
 		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
-		g_debug ("composite update %u: %s", i + 1,
-			 fu_device_get_id (fu_install_task_get_device (task)));
-		g_ptr_array_add (devices, g_object_ref (fu_install_task_get_device (task)));
+		FuDevice *device = fu_install_task_get_device (task);
+		g_debug ("composite update %u: %s", i + 1, fu_device_get_id (device));
+
+		/* the device has to be set up using the hardware first */
+		if (!fu_engine_ensure_device_ready (self, device, error))
+			return FALSE;
+		g_ptr_array_add (devices, g_object_ref (device));
 	}
 	if (!fu_engine_composite_prepare (self, devices, error)) {
 		g_prefix_error (error, "failed to prepare composite action: ");
 		return FALSE;
 	}
 
-	/* all authenticated, so install all the things */
-	for (guint i = 0; i < install_tasks->len; i++) {
+	/* all authenticated, so install all the things, where tasks with the
+	 * same order can be run at the same time if the devices are unrelated */
+	for (guint i = 0; i < install_tasks->len;) {
 		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
-		if (!fu_engine_install (self, task, blob_cab, flags, error)) {
+		guint j = i + 1;
+		g_autoptr(GPtrArray) stage = NULL;
+		while (j < install_tasks->len &&
+		       fu_install_task_compare (task, g_ptr_array_index (install_tasks, j)) == 0)
+			j++;
+		stage = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		for (; i < j; i++)
+			g_ptr_array_add (stage, g_object_ref (g_ptr_array_index (install_tasks, i)));
+		if (!fu_engine_install_tasks_stage (self, stage, blob_cab, flags, error)) {
 			g_autoptr(GError) error_local = NULL;
 			if (!fu_engine_composite_cleanup (self, devices, &error_local)) {
 				g_warning ("failed to cleanup failed composite action: %s",
@@ -1847,32 +2378,68 @@ fu_engine_install_tasks (FuEngine *self,
 	return TRUE;
 }
 
-static FwupdRelease *
-fu_engine_create_release_metadata (FuEngine *self,
-				   FuDevice *device,
-				   FuPlugin *plugin,
-				   GError **error)
-{
-	GPtrArray *metadata_sources;
-	g_autoptr(FwupdRelease) release = fwupd_release_new ();
-	g_autoptr(GHashTable) metadata_device = NULL;
-	g_autoptr(GHashTable) metadata_hash = NULL;
-
-	/* build the version metadata */
-	metadata_hash = fu_engine_get_report_metadata (self, error);
-	if (metadata_hash == NULL)
-		return NULL;
-	fwupd_release_add_metadata (release, metadata_hash);
-	if (fu_plugin_get_report_metadata (plugin) != NULL)
-		fwupd_release_add_metadata (release, fu_plugin_get_report_metadata (plugin));
-	metadata_device = fu_device_report_metadata_pre (device);
-	if (metadata_device != NULL)
-		fwupd_release_add_metadata (release, metadata_device);
-
-	/* allow other plugins to contribute metadata too */
-	metadata_sources = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_METADATA_SOURCE);
-	if (metadata_sources != NULL) {
-		for (guint i = 0; i < metadata_sources->len; i++) {
+/**
+ * fu_engine_install_tasks:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @install_tasks: (element-type FuInstallTask): A #FuDevice
+ * @blob_cab: The #GBytes of the .cab file
+ * @flags: The #FwupdInstallFlags, e.g. %FWUPD_DEVICE_FLAG_UPDATABLE
+ * @error: A #GError, or %NULL
+ *
+ * Installs a specific firmware file on one or more install tasks.
+ *
+ * By this point all the requirements and tests should have been done in
+ * fu_engine_check_requirements() so this should not fail before running
+ * the plugin loader.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_install_tasks (FuEngine *self,
+			 FuEngineRequest *request,
+			 GPtrArray *install_tasks,
+			 GBytes *blob_cab,
+			 FwupdInstallFlags flags,
+			 GError **error)
+{
+	gboolean ret;
+
+	if (!fu_engine_check_install_running (self, error))
+		return FALSE;
+	self->install_running = TRUE;
+	ret = fu_engine_install_tasks_internal (self, request, install_tasks,
+						blob_cab, flags, error);
+	self->install_running = FALSE;
+	return ret;
+}
+
+static FwupdRelease *
+fu_engine_create_release_metadata (FuEngine *self,
+				   FuDevice *device,
+				   FuPlugin *plugin,
+				   GError **error)
+{
+	GPtrArray *metadata_sources;
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GHashTable) metadata_device = NULL;
+	g_autoptr(GHashTable) metadata_hash = NULL;
+
+	/* build the version metadata */
+	metadata_hash = fu_engine_get_report_metadata (self, error);
+	if (metadata_hash == NULL)
+		return NULL;
+	fwupd_release_add_metadata (release, metadata_hash);
+	if (fu_plugin_get_report_metadata (plugin) != NULL)
+		fwupd_release_add_metadata (release, fu_plugin_get_report_metadata (plugin));
+	metadata_device = fu_device_report_metadata_pre (device);
+	if (metadata_device != NULL)
+		fwupd_release_add_metadata (release, metadata_device);
+
+	/* allow other plugins to contribute metadata too */
+	metadata_sources = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_METADATA_SOURCE);
+	if (metadata_sources != NULL) {
+		for (guint i = 0; i < metadata_sources->len; i++) {
 			FuPlugin *plugin_tmp;
 			const gchar *plugin_name = g_ptr_array_index (metadata_sources, i);
 			g_autoptr(GError) error_local = NULL;
@@ -2431,6 +2998,8 @@ fu_engine_get_device (FuEngine *self, const gchar *device_id, GError **error)
 	device1 = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device1 == NULL)
 		return NULL;
+	if (!fu_engine_ensure_device_ready (self, device1, error))
+		return NULL;
 
 	/* wait for device to disconnect and reconnect */
 	root = fu_device_get_root (device1);
@@ -2506,6 +3075,7 @@ fu_engine_update_prepare (FuEngine *self,
 	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
 	g_autofree gchar *str = NULL;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	/* the device and plugin both may have changed */
 	device = fu_engine_get_device (self, device_id, error);
@@ -2519,11 +3089,13 @@ fu_engine_update_prepare (FuEngine *self,
 	g_debug ("prepare -> %s", str);
 	if (!fu_engine_device_prepare (self, device, flags, error))
 		return FALSE;
+	locker = g_mutex_locker_new (&self->install_hooks_mutex);
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
 		if (!fu_plugin_runner_update_prepare (plugin_tmp, flags, device, error))
 			return FALSE;
 	}
+	g_clear_pointer (&locker, g_mutex_locker_free);
 
 	/* wait for device to disconnect and reconnect */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
@@ -2544,6 +3116,7 @@ fu_engine_update_cleanup (FuEngine *self,
 	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
 	g_autofree gchar *str = NULL;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	/* the device and plugin both may have changed */
 	device = fu_engine_get_device (self, device_id, error);
@@ -2553,11 +3126,13 @@ fu_engine_update_cleanup (FuEngine *self,
 	g_debug ("cleanup -> %s", str);
 	if (!fu_engine_device_cleanup (self, device, flags, error))
 		return FALSE;
+	locker = g_mutex_locker_new (&self->install_hooks_mutex);
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
 		if (!fu_plugin_runner_update_cleanup (plugin_tmp, flags, device, error))
 			return FALSE;
 	}
+	g_clear_pointer (&locker, g_mutex_locker_free);
 
 	/* wait for device to disconnect and reconnect */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
@@ -2633,6 +3208,8 @@ fu_engine_activate (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return FALSE;
+	if (!fu_engine_ensure_device_ready (self, device, error))
+		return FALSE;
 	str = fu_device_to_string (device);
 	g_debug ("activate -> %s", str);
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -2918,7 +3495,9 @@ fu_engine_set_silo (FuEngine *self, XbSilo *silo)
 {
 	g_return_if_fail (FU_IS_ENGINE (self));
 	g_return_if_fail (XB_IS_SILO (silo));
-	g_set_object (&self->silo, silo);
+	g_ptr_array_set_size (self->silos, 0);
+	g_ptr_array_add (self->silos, g_object_ref (silo));
+	fu_engine_build_silo_guid_index (self);
 }
 
 static gboolean
@@ -3230,19 +3809,33 @@ fu_engine_md_refresh_devices (FuEngine *self)
 	}
 }
 
-static gboolean
-fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+#ifdef HAVE_ZSTD
+static GInputStream *
+fu_engine_builder_source_zstd_cb (XbBuilderSource *source,
+				  XbBuilderSourceCtx *ctx,
+				  gpointer user_data,
+				  GCancellable *cancellable,
+				  GError **error)
 {
-	GPtrArray *remotes;
-	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
+	GInputStream *istream = xb_builder_source_ctx_get_stream (ctx);
+	g_autoptr(FuZstdDecompressor) conv = fu_zstd_decompressor_new ();
+	return g_converter_input_stream_new (istream, G_CONVERTER (conv));
+}
+#endif
+
+static XbSilo *
+fu_engine_load_metadata_store_remote (FuEngine *self,
+				      FwupdRemote *remote,
+				      XbBuilderCompileFlags compile_flags,
+				      GError **error)
+{
+	const gchar *path = fwupd_remote_get_filename_cache (remote);
 	g_autofree gchar *cachedirpkg = NULL;
+	g_autofree gchar *xmlbbasename = NULL;
 	g_autofree gchar *xmlbfn = NULL;
 	g_autoptr(GFile) xmlb = NULL;
-	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
-
-	/* clear existing silo */
-	g_clear_object (&self->silo);
+	g_autoptr(XbSilo) silo = NULL;
 
 	/* verbose profiling */
 	if (g_getenv ("FWUPD_XMLB_VERBOSE") != NULL) {
@@ -3251,45 +3844,30 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 					      XB_SILO_PROFILE_FLAG_DEBUG);
 	}
 
-	/* load each enabled metadata file */
-	remotes = fu_remote_list_get_all (self->remote_list);
-	for (guint i = 0; i < remotes->len; i++) {
-		const gchar *path = NULL;
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GFile) file = NULL;
+	/* generate all metadata on demand */
+	if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
+		g_debug ("building metadata for remote '%s'",
+			 fwupd_remote_get_id (remote));
+		if (!fu_engine_create_metadata (self, builder, remote, error))
+			return NULL;
+	} else {
+		g_autoptr(GFile) file = g_file_new_for_path (path);
 		g_autoptr(XbBuilderFixup) fixup = NULL;
 		g_autoptr(XbBuilderNode) custom = NULL;
 		g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
 
-		FwupdRemote *remote = g_ptr_array_index (remotes, i);
-		if (!fwupd_remote_get_enabled (remote))
-			continue;
-		path = fwupd_remote_get_filename_cache (remote);
-		if (!g_file_test (path, G_FILE_TEST_EXISTS))
-			continue;
-
-		/* generate all metadata on demand */
-		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
-			g_debug ("building metadata for remote '%s'",
-				 fwupd_remote_get_id (remote));
-			if (!fu_engine_create_metadata (self, builder, remote, &error_local)) {
-				g_warning ("failed to generate remote %s: %s",
-					   fwupd_remote_get_id (remote),
-					   error_local->message);
-			}
-			continue;
-		}
+		/* decompressed as the XML is parsed, like gzip */
+#ifdef HAVE_ZSTD
+		xb_builder_source_add_adapter (source, "application/zstd,.zst",
+					       fu_engine_builder_source_zstd_cb,
+					       NULL, NULL);
+#endif
 
 		/* save the remote-id in the custom metadata space */
-		file = g_file_new_for_path (path);
 		if (!xb_builder_source_load_file (source, file,
 						  XB_BUILDER_SOURCE_FLAG_NONE,
-						  NULL, &error_local)) {
-			g_warning ("failed to load remote %s: %s",
-				   fwupd_remote_get_id (remote),
-				   error_local->message);
-			continue;
-		}
+						  NULL, error))
+			return NULL;
 
 		/* fix up any legacy installed files */
 		fixup = xb_builder_fixup_new ("AppStreamUpgrade",
@@ -3309,37 +3887,131 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 					     "key", "fwupd::RemoteId",
 					     NULL);
 		xb_builder_source_set_info (source, custom);
-
-		/* we need to watch for changes? */
 		xb_builder_import_source (builder, source);
 	}
 
-	/* on a read-only filesystem don't care about the cache GUID */
-	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
-		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+	/* only recompile when the content of this remote changes */
+	if (fwupd_remote_get_checksum (remote) != NULL)
+		xb_builder_append_guid (builder, fwupd_remote_get_checksum (remote));
 
 	/* ensure silo is up to date */
 	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
-	xmlbfn = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
+	xmlbbasename = g_strdup_printf ("metadata-%s.xmlb", fwupd_remote_get_id (remote));
+	xmlbfn = g_build_filename (cachedirpkg, xmlbbasename, NULL);
 	xmlb = g_file_new_for_path (xmlbfn);
-	self->silo = xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
-	if (self->silo == NULL)
-		return FALSE;
-
-	/* print what we've got */
-	components = xb_silo_query (self->silo, "components/component", 0, NULL);
-	if (components != NULL)
-		g_debug ("%u components now in silo", components->len);
+	silo = xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
+	if (silo == NULL)
+		return NULL;
 
 	/* build the index */
-	if (!xb_silo_query_build_index (self->silo,
+	if (!xb_silo_query_build_index (silo,
 					"components/component/provides/firmware",
 					"type", error))
-		return FALSE;
-	if (!xb_silo_query_build_index (self->silo,
+		return NULL;
+	if (!xb_silo_query_build_index (silo,
 					"components/component/provides/firmware",
 					NULL, error))
-		return FALSE;
+		return NULL;
+
+	/* success */
+	return g_steal_pointer (&silo);
+}
+
+/* deletes the single silo used by older versions and the silos of any
+ * remotes that have since been removed */
+static void
+fu_engine_load_metadata_store_cleanup (FuEngine *self)
+{
+	const gchar *fn;
+	g_autofree gchar *cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autoptr(GDir) dir = NULL;
+
+	dir = g_dir_open (cachedirpkg, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *filename = NULL;
+		if (g_strcmp0 (fn, "metadata.xmlb") != 0) {
+			g_autofree gchar *remote_id = NULL;
+			if (!g_str_has_prefix (fn, "metadata-") ||
+			    !g_str_has_suffix (fn, ".xmlb"))
+				continue;
+			remote_id = g_strndup (fn + strlen ("metadata-"),
+					       strlen (fn) - strlen ("metadata-.xmlb"));
+			if (fu_remote_list_get_by_id (self->remote_list, remote_id) != NULL)
+				continue;
+		}
+		filename = g_build_filename (cachedirpkg, fn, NULL);
+		g_debug ("deleting unused %s", filename);
+		if (g_unlink (filename) != 0)
+			g_warning ("failed to delete %s", filename);
+	}
+}
+
+/* each remote is compiled into its own silo so that refreshing one remote
+ * does not have to recompile the metadata of all the others */
+static gboolean
+fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	GPtrArray *remotes;
+	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
+	guint components_cnt = 0;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* clear existing silos */
+	g_clear_pointer (&self->silo_guid_index, g_hash_table_unref);
+	g_ptr_array_set_size (self->silos, 0);
+
+	/* on a read-only filesystem don't care about the cache GUID */
+	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
+		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+
+	/* load each enabled metadata file */
+	remotes = fu_remote_list_get_all (self->remote_list);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		const gchar *path;
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) components = NULL;
+		g_autoptr(GTimer) timer_remote = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		path = fwupd_remote_get_filename_cache (remote);
+		if (!g_file_test (path, G_FILE_TEST_EXISTS))
+			continue;
+		timer_remote = g_timer_new ();
+		silo = fu_engine_load_metadata_store_remote (self, remote,
+							     compile_flags,
+							     &error_local);
+		if (silo == NULL) {
+			g_warning ("failed to load remote %s: %s",
+				   fwupd_remote_get_id (remote),
+				   error_local->message);
+			continue;
+		}
+
+		/* print what we've got */
+		components = xb_silo_query (silo, "components/component", 0, NULL);
+		if (components != NULL)
+			components_cnt += components->len;
+		g_debug ("loaded %u components from remote %s in %.1fms",
+			 components != NULL ? components->len : 0,
+			 fwupd_remote_get_id (remote),
+			 g_timer_elapsed (timer_remote, NULL) * 1000.f);
+		g_ptr_array_add (self->silos, g_steal_pointer (&silo));
+	}
+	g_debug ("%u components now in %u silos, loaded in %.1fms",
+		 components_cnt, self->silos->len,
+		 g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* build this now so plugins can use it from other threads */
+	fu_engine_build_silo_guid_index (self);
+
+	/* the compiled metadata of remotes that no longer exist is never used */
+	if ((flags & FU_ENGINE_LOAD_FLAG_READONLY_FS) == 0)
+		fu_engine_load_metadata_store_cleanup (self);
 
 	/* success */
 	return TRUE;
@@ -3483,113 +4155,93 @@ fu_engine_validate_result_timestamp (JcatResult *jcat_result,
 	return TRUE;
 }
 
-/**
- * fu_engine_update_metadata_bytes:
- * @self: A #FuEngine
- * @remote_id: A remote ID, e.g. `lvfs`
- * @bytes_raw: Blob of metadata
- * @bytes_sig: Blob of metadata signature, typically Jcat binary format
- * @error: A #GError, or %NULL
- *
- * Updates the metadata for a specific remote.
- *
- * Returns: %TRUE for success
- **/
-gboolean
-fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
-			        GBytes *bytes_raw, GBytes *bytes_sig, GError **error)
+static FwupdRemote *
+fu_engine_get_remote_for_update (FuEngine *self, const gchar *remote_id, GError **error)
 {
-	FwupdKeyringKind keyring_kind;
-	FwupdRemote *remote;
-
-	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
-	g_return_val_if_fail (remote_id != NULL, FALSE);
-	g_return_val_if_fail (bytes_raw != NULL, FALSE);
-	g_return_val_if_fail (bytes_sig != NULL, FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	/* check remote is valid */
-	remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
+	FwupdRemote *remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
 	if (remote == NULL) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_FOUND,
 			     "remote %s not found", remote_id);
-		return FALSE;
+		return NULL;
 	}
 	if (!fwupd_remote_get_enabled (remote)) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
 			     "remote %s not enabled", remote_id);
-		return FALSE;
+		return NULL;
 	}
+	return remote;
+}
 
-	/* verify file */
-	keyring_kind = fwupd_remote_get_keyring_kind (remote);
-	if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GInputStream) istream = NULL;
-		g_autoptr(GPtrArray) results = NULL;
-		g_autoptr(JcatFile) jcat_file = jcat_file_new ();
-		g_autoptr(JcatItem) jcat_item = NULL;
-		g_autoptr(JcatResult) jcat_result = NULL;
-		g_autoptr(JcatResult) jcat_result_old = NULL;
-
-		/* load Jcat file */
-		istream = g_memory_input_stream_new_from_bytes (bytes_sig);
-		if (!jcat_file_import_stream (jcat_file, istream,
-					      JCAT_IMPORT_FLAG_NONE,
-					      NULL, error))
-			return FALSE;
+static gboolean
+fu_engine_update_metadata_verify (FuEngine *self,
+				  FwupdRemote *remote,
+				  GBytes *bytes_raw,
+				  GBytes *bytes_sig,
+				  GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GInputStream) istream = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(JcatFile) jcat_file = jcat_file_new ();
+	g_autoptr(JcatItem) jcat_item = NULL;
+	g_autoptr(JcatResult) jcat_result = NULL;
+	g_autoptr(JcatResult) jcat_result_old = NULL;
 
-		/* this should only be signing one thing */
-		jcat_item = jcat_file_get_item_default (jcat_file, error);
-		if (jcat_item == NULL)
-			return FALSE;
-		results = jcat_context_verify_item (self->jcat_context,
-						    bytes_raw, jcat_item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    error);
-		if (results == NULL)
-			return FALSE;
+	/* nothing to do */
+	if (fwupd_remote_get_keyring_kind (remote) == FWUPD_KEYRING_KIND_NONE)
+		return TRUE;
 
-		/* return the newest signature */
-		jcat_result = fu_engine_get_newest_signature_jcat_result (results, error);
-		if (jcat_result == NULL)
-			return FALSE;
+	/* load Jcat file */
+	istream = g_memory_input_stream_new_from_bytes (bytes_sig);
+	if (!jcat_file_import_stream (jcat_file, istream,
+				      JCAT_IMPORT_FLAG_NONE,
+				      NULL, error))
+		return FALSE;
 
-		/* verify the metadata was signed later than the existing
-		 * metadata for this remote to mitigate a rollback attack */
-		jcat_result_old = fu_engine_get_system_jcat_result (self, remote, &error_local);
-		if (jcat_result_old == NULL) {
-			if (g_error_matches (error_local,
-					     G_FILE_ERROR,
-					     G_FILE_ERROR_NOENT)) {
-				g_debug ("no existing valid keyrings: %s",
-					 error_local->message);
-			} else {
-				g_warning ("could not get existing keyring result: %s",
-					   error_local->message);
-			}
+	/* this should only be signing one thing */
+	jcat_item = jcat_file_get_item_default (jcat_file, error);
+	if (jcat_item == NULL)
+		return FALSE;
+	results = jcat_context_verify_item (self->jcat_context,
+					    bytes_raw, jcat_item,
+					    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+					    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+					    error);
+	if (results == NULL)
+		return FALSE;
+
+	/* return the newest signature */
+	jcat_result = fu_engine_get_newest_signature_jcat_result (results, error);
+	if (jcat_result == NULL)
+		return FALSE;
+
+	/* verify the metadata was signed later than the existing
+	 * metadata for this remote to mitigate a rollback attack */
+	jcat_result_old = fu_engine_get_system_jcat_result (self, remote, &error_local);
+	if (jcat_result_old == NULL) {
+		if (g_error_matches (error_local,
+				     G_FILE_ERROR,
+				     G_FILE_ERROR_NOENT)) {
+			g_debug ("no existing valid keyrings: %s",
+				 error_local->message);
 		} else {
-			if (!fu_engine_validate_result_timestamp (jcat_result,
-								  jcat_result_old,
-								  error))
-				return FALSE;
+			g_warning ("could not get existing keyring result: %s",
+				   error_local->message);
 		}
+		return TRUE;
 	}
+	return fu_engine_validate_result_timestamp (jcat_result,
+						    jcat_result_old,
+						    error);
+}
 
-	/* save XML and signature to remotes.d */
-	if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache (remote),
-					   bytes_raw, error))
-		return FALSE;
-	if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
-		if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache_sig (remote),
-						   bytes_sig, error))
-			return FALSE;
-	}
+static gboolean
+fu_engine_update_metadata_reload (FuEngine *self, GError **error)
+{
 	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE, error))
 		return FALSE;
 
@@ -3604,17 +4256,202 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	return TRUE;
 }
 
+/* a remote may have switched between gzip and zstd compression */
+static void
+fu_engine_update_metadata_remove_stale (FwupdRemote *remote)
+{
+	const gchar *fn = fwupd_remote_get_filename_cache (remote);
+	const gchar *basenames[] = { "metadata.xml.gz", "metadata.xml.zst", NULL };
+	g_autofree gchar *dirname = g_path_get_dirname (fn);
+
+	for (guint i = 0; basenames[i] != NULL; i++) {
+		g_autofree gchar *fn_old = g_build_filename (dirname, basenames[i], NULL);
+		g_autofree gchar *fn_old_sig = NULL;
+		if (g_strcmp0 (fn_old, fn) == 0)
+			continue;
+		if (!g_file_test (fn_old, G_FILE_TEST_EXISTS))
+			continue;
+		g_debug ("deleting stale %s", fn_old);
+		g_unlink (fn_old);
+		fn_old_sig = g_strdup_printf ("%s.jcat", fn_old);
+		g_unlink (fn_old_sig);
+	}
+}
+
 /**
- * fu_engine_update_metadata:
+ * fu_engine_update_metadata_bytes:
  * @self: A #FuEngine
  * @remote_id: A remote ID, e.g. `lvfs`
- * @fd: file descriptor of the metadata
- * @fd_sig: file descriptor of the metadata signature
+ * @bytes_raw: Blob of metadata
+ * @bytes_sig: Blob of metadata signature, typically Jcat binary format
  * @error: A #GError, or %NULL
  *
  * Updates the metadata for a specific remote.
  *
- * Note: this will close the fds when done
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
+			        GBytes *bytes_raw, GBytes *bytes_sig, GError **error)
+{
+	FwupdRemote *remote;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (remote_id != NULL, FALSE);
+	g_return_val_if_fail (bytes_raw != NULL, FALSE);
+	g_return_val_if_fail (bytes_sig != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* the metadata is not reloaded under a running install */
+	if (!fu_engine_check_install_running (self, error))
+		return FALSE;
+
+	/* check remote is valid */
+	remote = fu_engine_get_remote_for_update (self, remote_id, error);
+	if (remote == NULL)
+		return FALSE;
+
+	/* verify file */
+	if (!fu_engine_update_metadata_verify (self, remote, bytes_raw, bytes_sig, error))
+		return FALSE;
+
+	/* save XML and signature to remotes.d */
+	if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache (remote),
+					   bytes_raw, error))
+		return FALSE;
+	if (fwupd_remote_get_keyring_kind (remote) != FWUPD_KEYRING_KIND_NONE) {
+		if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache_sig (remote),
+						   bytes_sig, error))
+			return FALSE;
+	}
+	fu_engine_update_metadata_remove_stale (remote);
+	return fu_engine_update_metadata_reload (self, error);
+}
+
+#ifdef HAVE_GIO_UNIX
+/* copies the stream to a file in chunks so that the size can be limited */
+static gboolean
+fu_engine_update_metadata_stream_to_file (GInputStream *stream,
+					  GFile *file,
+					  gsize size_max,
+					  GError **error)
+{
+	gsize total = 0;
+	g_autoptr(GFileOutputStream) ostream = NULL;
+
+	ostream = g_file_replace (file, NULL, FALSE,
+				  G_FILE_CREATE_REPLACE_DESTINATION,
+				  NULL, error);
+	if (ostream == NULL)
+		return FALSE;
+	while (TRUE) {
+		g_autoptr(GBytes) chunk = NULL;
+		chunk = g_input_stream_read_bytes (stream, 0x8000, NULL, error);
+		if (chunk == NULL)
+			return FALSE;
+		if (g_bytes_get_size (chunk) == 0)
+			break;
+		total += g_bytes_get_size (chunk);
+		if (total > size_max) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "metadata larger than maximum size of 0x%x bytes",
+				     (guint) size_max);
+			return FALSE;
+		}
+		if (!g_output_stream_write_all (G_OUTPUT_STREAM (ostream),
+						g_bytes_get_data (chunk, NULL),
+						g_bytes_get_size (chunk),
+						NULL, NULL, error))
+			return FALSE;
+	}
+	return g_output_stream_close (G_OUTPUT_STREAM (ostream), NULL, error);
+}
+
+/* the compressed metadata is copied straight to disk and then mapped for
+ * verification, so it never has to be held in the heap; the files are only
+ * renamed into place if the signature is valid */
+static gboolean
+fu_engine_update_metadata_stream (FuEngine *self,
+				  FwupdRemote *remote,
+				  GInputStream *stream_raw,
+				  GBytes *bytes_sig,
+				  GError **error)
+{
+	const gchar *fn = fwupd_remote_get_filename_cache (remote);
+	g_autofree gchar *fn_tmp = g_strdup_printf ("%s.tmp", fn);
+	g_autofree gchar *fn_sig_tmp = NULL;
+	g_autoptr(GBytes) bytes_raw = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (fn);
+	g_autoptr(GFile) file_tmp = g_file_new_for_path (fn_tmp);
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	if (!fu_common_mkdir_parent (fn, error))
+		return FALSE;
+	if (!fu_engine_update_metadata_stream_to_file (stream_raw, file_tmp,
+						       FU_ENGINE_METADATA_SIZE_MAX,
+						       error)) {
+		g_file_delete (file_tmp, NULL, NULL);
+		return FALSE;
+	}
+	mapped_file = g_mapped_file_new (fn_tmp, FALSE, error);
+	if (mapped_file == NULL) {
+		g_file_delete (file_tmp, NULL, NULL);
+		return FALSE;
+	}
+	bytes_raw = g_mapped_file_get_bytes (mapped_file);
+	if (!fu_engine_update_metadata_verify (self, remote, bytes_raw, bytes_sig, error)) {
+		g_file_delete (file_tmp, NULL, NULL);
+		return FALSE;
+	}
+
+	/* both files are written to a temporary file first so that neither is
+	 * ever partially written; the signature is renamed last as its
+	 * checksum is what clients use to decide if the metadata is current,
+	 * and so if that fails the old signature makes them try again and the
+	 * mismatched pair fails verification rather than being used */
+	if (fwupd_remote_get_keyring_kind (remote) != FWUPD_KEYRING_KIND_NONE) {
+		fn_sig_tmp = g_strdup_printf ("%s.tmp", fwupd_remote_get_filename_cache_sig (remote));
+		if (!fu_common_set_contents_bytes (fn_sig_tmp, bytes_sig, error)) {
+			g_file_delete (file_tmp, NULL, NULL);
+			return FALSE;
+		}
+	}
+	if (!g_file_move (file_tmp, file, G_FILE_COPY_OVERWRITE,
+			  NULL, NULL, NULL, error)) {
+		g_file_delete (file_tmp, NULL, NULL);
+		if (fn_sig_tmp != NULL)
+			g_unlink (fn_sig_tmp);
+		return FALSE;
+	}
+	if (fn_sig_tmp != NULL &&
+	    g_rename (fn_sig_tmp, fwupd_remote_get_filename_cache_sig (remote)) != 0) {
+		gint errsv = errno;
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errsv),
+			     "failed to rename %s: %s",
+			     fn_sig_tmp, g_strerror (errsv));
+		g_unlink (fn_sig_tmp);
+		return FALSE;
+	}
+	fu_engine_update_metadata_remove_stale (remote);
+	return TRUE;
+}
+#endif
+
+/**
+ * fu_engine_update_metadata:
+ * @self: A #FuEngine
+ * @remote_id: A remote ID, e.g. `lvfs`
+ * @fd: file descriptor of the metadata
+ * @fd_sig: file descriptor of the metadata signature
+ * @error: A #GError, or %NULL
+ *
+ * Updates the metadata for a specific remote.
+ *
+ * Note: this will close the fds when done
  *
  * Returns: %TRUE for success
  **/
@@ -3623,7 +4460,7 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 			   gint fd, gint fd_sig, GError **error)
 {
 #ifdef HAVE_GIO_UNIX
-	g_autoptr(GBytes) bytes_raw = NULL;
+	FwupdRemote *remote;
 	g_autoptr(GBytes) bytes_sig = NULL;
 	g_autoptr(GInputStream) stream_fd = NULL;
 	g_autoptr(GInputStream) stream_sig = NULL;
@@ -3638,9 +4475,13 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 	stream_fd = g_unix_input_stream_new (fd, TRUE);
 	stream_sig = g_unix_input_stream_new (fd_sig, TRUE);
 
-	/* read the entire file into memory */
-	bytes_raw = g_input_stream_read_bytes (stream_fd, 0x100000, NULL, error);
-	if (bytes_raw == NULL)
+	/* the metadata is not reloaded under a running install */
+	if (!fu_engine_check_install_running (self, error))
+		return FALSE;
+
+	/* check remote is valid */
+	remote = fu_engine_get_remote_for_update (self, remote_id, error);
+	if (remote == NULL)
 		return FALSE;
 
 	/* read signature */
@@ -3648,10 +4489,10 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 	if (bytes_sig == NULL)
 		return FALSE;
 
-	/* update with blobs */
-	return fu_engine_update_metadata_bytes (self, remote_id,
-						bytes_raw, bytes_sig,
-						error);
+	/* save signature and then XML if valid */
+	if (!fu_engine_update_metadata_stream (self, remote, stream_fd, bytes_sig, error))
+		return FALSE;
+	return fu_engine_update_metadata_reload (self, error);
 #else
 	g_set_error (error,
 		     FWUPD_ERROR,
@@ -3732,6 +4573,8 @@ fu_engine_get_result_from_component (FuEngine *self,
 		if (guid == NULL)
 			continue;
 		device = fu_device_list_get_by_guid (self->device_list, guid, NULL);
+		if (device != NULL && !fu_engine_ensure_device_ready (self, device, NULL))
+			g_clear_object (&device);
 		if (device != NULL) {
 			fu_device_set_name (dev, fu_device_get_name (device));
 			fu_device_set_flags (dev, fu_device_get_flags (device));
@@ -4376,10 +5219,8 @@ fu_engine_get_releases_for_device (FuEngine *self,
 	GPtrArray *releases;
 	const gchar *version;
 	g_autoptr(GError) error_all = NULL;
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) branches = NULL;
 	g_autoptr(GPtrArray) components = NULL;
-	g_autoptr(GString) xpath = g_string_new (NULL);
 
 	/* get device version */
 	version = fu_device_get_version (device);
@@ -4402,24 +5243,12 @@ fu_engine_get_releases_for_device (FuEngine *self,
 
 	/* get all the components that provide any of these GUIDs */
 	device_guids = fu_device_get_guids (device);
-	for (guint i = 0; i < device_guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (device_guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type=$'flashed'][text()=$'%s']/"
-					"../..", guid);
-	}
-	components = xb_silo_query (self->silo, xpath->str, 0, &error_local);
-	if (components == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-		    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOTHING_TO_DO,
-					     "No releases found");
-			return NULL;
-		}
-		g_propagate_error (error, g_steal_pointer (&error_local));
+	components = fu_engine_get_components_by_guids (self, device_guids);
+	if (components->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No releases found");
 		return NULL;
 	}
 
@@ -4947,11 +5776,309 @@ fu_engine_plugins_setup (FuEngine *self)
 	}
 }
 
+typedef enum {
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_ADD_FIRMWARE_GTYPE,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_RECOLDPLUG,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED,
+	FU_ENGINE_COLDPLUG_EVENT_KIND_DONE,
+} FuEngineColdplugEventKind;
+
+typedef struct {
+	FuPlugin		*plugin;
+	gboolean		 is_recoldplug;
+	GError			*error;
+	gdouble			 elapsed;	/* ms */
+} FuEngineColdplugHelper;
+
+/* owned by the worker thread waiting for the result */
+typedef struct {
+	GMutex			 mutex;
+	GCond			 cond;
+	gboolean		 done;
+	gboolean		 result;
+} FuEngineColdplugReply;
+
+typedef struct {
+	FuEngineColdplugEventKind kind;
+	FuPlugin		*plugin;
+	FuDevice		*device;	/* nullable */
+	FuEngineColdplugHelper	*helper;	/* nullable */
+	gchar			*id;		/* nullable */
+	GType			 gtype;
+	guint			 duration;
+	FuEngineColdplugReply	*reply;		/* nullable */
+} FuEngineColdplugEvent;
+
+static void
+fu_engine_coldplug_helper_free (FuEngineColdplugHelper *helper)
+{
+	g_object_unref (helper->plugin);
+	if (helper->error != NULL)
+		g_error_free (helper->error);
+	g_free (helper);
+}
+
+static void
+fu_engine_coldplug_event_free (FuEngineColdplugEvent *event)
+{
+	if (event->plugin != NULL)
+		g_object_unref (event->plugin);
+	if (event->device != NULL)
+		g_object_unref (event->device);
+	g_free (event->id);
+	g_free (event);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuEngineColdplugEvent, fu_engine_coldplug_event_free)
+
+/* plugins coldplugged from a worker thread must not touch the engine, the
+ * device list or the other plugins, so queue the request for the thread that
+ * started the coldplug rather than running it now */
+static FuEngineColdplugEvent *
+fu_engine_coldplug_event_new (FuEngine *self,
+			      FuEngineColdplugEventKind kind,
+			      FuPlugin *plugin,
+			      FuDevice *device)
+{
+	FuEngineColdplugEvent *event;
+
+	if (self->coldplug_events == NULL)
+		return NULL;
+	if (g_thread_self () == self->coldplug_thread)
+		return NULL;
+	event = g_new0 (FuEngineColdplugEvent, 1);
+	event->kind = kind;
+	event->plugin = g_object_ref (plugin);
+	if (device != NULL)
+		event->device = g_object_ref (device);
+	return event;
+}
+
+static gboolean
+fu_engine_coldplug_event_defer (FuEngine *self,
+				FuEngineColdplugEventKind kind,
+				FuPlugin *plugin,
+				FuDevice *device)
+{
+	FuEngineColdplugEvent *event;
+
+	event = fu_engine_coldplug_event_new (self, kind, plugin, device);
+	if (event == NULL)
+		return FALSE;
+	g_async_queue_push (self->coldplug_events, event);
+	return TRUE;
+}
+
+static void
+fu_engine_coldplug_event_dispatch (FuEngine *self, FuEngineColdplugEvent *event)
+{
+	switch (event->kind) {
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED:
+		fu_engine_plugin_device_added_cb (event->plugin, event->device, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED:
+		fu_engine_plugin_device_removed_cb (event->plugin, event->device, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER:
+		fu_engine_plugin_device_register (self, event->device);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED:
+		fu_engine_plugin_rules_changed_cb (event->plugin, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED:
+		fu_engine_plugin_security_changed_cb (event->plugin, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_ADD_FIRMWARE_GTYPE:
+		fu_engine_add_firmware_gtype (self, event->id, event->gtype);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY:
+		fu_engine_plugin_set_coldplug_delay_cb (event->plugin, event->duration, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_RECOLDPLUG:
+		fu_engine_plugin_recoldplug_cb (event->plugin, self);
+		break;
+	case FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED:
+		g_mutex_lock (&event->reply->mutex);
+		event->reply->result = fu_engine_plugin_check_supported_cb (event->plugin,
+									    event->id,
+									    self);
+		event->reply->done = TRUE;
+		g_cond_signal (&event->reply->cond);
+		g_mutex_unlock (&event->reply->mutex);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+fu_engine_plugins_coldplug_plugin (FuEngineColdplugHelper *helper)
+{
+	g_autoptr(GTimer) timer = g_timer_new ();
+	if (helper->is_recoldplug)
+		fu_plugin_runner_recoldplug (helper->plugin, &helper->error);
+	else
+		fu_plugin_runner_coldplug (helper->plugin, &helper->error);
+	helper->elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+}
+
+static void
+fu_engine_plugins_coldplug_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineColdplugHelper *helper = (FuEngineColdplugHelper *) data;
+	FuEngine *self = FU_ENGINE (user_data);
+	FuEngineColdplugEvent *event = g_new0 (FuEngineColdplugEvent, 1);
+
+	fu_engine_plugins_coldplug_plugin (helper);
+
+	/* the helper is still owned by the caller */
+	event->kind = FU_ENGINE_COLDPLUG_EVENT_KIND_DONE;
+	event->helper = helper;
+	g_async_queue_push (self->coldplug_events, event);
+}
+
+static void
+fu_engine_plugins_coldplug_finish (FuEngineColdplugHelper *helper)
+{
+	if (helper->error == NULL)
+		return;
+	if (helper->is_recoldplug) {
+		g_message ("failed recoldplug: %s", helper->error->message);
+		return;
+	}
+	fu_plugin_add_flag (helper->plugin, FWUPD_PLUGIN_FLAG_DISABLED);
+	g_message ("disabling plugin because: %s", helper->error->message);
+}
+
+/* all the plugins in @helpers have the same order, and so the ones that opted
+ * in with %FU_PLUGIN_THREAD_FLAG_COLDPLUG can run at the same time; returns
+ * the duration of the critical path in ms */
+static gdouble
+fu_engine_plugins_coldplug_group (FuEngine *self,
+				  GPtrArray *helpers,
+				  GThreadPool *pool,
+				  guint *threads_used)
+{
+	gdouble elapsed_serial = 0.f;
+	gdouble elapsed_max = 0.f;
+	guint done = 0;
+	g_autoptr(GPtrArray) events = NULL;
+	g_autoptr(GPtrArray) helpers_pool = g_ptr_array_new ();
+	g_autoptr(GPtrArray) helpers_serial = g_ptr_array_new ();
+
+	/* everything else shares state with the engine or the other plugins */
+	for (guint i = 0; i < helpers->len; i++) {
+		FuEngineColdplugHelper *helper = g_ptr_array_index (helpers, i);
+		if (pool != NULL &&
+		    fu_plugin_has_thread_flag (helper->plugin, FU_PLUGIN_THREAD_FLAG_COLDPLUG)) {
+			g_ptr_array_add (helpers_pool, helper);
+		} else {
+			g_ptr_array_add (helpers_serial, helper);
+		}
+	}
+
+	/* nothing to gain from using threads */
+	if (helpers_pool->len == 1) {
+		g_ptr_array_add (helpers_serial, g_ptr_array_index (helpers_pool, 0));
+		g_ptr_array_set_size (helpers_pool, 0);
+	}
+
+	/* run these first, while no other plugin is coldplugging */
+	for (guint i = 0; i < helpers_serial->len; i++) {
+		FuEngineColdplugHelper *helper = g_ptr_array_index (helpers_serial, i);
+		fu_engine_plugins_coldplug_plugin (helper);
+		fu_engine_plugins_coldplug_finish (helper);
+		elapsed_serial += helper->elapsed;
+	}
+	if (helpers_pool->len == 0)
+		return elapsed_serial;
+
+	/* run the rest of this group on the pool */
+	*threads_used = MAX (*threads_used,
+			     MIN (helpers_pool->len,
+				  (guint) g_thread_pool_get_max_threads (pool)));
+	for (guint i = 0; i < helpers_pool->len; i++) {
+		FuEngineColdplugHelper *helper = g_ptr_array_index (helpers_pool, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!g_thread_pool_push (pool, helper, &error_local)) {
+			g_warning ("failed to schedule %s, running now: %s",
+				   fu_plugin_get_name (helper->plugin),
+				   error_local->message);
+			fu_engine_plugins_coldplug_plugin (helper);
+			fu_engine_plugins_coldplug_finish (helper);
+			elapsed_max = MAX (elapsed_max, helper->elapsed);
+			done++;
+		}
+	}
+
+	/* only answer queries until all the plugins in the group finish, as
+	 * the device-registered vfuncs of the other plugins must not run while
+	 * those plugins are still coldplugging */
+	events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_coldplug_event_free);
+	while (done < helpers_pool->len) {
+		FuEngineColdplugEvent *event = g_async_queue_pop (self->coldplug_events);
+		if (event->kind == FU_ENGINE_COLDPLUG_EVENT_KIND_DONE) {
+			fu_engine_plugins_coldplug_finish (event->helper);
+			elapsed_max = MAX (elapsed_max, event->helper->elapsed);
+			fu_engine_coldplug_event_free (event);
+			done++;
+			continue;
+		}
+		if (event->kind == FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED) {
+			fu_engine_coldplug_event_dispatch (self, event);
+			fu_engine_coldplug_event_free (event);
+			continue;
+		}
+		g_ptr_array_add (events, event);
+	}
+
+	/* process everything else in the order the plugins sent it */
+	for (guint i = 0; i < events->len; i++) {
+		FuEngineColdplugEvent *event = g_ptr_array_index (events, i);
+		fu_engine_coldplug_event_dispatch (self, event);
+	}
+	return elapsed_serial + elapsed_max;
+}
+
+static gint
+fu_engine_plugins_coldplug_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuEngineColdplugHelper *helper1 = *((FuEngineColdplugHelper **) a);
+	FuEngineColdplugHelper *helper2 = *((FuEngineColdplugHelper **) b);
+	if (helper1->elapsed < helper2->elapsed)
+		return 1;
+	if (helper1->elapsed > helper2->elapsed)
+		return -1;
+	return 0;
+}
+
+static guint
+fu_engine_plugins_coldplug_get_threads_max (FuEngine *self)
+{
+	guint threads_max = fu_config_get_coldplug_threads_max (self->config);
+	if (threads_max == 0)
+		threads_max = g_get_num_processors ();
+	return threads_max;
+}
+
 static void
 fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 {
 	GPtrArray *plugins;
+	GThreadPool *pool = NULL;
+	gdouble elapsed_critical = 0.f;
+	guint threads_max = fu_engine_plugins_coldplug_get_threads_max (self);
+	guint threads_used = 1;
 	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GPtrArray) helpers_all = NULL;
+	g_autoptr(GPtrArray) helpers = g_ptr_array_new ();
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* don't allow coldplug to be scheduled when in coldplug */
 	self->coldplug_running = TRUE;
@@ -4971,20 +6098,50 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 		g_usleep (self->coldplug_delay * 1000);
 	}
 
+	/* plugins with run-after or run-before rules have been given a
+	 * different order by the depsolver, so only ever run plugins of the
+	 * same order in parallel */
+	if (threads_max > 1) {
+		g_autoptr(GError) error_pool = NULL;
+		pool = g_thread_pool_new (fu_engine_plugins_coldplug_thread_cb,
+					  self, threads_max, FALSE, &error_pool);
+		if (pool == NULL) {
+			g_warning ("failed to create coldplug pool: %s",
+				   error_pool->message);
+		} else {
+			self->coldplug_thread = g_thread_self ();
+			self->coldplug_events = g_async_queue_new_full ((GDestroyNotify) fu_engine_coldplug_event_free);
+		}
+	}
+
 	/* exec */
+	helpers_all = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_coldplug_helper_free);
 	for (guint i = 0; i < plugins->len; i++) {
-		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
-		if (is_recoldplug) {
-			if (!fu_plugin_runner_recoldplug (plugin, &error))
-				g_message ("failed recoldplug: %s", error->message);
-		} else {
-			if (!fu_plugin_runner_coldplug (plugin, &error)) {
-				fu_plugin_add_flag (plugin, FWUPD_PLUGIN_FLAG_DISABLED);
-				g_message ("disabling plugin because: %s",
-					   error->message);
-			}
+		if (!fu_plugin_has_flag (plugin, FWUPD_PLUGIN_FLAG_DISABLED)) {
+			FuEngineColdplugHelper *helper = g_new0 (FuEngineColdplugHelper, 1);
+			helper->plugin = g_object_ref (plugin);
+			helper->is_recoldplug = is_recoldplug;
+			g_ptr_array_add (helpers_all, helper);
+			g_ptr_array_add (helpers, helper);
+		}
+
+		/* run this group when the next plugin has a different order */
+		if (i + 1 < plugins->len) {
+			FuPlugin *plugin_next = g_ptr_array_index (plugins, i + 1);
+			if (fu_plugin_get_order (plugin_next) == fu_plugin_get_order (plugin))
+				continue;
 		}
+		if (helpers->len == 0)
+			continue;
+		elapsed_critical += fu_engine_plugins_coldplug_group (self, helpers, pool,
+								      &threads_used);
+		g_ptr_array_set_size (helpers, 0);
+	}
+	if (pool != NULL) {
+		g_thread_pool_free (pool, FALSE, TRUE);
+		g_clear_pointer (&self->coldplug_events, g_async_queue_unref);
+		self->coldplug_thread = NULL;
 	}
 
 	/* cleanup */
@@ -4995,6 +6152,20 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 			g_warning ("failed to cleanup coldplug: %s", error->message);
 	}
 
+	/* show what took the time */
+	g_ptr_array_sort (helpers_all, fu_engine_plugins_coldplug_sort_cb);
+	g_debug ("coldplug took %.1fms using %u threads, critical path %.1fms",
+		 g_timer_elapsed (timer, NULL) * 1000.f,
+		 threads_used,
+		 elapsed_critical);
+	for (guint i = 0; i < helpers_all->len; i++) {
+		FuEngineColdplugHelper *helper = g_ptr_array_index (helpers_all, i);
+		g_debug ("%-24s order:%-4u %.1fms",
+			 fu_plugin_get_name (helper->plugin),
+			 fu_plugin_get_order (helper->plugin),
+			 helper->elapsed);
+	}
+
 	/* print what we do have */
 	for (guint i = 0; i < plugins->len; i++) {
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -5020,6 +6191,13 @@ fu_engine_plugin_device_register (FuEngine *self, FuDevice *device)
 			   fu_device_get_id (device));
 		return;
 	}
+
+	/* registered by fu_engine_ensure_device_ready() instead */
+	if (fu_device_get_setup_cached (device)) {
+		g_debug ("not registering %s until revalidated",
+			 fu_device_get_id (device));
+		return;
+	}
 	plugins = fu_plugin_list_get_all (self->plugin_list);
 	for (guint i = 0; i < plugins->len; i++) {
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -5034,6 +6212,10 @@ fu_engine_plugin_device_register_cb (FuPlugin *plugin,
 				    gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REGISTER,
+					    plugin, device))
+		return;
 	fu_engine_plugin_device_register (self, device);
 }
 
@@ -5044,6 +6226,12 @@ fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
+	/* coldplugging in a worker thread */
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_ADDED,
+					    plugin, device))
+		return;
+
 	/* plugin has prio and device not already set from quirk */
 	if (fu_plugin_get_priority (plugin) > 0 &&
 	    fu_device_get_priority (device) == 0) {
@@ -5313,6 +6501,18 @@ fu_engine_plugin_add_firmware_gtype_cb (FuPlugin *plugin,
 					gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
+	FuEngineColdplugEvent *event;
+
+	/* coldplugging in a worker thread */
+	event = fu_engine_coldplug_event_new (self,
+					      FU_ENGINE_COLDPLUG_EVENT_KIND_ADD_FIRMWARE_GTYPE,
+					      plugin, NULL);
+	if (event != NULL) {
+		event->id = g_strdup (id);
+		event->gtype = gtype;
+		g_async_queue_push (self->coldplug_events, event);
+		return;
+	}
 	fu_engine_add_firmware_gtype (self, id, gtype);
 }
 
@@ -5320,7 +6520,12 @@ static void
 fu_engine_plugin_rules_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
-	GPtrArray *rules = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_INHIBITS_IDLE);
+	GPtrArray *rules;
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_RULES_CHANGED,
+					    plugin, NULL))
+		return;
+	rules = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_INHIBITS_IDLE);
 	if (rules == NULL)
 		return;
 	for (guint j = 0; j < rules->len; j++) {
@@ -5334,6 +6539,12 @@ fu_engine_plugin_security_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
+	/* coldplugging in a worker thread */
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_SECURITY_CHANGED,
+					    plugin, NULL))
+		return;
+
 	/* invalidate host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 
@@ -5351,6 +6562,12 @@ fu_engine_plugin_device_removed_cb (FuPlugin *plugin,
 	g_autoptr(FuDevice) device_tmp = NULL;
 	g_autoptr(GError) error = NULL;
 
+	/* coldplugging in a worker thread */
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_DEVICE_REMOVED,
+					    plugin, device))
+		return;
+
 	device_tmp = fu_device_list_get_by_id (self->device_list,
 					       fu_device_get_id (device),
 					       &error);
@@ -5445,6 +6662,42 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 	}
 }
 
+/* returns a new reference so the caller can modify the device list */
+static GPtrArray *
+fu_engine_udev_devices_for_sysfs_path (FuEngine *self, const gchar *sysfs_path)
+{
+	GPtrArray *devices_tmp;
+
+	/* rebuild the index only when the device list has changed; the index
+	 * is only used from the main thread but the device list can be changed
+	 * by the coldplug threads, so clear the flag before reading the list */
+	if (g_atomic_int_compare_and_exchange (&self->udev_devices_dirty, TRUE, FALSE)) {
+		g_autoptr(GPtrArray) devices = fu_device_list_get_all (self->device_list);
+		g_hash_table_remove_all (self->udev_devices);
+		for (guint i = 0; i < devices->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices, i);
+			const gchar *sysfs_path_tmp;
+			if (!FU_IS_UDEV_DEVICE (device))
+				continue;
+			sysfs_path_tmp = fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device));
+			if (sysfs_path_tmp == NULL)
+				continue;
+			devices_tmp = g_hash_table_lookup (self->udev_devices, sysfs_path_tmp);
+			if (devices_tmp == NULL) {
+				devices_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+				g_hash_table_insert (self->udev_devices,
+						     g_strdup (sysfs_path_tmp),
+						     devices_tmp);
+			}
+			g_ptr_array_add (devices_tmp, g_object_ref (device));
+		}
+	}
+	devices_tmp = g_hash_table_lookup (self->udev_devices, sysfs_path);
+	if (devices_tmp == NULL)
+		return NULL;
+	return g_ptr_array_ref (devices_tmp);
+}
+
 static void
 fu_engine_udev_device_remove (FuEngine *self, GUdevDevice *udev_device)
 {
@@ -5457,22 +6710,21 @@ fu_engine_udev_device_remove (FuEngine *self, GUdevDevice *udev_device)
 	}
 
 	/* go through each device and remove any that match */
-	devices = fu_device_list_get_all (self->device_list);
+	devices = fu_engine_udev_devices_for_sysfs_path (self,
+							 g_udev_device_get_sysfs_path (udev_device));
+	if (devices == NULL)
+		return;
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		if (!FU_IS_UDEV_DEVICE (device))
-			continue;
-		if (g_strcmp0 (fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device)),
-			       g_udev_device_get_sysfs_path (udev_device)) == 0) {
-			g_debug ("auto-removing GUdevDevice");
-			fu_device_list_remove (self->device_list, device);
-		}
+		g_debug ("auto-removing GUdevDevice");
+		fu_device_list_remove (self->device_list, device);
 	}
 }
 
 typedef struct {
 	FuEngine	*self;
 	GUdevDevice	*udev_device;
+	GPtrArray	*plugins;	/* of FuPlugin */
 	guint		 idle_id;
 } FuEngineUdevChangedHelper;
 
@@ -5483,15 +6735,19 @@ fu_engine_udev_changed_helper_free (FuEngineUdevChangedHelper *helper)
 		g_source_remove (helper->idle_id);
 	g_object_unref (helper->self);
 	g_object_unref (helper->udev_device);
+	g_ptr_array_unref (helper->plugins);
 	g_free (helper);
 }
 
 static FuEngineUdevChangedHelper *
-fu_engine_udev_changed_helper_new (FuEngine *self, GUdevDevice *udev_device)
+fu_engine_udev_changed_helper_new (FuEngine *self,
+				   GUdevDevice *udev_device,
+				   GPtrArray *plugins)
 {
 	FuEngineUdevChangedHelper *helper = g_new0 (FuEngineUdevChangedHelper, 1);
 	helper->self = g_object_ref (self);
 	helper->udev_device = g_object_ref (udev_device);
+	helper->plugins = g_ptr_array_ref (plugins);
 	return helper;
 }
 
@@ -5499,10 +6755,10 @@ static gboolean
 fu_engine_udev_changed_cb (gpointer user_data)
 {
 	FuEngineUdevChangedHelper *helper = (FuEngineUdevChangedHelper *) user_data;
-	GPtrArray *plugins = fu_plugin_list_get_all (helper->self->plugin_list);
+	GPtrArray *plugins = helper->plugins;
 	g_autoptr(FuUdevDevice) device = fu_udev_device_new (helper->udev_device);
 
-	/* run all plugins */
+	/* run all plugins watching the subsystem */
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
 		g_autoptr(GError) error = NULL;
@@ -5527,32 +6783,80 @@ fu_engine_udev_changed_cb (gpointer user_data)
 	return FALSE;
 }
 
+/* only the plugins that registered a subsystem get its change events */
+static void
+fu_engine_udev_changed_plugins_rebuild (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	g_hash_table_remove_all (self->udev_changed_plugins);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		GPtrArray *subsystems = fu_plugin_get_udev_subsystems (plugin);
+		if (subsystems == NULL)
+			continue;
+		for (guint j = 0; j < subsystems->len; j++) {
+			const gchar *subsystem = g_ptr_array_index (subsystems, j);
+			GPtrArray *plugins_tmp;
+			plugins_tmp = g_hash_table_lookup (self->udev_changed_plugins, subsystem);
+			if (plugins_tmp == NULL) {
+				plugins_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+				g_hash_table_insert (self->udev_changed_plugins,
+						     g_strdup (subsystem),
+						     plugins_tmp);
+			}
+			g_ptr_array_add (plugins_tmp, g_object_ref (plugin));
+		}
+	}
+	self->udev_changed_plugins_dirty = FALSE;
+}
+
+static GPtrArray *
+fu_engine_udev_changed_plugins_lookup (FuEngine *self, const gchar *subsystem)
+{
+	if (self->udev_changed_plugins_dirty)
+		fu_engine_udev_changed_plugins_rebuild (self);
+	if (subsystem == NULL)
+		return NULL;
+	return g_hash_table_lookup (self->udev_changed_plugins, subsystem);
+}
+
 static void
 fu_engine_udev_device_changed (FuEngine *self, GUdevDevice *udev_device)
 {
 	const gchar *sysfs_path = g_udev_device_get_sysfs_path (udev_device);
+	const gchar *subsystem = g_udev_device_get_subsystem (udev_device);
+	GPtrArray *plugins;
 	g_autoptr(GPtrArray) devices = NULL;
 	FuEngineUdevChangedHelper *helper;
 
 	/* emit changed on any that match */
-	devices = fu_device_list_get_all (self->device_list);
-	for (guint i = 0; i < devices->len; i++) {
-		FuDevice *device = g_ptr_array_index (devices, i);
-		if (!FU_IS_UDEV_DEVICE (device))
-			continue;
-		if (g_strcmp0 (fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device)),
-			       sysfs_path) == 0) {
+	devices = fu_engine_udev_devices_for_sysfs_path (self, sysfs_path);
+	if (devices != NULL) {
+		for (guint i = 0; i < devices->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices, i);
 			fu_udev_device_emit_changed (FU_UDEV_DEVICE (device));
 		}
 	}
 
-	/* run all plugins, with per-device rate limiting */
+	/* no plugin is watching this subsystem */
+	plugins = fu_engine_udev_changed_plugins_lookup (self, subsystem);
+	if (plugins == NULL) {
+		self->udev_changed_skipped++;
+		if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
+			g_debug ("no plugins for %s change on %s, skipping",
+				 subsystem, sysfs_path);
+		}
+		return;
+	}
+	self->udev_changed_dispatched++;
+
+	/* run plugins, with per-device rate limiting */
 	if (g_hash_table_remove (self->udev_changed_ids, sysfs_path)) {
 		g_debug ("re-adding rate-limited timeout for %s", sysfs_path);
 	} else {
 		g_debug ("adding rate-limited timeout for %s", sysfs_path);
 	}
-	helper = fu_engine_udev_changed_helper_new (self, udev_device);
+	helper = fu_engine_udev_changed_helper_new (self, udev_device, plugins);
 	helper->idle_id = g_timeout_add (500, fu_engine_udev_changed_cb, helper);
 	g_hash_table_insert (self->udev_changed_ids, g_strdup (sysfs_path), helper);
 }
@@ -5581,6 +6885,11 @@ fu_engine_enumerate_udev (FuEngine *self)
 static void
 fu_engine_plugin_recoldplug_cb (FuPlugin *plugin, FuEngine *self)
 {
+	/* coldplugging in a worker thread */
+	if (fu_engine_coldplug_event_defer (self,
+					    FU_ENGINE_COLDPLUG_EVENT_KIND_RECOLDPLUG,
+					    plugin, NULL))
+		return;
 	if (self->coldplug_running) {
 		g_warning ("coldplug already running, cannot recoldplug");
 		return;
@@ -5602,6 +6911,17 @@ fu_engine_plugin_recoldplug_cb (FuPlugin *plugin, FuEngine *self)
 static void
 fu_engine_plugin_set_coldplug_delay_cb (FuPlugin *plugin, guint duration, FuEngine *self)
 {
+	FuEngineColdplugEvent *event;
+
+	/* coldplugging in a worker thread */
+	event = fu_engine_coldplug_event_new (self,
+					      FU_ENGINE_COLDPLUG_EVENT_KIND_SET_COLDPLUG_DELAY,
+					      plugin, NULL);
+	if (event != NULL) {
+		event->duration = duration;
+		g_async_queue_push (self->coldplug_events, event);
+		return;
+	}
 	self->coldplug_delay = MAX (self->coldplug_delay, duration);
 	g_debug ("got coldplug delay of %ums, global maximum is now %ums",
 		 duration, self->coldplug_delay);
@@ -5628,6 +6948,9 @@ fu_engine_add_plugin (FuEngine *self, FuPlugin *plugin)
 	}
 
 	fu_plugin_list_add (self->plugin_list, plugin);
+#ifdef HAVE_GUDEV
+	self->udev_changed_plugins_dirty = TRUE;
+#endif
 }
 
 static gboolean
@@ -5669,17 +6992,62 @@ fu_engine_add_plugin_filter (FuEngine *self, const gchar *plugin_glob)
 static gboolean
 fu_engine_plugin_check_supported_cb (FuPlugin *plugin, const gchar *guid, FuEngine *self)
 {
-	g_autoptr(XbNode) n = NULL;
-	g_autofree gchar *xpath = NULL;
-
+	FuEngineColdplugEvent *event;
+
+	/* coldplugging in a worker thread, so wait for the answer */
+	event = fu_engine_coldplug_event_new (self,
+					      FU_ENGINE_COLDPLUG_EVENT_KIND_CHECK_SUPPORTED,
+					      plugin, NULL);
+	if (event != NULL) {
+		FuEngineColdplugReply reply = { 0 };
+		g_mutex_init (&reply.mutex);
+		g_cond_init (&reply.cond);
+		event->id = g_strdup (guid);
+		event->reply = &reply;
+		g_mutex_lock (&reply.mutex);
+		g_async_queue_push (self->coldplug_events, event);
+		while (!reply.done)
+			g_cond_wait (&reply.cond, &reply.mutex);
+		g_mutex_unlock (&reply.mutex);
+		g_mutex_clear (&reply.mutex);
+		g_cond_clear (&reply.cond);
+		return reply.result;
+	}
 	if (fu_config_get_enumerate_all_devices (self->config))
 		return TRUE;
+	if (self->silo_guid_index == NULL)
+		return FALSE;
+	return g_hash_table_contains (self->silo_guid_index, guid);
+}
 
-	xpath = g_strdup_printf ("components/component/"
-				 "provides/firmware[@type='flashed'][text()='%s']",
-				 guid);
-	n = xb_silo_query_first (self->silo, xpath, NULL);
-	return n != NULL;
+/* number of udev change events sent to plugins, and ignored as unwatched */
+void
+fu_engine_get_udev_changed_stats (FuEngine *self, guint *dispatched, guint *skipped)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+#ifdef HAVE_GUDEV
+	if (dispatched != NULL)
+		*dispatched = self->udev_changed_dispatched;
+	if (skipped != NULL)
+		*skipped = self->udev_changed_skipped;
+#else
+	if (dispatched != NULL)
+		*dispatched = 0;
+	if (skipped != NULL)
+		*skipped = 0;
+#endif
+}
+
+/* the plugins that udev change events for the subsystem are dispatched to */
+GPtrArray *
+fu_engine_get_udev_changed_plugins (FuEngine *self, const gchar *subsystem)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+#ifdef HAVE_GUDEV
+	return fu_engine_udev_changed_plugins_lookup (self, subsystem);
+#else
+	return NULL;
+#endif
 }
 
 gboolean
@@ -6088,8 +7456,14 @@ fu_engine_load_hwids (FuEngine *self)
 		g_warning ("Failed to load HWIDs: %s", error->message);
 }
 
+/* this does not write to the database so that the history is not locked
+ * while the hardware is queried, and @dev_history is added to @devices_save
+ * if it was changed */
 static gboolean
-fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError **error)
+fu_engine_update_history_device (FuEngine *self,
+				 FuDevice *dev_history,
+				 GPtrArray *devices_save,
+				 GError **error)
 {
 	FuPlugin *plugin;
 	FwupdRelease *rel_history;
@@ -6104,6 +7478,10 @@ fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError *
 	if (dev == NULL)
 		return FALSE;
 
+	/* the version and report metadata must come from the hardware */
+	if (!fu_engine_ensure_device_ready (self, dev, error))
+		return FALSE;
+
 	/* does the installed version match what we tried to install
 	 * before fwupd was restarted */
 	rel_history = fu_device_get_release_default (dev_history);
@@ -6126,16 +7504,8 @@ fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError *
 
 	/* save any additional report metadata */
 	metadata_device = fu_device_report_metadata_post (dev);
-	if (metadata_device != NULL && g_hash_table_size (metadata_device) > 0) {
+	if (metadata_device != NULL && g_hash_table_size (metadata_device) > 0)
 		fwupd_release_add_metadata (rel_history, metadata_device);
-		if (!fu_history_set_device_metadata (self->history,
-						     fu_device_get_id (dev_history),
-						     fwupd_release_get_metadata (rel_history),
-						     error)) {
-			g_prefix_error (error, "failed to set metadata: ");
-			return FALSE;
-		}
-	}
 
 	/* the system is running with the new firmware version */
 	if (fu_common_vercmp_full (fu_device_get_version (dev),
@@ -6157,7 +7527,8 @@ fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError *
 		fu_device_remove_flag (dev_history, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION);
 		fu_device_set_update_state (dev_history, FWUPD_UPDATE_STATE_SUCCESS);
 		fu_device_set_update_error (dev_history, NULL);
-		return fu_history_modify_device (self->history, dev_history, error);
+		g_ptr_array_add (devices_save, g_object_ref (dev_history));
+		return TRUE;
 	}
 
 	/* does the plugin know the update failure */
@@ -6180,14 +7551,31 @@ fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError *
 		fu_device_set_update_error (dev_history, fu_device_get_update_error (dev));
 	}
 
-	/* update the state in the database */
+	/* update the state in the database later */
+	g_ptr_array_add (devices_save, g_object_ref (dev_history));
+	return TRUE;
+}
+
+static gboolean
+fu_engine_update_history_device_save (FuEngine *self, FuDevice *dev_history, GError **error)
+{
+	FwupdRelease *rel_history = fu_device_get_release_default (dev_history);
+	if (!fu_history_set_device_metadata (self->history,
+					     fu_device_get_id (dev_history),
+					     fwupd_release_get_metadata (rel_history),
+					     error)) {
+		g_prefix_error (error, "failed to set metadata: ");
+		return FALSE;
+	}
 	return fu_history_modify_device (self->history, dev_history, error);
 }
 
 static gboolean
 fu_engine_update_history_database (FuEngine *self, GError **error)
 {
+	g_autoptr(GError) error_commit = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_save = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
 	/* get any devices */
 	devices = fu_history_get_devices (self->history, error);
@@ -6201,12 +7589,30 @@ fu_engine_update_history_database (FuEngine *self, GError **error)
 		if (fu_device_get_update_state (dev) != FWUPD_UPDATE_STATE_NEEDS_REBOOT)
 			continue;
 
-		/* try to save the new update-state, but ignoring any error */
-		if (!fu_engine_update_history_device (self, dev, &error_local)) {
+		/* try to get the new update-state, but ignoring any error */
+		if (!fu_engine_update_history_device (self, dev, devices_save, &error_local)) {
 			g_warning ("failed to update history database: %s",
 				   error_local->message);
 		}
 	}
+	if (devices_save->len == 0)
+		return TRUE;
+
+	/* only write to disk once, and only lock the history while doing that */
+	if (!fu_history_start_transaction (self->history, error))
+		return FALSE;
+	for (guint i = 0; i < devices_save->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices_save, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_update_history_device_save (self, dev, &error_local)) {
+			g_warning ("failed to update history database: %s",
+				   error_local->message);
+		}
+	}
+	if (!fu_history_commit_transaction (self->history, &error_commit)) {
+		g_warning ("failed to update history database: %s",
+			   error_commit->message);
+	}
 	return TRUE;
 }
 
@@ -6256,6 +7662,126 @@ fu_engine_ensure_client_certificate (FuEngine *self)
 	g_debug ("client certificate exists and working");
 }
 
+static gchar *
+fu_engine_get_probe_cache_filename (void)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	return g_build_filename (cachedir, "probe.cache", NULL);
+}
+
+/* changes whenever a device is updated, even if the daemon is not running */
+static gchar *
+fu_engine_get_probe_cache_state (FuEngine *self)
+{
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	devices = fu_history_get_devices (self->history, &error_local);
+	if (devices == NULL) {
+		g_debug ("failed to get history: %s", error_local->message);
+		return NULL;
+	}
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices, i);
+		g_autofree gchar *tmp = NULL;
+		tmp = g_strdup_printf ("%s:%u:%s:%" G_GUINT64_FORMAT ";",
+				       fu_device_get_id (dev),
+				       (guint) fu_device_get_update_state (dev),
+				       fu_device_get_version (dev),
+				       fu_device_get_modified (dev));
+		g_checksum_update (csum, (const guchar *) tmp, -1);
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static void
+fu_engine_probe_cache_load (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	g_autofree gchar *filename = fu_engine_get_probe_cache_filename ();
+	g_autofree gchar *state = fu_engine_get_probe_cache_state (self);
+	g_autoptr(GError) error_local = NULL;
+
+	/* not safe to use if we cannot tell what was updated */
+	if (state == NULL)
+		return;
+	self->probe_cache = fu_probe_cache_new ();
+	fu_probe_cache_set_state (self->probe_cache, state);
+	if (!fu_probe_cache_load (self->probe_cache, filename, &error_local))
+		g_debug ("ignoring probe cache: %s", error_local->message);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_plugin_set_probe_cache (plugin, self->probe_cache);
+	}
+}
+
+static void
+fu_engine_probe_cache_save (FuEngine *self)
+{
+	g_autofree gchar *filename = fu_engine_get_probe_cache_filename ();
+	g_autofree gchar *state = fu_engine_get_probe_cache_state (self);
+	g_autoptr(GError) error_local = NULL;
+
+	/* the history may have changed since the cache was loaded */
+	if (state == NULL)
+		return;
+	fu_probe_cache_set_state (self->probe_cache, state);
+	if (!fu_probe_cache_save (self->probe_cache, filename, &error_local))
+		g_warning ("failed to save probe cache: %s", error_local->message);
+}
+
+static gboolean
+fu_engine_probe_cache_revalidate_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* all done, so save the new state for next time */
+	if (self->probe_cache_revalidate->len == 0) {
+		fu_engine_probe_cache_save (self);
+		self->probe_cache_revalidate_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	/* one device at a time so that the daemon stays responsive */
+	device = g_object_ref (g_ptr_array_index (self->probe_cache_revalidate, 0));
+	g_ptr_array_remove_index (self->probe_cache_revalidate, 0);
+	if (!fu_engine_ensure_device_ready (self, device, &error_local))
+		g_warning ("%s", error_local->message);
+	return G_SOURCE_CONTINUE;
+}
+
+/* stop using the cache for new devices, and check the ones that did */
+static void
+fu_engine_probe_cache_coldplug_done (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	g_autoptr(GPtrArray) devices = fu_device_list_get_all (self->device_list);
+
+	g_debug ("probe cache: %u hits, %u misses",
+		 fu_probe_cache_get_hits (self->probe_cache),
+		 fu_probe_cache_get_misses (self->probe_cache));
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_plugin_set_probe_cache (plugin, NULL);
+	}
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (fu_device_get_setup_cached (device)) {
+			g_ptr_array_add (self->probe_cache_revalidate, g_object_ref (device));
+			continue;
+		}
+		fu_device_set_probe_cache (device, NULL);
+	}
+	if (self->probe_cache_revalidate->len == 0) {
+		fu_engine_probe_cache_save (self);
+		return;
+	}
+	self->probe_cache_revalidate_id = g_idle_add (fu_engine_probe_cache_revalidate_cb, self);
+}
+
 /**
  * fu_engine_load:
  * @self: A #FuEngine
@@ -6403,10 +7929,15 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		g_signal_connect (self->gudev_client, "uevent",
 				  G_CALLBACK (fu_engine_udev_uevent_cb), self);
 	}
+	fu_engine_udev_changed_plugins_rebuild (self);
 #endif
 
 	fu_engine_set_status (self, FWUPD_STATUS_LOADING);
 
+	/* use the device state from the last run */
+	if (flags & FU_ENGINE_LOAD_FLAG_PROBE_CACHE)
+		fu_engine_probe_cache_load (self);
+
 	/* add devices */
 	fu_engine_plugins_setup (self);
 	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
@@ -6428,6 +7959,10 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		fu_engine_enumerate_udev (self);
 #endif
 
+	/* revalidate devices set up from the probe cache */
+	if (self->probe_cache != NULL)
+		fu_engine_probe_cache_coldplug_done (self);
+
 	/* set device properties from the metadata */
 	fu_engine_md_refresh_devices (self);
 
@@ -6520,8 +8055,11 @@ fu_engine_init (FuEngine *self)
 	g_autofree gchar *sysconfdir = NULL;
 	self->percentage = 0;
 	self->status = FWUPD_STATUS_IDLE;
+	g_mutex_init (&self->install_hooks_mutex);
+	g_mutex_init (&self->install_progress_mutex);
 	self->config = fu_config_new ();
 	self->remote_list = fu_remote_list_new ();
+	self->silos = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->device_list = fu_device_list_new ();
 	self->smbios = fu_smbios_new ();
 	self->hwids = fu_hwids_new ();
@@ -6532,9 +8070,15 @@ fu_engine_init (FuEngine *self)
 	self->plugin_filter = g_ptr_array_new_with_free_func (g_free);
 	self->host_security_attrs = fu_security_attrs_new ();
 	self->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
+	self->probe_cache_revalidate = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 #ifdef HAVE_GUDEV
 	self->udev_changed_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
 							g_free, (GDestroyNotify) fu_engine_udev_changed_helper_free);
+	self->udev_changed_plugins = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->udev_devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->udev_devices_dirty = TRUE;
 #endif
 	self->runtime_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->compile_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
@@ -6597,18 +8141,28 @@ fu_engine_finalize (GObject *obj)
 
 	if (self->usb_ctx != NULL)
 		g_object_unref (self->usb_ctx);
-	if (self->silo != NULL)
-		g_object_unref (self->silo);
+	if (self->silo_guid_index != NULL)
+		g_hash_table_unref (self->silo_guid_index);
+	g_ptr_array_unref (self->silos);
 #ifdef HAVE_GUDEV
 	if (self->gudev_client != NULL)
 		g_object_unref (self->gudev_client);
 #endif
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->probe_cache_revalidate_id != 0)
+		g_source_remove (self->probe_cache_revalidate_id);
+	if (self->probe_cache != NULL)
+		g_object_unref (self->probe_cache);
+	g_ptr_array_unref (self->probe_cache_revalidate);
 	if (self->approved_firmware != NULL)
 		g_hash_table_unref (self->approved_firmware);
 	if (self->blocked_firmware != NULL)
 		g_hash_table_unref (self->blocked_firmware);
+	if (self->install_progress != NULL)
+		g_hash_table_unref (self->install_progress);
+	g_mutex_clear (&self->install_hooks_mutex);
+	g_mutex_clear (&self->install_progress_mutex);
 
 	g_free (self->host_machine_id);
 	g_free (self->host_security_id);
@@ -6626,6 +8180,8 @@ fu_engine_finalize (GObject *obj)
 	g_ptr_array_unref (self->udev_subsystems);
 #ifdef HAVE_GUDEV
 	g_hash_table_unref (self->udev_changed_ids);
+	g_hash_table_unref (self->udev_changed_plugins);
+	g_hash_table_unref (self->udev_devices);
 #endif
 	g_hash_table_unref (self->runtime_versions);
 	g_hash_table_unref (self->compile_versions);
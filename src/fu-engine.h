@@ -26,6 +26,7 @@ G_DECLARE_FINAL_TYPE (FuEngine, fu_engine, FU, ENGINE, GObject)
  * FuEngineLoadFlags:
  * @FU_ENGINE_LOAD_FLAG_NONE:		No flags set
  * @FU_ENGINE_LOAD_FLAG_READONLY_FS:	Ignore readonly filesystem errors
+ * @FU_ENGINE_LOAD_FLAG_PROBE_CACHE:	Set up devices using the state from the last run
  *
  * The flags to use when loading the engine.
  **/
@@ -33,6 +34,7 @@ typedef enum {
 	FU_ENGINE_LOAD_FLAG_NONE		= 0,
 	FU_ENGINE_LOAD_FLAG_READONLY_FS		= 1 << 0,
 	FU_ENGINE_LOAD_FLAG_NO_ENUMERATE	= 1 << 1,
+	FU_ENGINE_LOAD_FLAG_PROBE_CACHE		= 1 << 2,
 	/*< private >*/
 	FU_ENGINE_LOAD_FLAG_LAST
 } FuEngineLoadFlags;
@@ -49,6 +51,13 @@ gboolean	 fu_engine_load				(FuEngine	*self,
 gboolean	 fu_engine_load_plugins			(FuEngine	*self,
 							 GError		**error);
 gboolean	 fu_engine_get_tainted			(FuEngine	*self);
+void		 fu_engine_get_udev_changed_stats	(FuEngine	*self,
+							 guint		*dispatched,
+							 guint		*skipped);
+GPtrArray	*fu_engine_get_udev_changed_plugins	(FuEngine	*self,
+							 const gchar	*subsystem);
+GPtrArray	*fu_engine_get_install_groups		(FuEngine	*self,
+							 GPtrArray	*install_tasks);
 const gchar	*fu_engine_get_host_product		(FuEngine *self);
 const gchar	*fu_engine_get_host_machine_id		(FuEngine *self);
 const gchar	*fu_engine_get_host_security_id		(FuEngine	*self);
@@ -20,7 +20,7 @@
 #include "fu-history.h"
 #include "fu-mutex.h"
 
-#define FU_HISTORY_CURRENT_SCHEMA_VERSION	6
+#define FU_HISTORY_CURRENT_SCHEMA_VERSION	7
 
 static void fu_history_finalize			 (GObject *object);
 
@@ -28,7 +28,8 @@ struct _FuHistory
 {
 	GObject			 parent_instance;
 	sqlite3			*db;
-	GRWLock			 db_mutex;
+	GRecMutex		 db_mutex;	/* held for the whole of a transaction */
+	GHashTable		*stmts;		/* sql:sqlite3_stmt */
 };
 
 G_DEFINE_TYPE (FuHistory, fu_history, G_TYPE_OBJECT)
@@ -130,6 +131,29 @@ fu_history_device_from_stmt (sqlite3_stmt *stmt)
 	return device;
 }
 
+/* the statement is owned by @self and must only be used with the writer
+ * lock held, as it is shared with every other caller using the same SQL */
+static gint
+fu_history_prepare (FuHistory *self, const gchar *sql, sqlite3_stmt **stmt)
+{
+	gint rc;
+	sqlite3_stmt *stmt_tmp = g_hash_table_lookup (self->stmts, sql);
+
+	/* reuse */
+	if (stmt_tmp != NULL) {
+		sqlite3_reset (stmt_tmp);
+		sqlite3_clear_bindings (stmt_tmp);
+		*stmt = stmt_tmp;
+		return SQLITE_OK;
+	}
+	rc = sqlite3_prepare_v2 (self->db, sql, -1, &stmt_tmp, NULL);
+	if (rc != SQLITE_OK)
+		return rc;
+	g_hash_table_insert (self->stmts, (gpointer) sql, stmt_tmp);
+	*stmt = stmt_tmp;
+	return SQLITE_OK;
+}
+
 static gboolean
 fu_history_stmt_exec (FuHistory *self, sqlite3_stmt *stmt,
 		      GPtrArray *array, GError **error)
@@ -147,8 +171,10 @@ fu_history_stmt_exec (FuHistory *self, sqlite3_stmt *stmt,
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
 			     sqlite3_errmsg (self->db));
+		sqlite3_reset (stmt);
 		return FALSE;
 	}
+	sqlite3_reset (stmt);
 	return TRUE;
 }
 
@@ -183,6 +209,8 @@ fu_history_create_database (FuHistory *self, GError **error)
 			 "checksum TEXT);"
 			 "CREATE TABLE IF NOT EXISTS blocked_firmware ("
 			 "checksum TEXT);"
+			 "CREATE INDEX IF NOT EXISTS history_device_id "
+			 "ON history (device_id);"
 			 "COMMIT;", NULL, NULL, NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
@@ -288,6 +316,23 @@ fu_history_migrate_database_v5 (FuHistory *self, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_history_migrate_database_v6 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE INDEX IF NOT EXISTS history_device_id "
+			   "ON history (device_id);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create index: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /* returns 0 if database is not initialized */
 static guint
 fu_history_get_schema_version (FuHistory *self)
@@ -331,6 +376,9 @@ fu_history_create_or_migrate (FuHistory *self, guint schema_ver, GError **error)
 	case 1:
 		if (!fu_history_migrate_database_v1 (self, error))
 			return FALSE;
+		/* the index was dropped with the old table */
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 		break;
 	case 2:
 		if (!fu_history_migrate_database_v2 (self, error))
@@ -347,6 +395,10 @@ fu_history_create_or_migrate (FuHistory *self, guint schema_ver, GError **error)
 	case 5:
 		if (!fu_history_migrate_database_v5 (self, error))
 			return FALSE;
+	/* fall through */
+	case 6:
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 		break;
 	default:
 		/* this is probably okay, but return an error if we ever delete
@@ -386,6 +438,11 @@ fu_history_open (FuHistory *self, const gchar *filename, GError **error)
 
 	/* turn off the lookaside cache */
 	sqlite3_db_config (self->db, SQLITE_DBCONFIG_LOOKASIDE, NULL, 0, 0);
+
+	/* readers do not block the writer, and each commit is one append */
+	rc = sqlite3_exec (self->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		g_debug ("ignoring journal mode error: %s", sqlite3_errmsg (self->db));
 	return TRUE;
 }
 
@@ -397,7 +454,7 @@ fu_history_load (FuHistory *self, GError **error)
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 	g_autoptr(GFile) file = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_autoptr(GRecMutexLocker) locker = g_rec_mutex_locker_new (&self->db_mutex);
 
 	/* already done */
 	if (self->db != NULL)
@@ -438,8 +495,11 @@ fu_history_load (FuHistory *self, GError **error)
 		if (!fu_history_create_or_migrate (self, schema_ver, &error_migrate)) {
 			/* this is fatal to the daemon, so delete the database
 			 * and try again with something empty */
+			g_autofree gchar *filename_wal = g_strdup_printf ("%s-wal", filename);
+			g_autofree gchar *filename_shm = g_strdup_printf ("%s-shm", filename);
 			g_warning ("failed to migrate %s database: %s",
 				   filename, error_migrate->message);
+			g_hash_table_remove_all (self->stmts);
 			sqlite3_close (self->db);
 			if (g_unlink (filename) != 0) {
 				g_set_error (error,
@@ -448,6 +508,8 @@ fu_history_load (FuHistory *self, GError **error)
 					     "Can't delete %s", filename);
 				return FALSE;
 			}
+			g_unlink (filename_wal);
+			g_unlink (filename_shm);
 			if (!fu_history_open (self, filename, error))
 				return FALSE;
 			return fu_history_create_database (self, error);
@@ -483,6 +545,87 @@ fu_history_get_device_flags_filtered (FuDevice *device)
 	return flags;
 }
 
+static gboolean
+fu_history_exec (FuHistory *self, const gchar *sql, GError **error)
+{
+	gint rc;
+	g_autoptr(GRecMutexLocker) locker = NULL;
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	rc = sqlite3_exec (self->db, sql, NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
+			     "Failed to execute %s: %s",
+			     sql, sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_history_start_transaction:
+ * @self: A #FuHistory
+ * @error: A #GError or NULL
+ *
+ * Starts a transaction so that several changes are written to disk at
+ * the same time when fu_history_commit_transaction() is called. Other
+ * threads cannot use the history until the transaction is committed, which
+ * must be done from the same thread.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_history_start_transaction (FuHistory *self, GError **error)
+{
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* other threads must not add statements to this transaction, so the
+	 * lock is only released by fu_history_commit_transaction() */
+	g_rec_mutex_lock (&self->db_mutex);
+	if (!fu_history_exec (self, "BEGIN TRANSACTION;", error)) {
+		g_rec_mutex_unlock (&self->db_mutex);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_history_commit_transaction:
+ * @self: A #FuHistory
+ * @error: A #GError or NULL
+ *
+ * Writes all the changes made since fu_history_start_transaction(), or
+ * discards them if they could not be written.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.3
+ **/
+gboolean
+fu_history_commit_transaction (FuHistory *self, GError **error)
+{
+	gboolean ret;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* do not leave the transaction open if the commit failed */
+	ret = fu_history_exec (self, "COMMIT;", error);
+	if (!ret) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_history_exec (self, "ROLLBACK;", &error_local))
+			g_warning ("failed to roll back: %s", error_local->message);
+	}
+	g_rec_mutex_unlock (&self->db_mutex);
+	return ret;
+}
+
 /**
  * fu_history_modify_device:
  * @self: A #FuHistory
@@ -499,8 +642,8 @@ gboolean
 fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
@@ -510,12 +653,12 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 		return FALSE;
 
 	/* overwrite entry if it exists */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("modifying device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "UPDATE history SET "
 				 "update_state = ?1, "
 				 "update_error = ?2, "
@@ -523,7 +666,7 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 				 "device_modified = ?7, "
 				 "flags = ?3 "
 				 "WHERE device_id = ?4;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to update history: %s",
@@ -564,8 +707,8 @@ fu_history_set_device_metadata (FuHistory *self,
 {
 	gint rc;
 	g_autofree gchar *metadata_str = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -575,14 +718,14 @@ fu_history_set_device_metadata (FuHistory *self,
 		return FALSE;
 
 	/* overwrite entry if it exists */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("modifying %s", device_id);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "UPDATE history SET "
 				 "metadata = ?1 "
 				 "WHERE device_id = ?2;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "failed to prepare SQL to update history: %s",
@@ -619,8 +762,8 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	const gchar *checksum = NULL;
 	gint rc;
 	g_autofree gchar *metadata = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
@@ -647,9 +790,9 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	metadata = _convert_hash_to_string (fwupd_release_get_metadata (release));
 
 	/* add */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "INSERT INTO history (device_id,"
 						      "update_state,"
 						      "update_error,"
@@ -667,7 +810,7 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 						      "checksum_device,"
 						      "protocol) "
 				 "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
-					 "?11,?12,?13,?14,?15,?16)", -1, &stmt, NULL);
+					 "?11,?12,?13,?14,?15,?16)", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to insert history: %s",
@@ -712,8 +855,8 @@ fu_history_remove_all_with_state (FuHistory *self,
 				  GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 
@@ -722,13 +865,13 @@ fu_history_remove_all_with_state (FuHistory *self,
 		return FALSE;
 
 	/* remove entries */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices with update_state %s",
 		 fwupd_update_state_to_string (update_state));
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "DELETE FROM history WHERE update_state = ?1",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -754,8 +897,8 @@ gboolean
 fu_history_remove_all (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 
@@ -764,10 +907,10 @@ fu_history_remove_all (FuHistory *self, GError **error)
 		return FALSE;
 
 	/* remove entries */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices");
-	rc = sqlite3_prepare_v2 (self->db, "DELETE FROM history;", -1, &stmt, NULL);
+	rc = fu_history_prepare (self, "DELETE FROM history;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -793,8 +936,8 @@ gboolean
 fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
@@ -803,14 +946,14 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 	if (!fu_history_load (self, error))
 		return FALSE;
 
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("remove device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "DELETE FROM history WHERE device_id = ?1;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -839,8 +982,8 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 {
 	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 	g_return_val_if_fail (device_id != NULL, NULL);
@@ -850,9 +993,9 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 		return NULL;
 
 	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "SELECT device_id, "
 					"checksum, "
 					"plugin, "
@@ -870,7 +1013,7 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 					"checksum_device, "
 					"protocol FROM history WHERE "
 				 "device_id = ?1 ORDER BY device_created DESC "
-				 "LIMIT 1", -1, &stmt, NULL);
+				 "LIMIT 1", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get history: %s",
@@ -905,10 +1048,10 @@ GPtrArray *
 fu_history_get_devices (FuHistory *self, GError **error)
 {
 	GPtrArray *array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -919,9 +1062,9 @@ fu_history_get_devices (FuHistory *self, GError **error)
 	}
 
 	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "SELECT device_id, "
 					"checksum, "
 					"plugin, "
@@ -939,7 +1082,7 @@ fu_history_get_devices (FuHistory *self, GError **error)
 					"checksum_device, "
 					"protocol FROM history "
 					"ORDER BY device_modified ASC;",
-					-1, &stmt, NULL);
+					&stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get history: %s",
@@ -968,9 +1111,9 @@ GPtrArray *
 fu_history_get_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -981,11 +1124,11 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 	}
 
 	/* get all the approved firmware */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "SELECT checksum FROM approved_firmware;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get checksum: %s",
@@ -1021,8 +1164,8 @@ gboolean
 fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 
@@ -1031,11 +1174,11 @@ fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 		return FALSE;
 
 	/* remove entries */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "DELETE FROM approved_firmware;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete approved firmware: %s",
@@ -1063,8 +1206,8 @@ fu_history_add_approved_firmware (FuHistory *self,
 				  GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (checksum != NULL, FALSE);
@@ -1074,11 +1217,11 @@ fu_history_add_approved_firmware (FuHistory *self,
 		return FALSE;
 
 	/* add */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "INSERT INTO approved_firmware (checksum) "
-				 "VALUES (?1)", -1, &stmt, NULL);
+				 "VALUES (?1)", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to insert checksum: %s",
@@ -1103,9 +1246,9 @@ GPtrArray *
 fu_history_get_blocked_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -1116,11 +1259,11 @@ fu_history_get_blocked_firmware (FuHistory *self, GError **error)
 	}
 
 	/* get all the blocked firmware */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "SELECT checksum FROM blocked_firmware;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get checksum: %s",
@@ -1156,8 +1299,8 @@ gboolean
 fu_history_clear_blocked_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 
@@ -1166,11 +1309,11 @@ fu_history_clear_blocked_firmware (FuHistory *self, GError **error)
 		return FALSE;
 
 	/* remove entries */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "DELETE FROM blocked_firmware;",
-				 -1, &stmt, NULL);
+				 &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete blocked firmware: %s",
@@ -1196,8 +1339,8 @@ gboolean
 fu_history_add_blocked_firmware (FuHistory *self, const gchar *checksum, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRecMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (checksum != NULL, FALSE);
@@ -1207,11 +1350,11 @@ fu_history_add_blocked_firmware (FuHistory *self, const gchar *checksum, GError
 		return FALSE;
 
 	/* add */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	locker = g_rec_mutex_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
+	rc = fu_history_prepare (self,
 				 "INSERT INTO blocked_firmware (checksum) "
-				 "VALUES (?1)", -1, &stmt, NULL);
+				 "VALUES (?1)", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to insert checksum: %s",
@@ -1232,7 +1375,9 @@ fu_history_class_init (FuHistoryClass *klass)
 static void
 fu_history_init (FuHistory *self)
 {
-	g_rw_lock_init (&self->db_mutex);
+	g_rec_mutex_init (&self->db_mutex);
+	self->stmts = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     NULL, (GDestroyNotify) sqlite3_finalize);
 }
 
 static void
@@ -1240,8 +1385,10 @@ fu_history_finalize (GObject *object)
 {
 	FuHistory *self = FU_HISTORY (object);
 
-	g_rw_lock_clear (&self->db_mutex);
+	g_rec_mutex_clear (&self->db_mutex);
 
+	/* all statements have to be finalized before closing */
+	g_hash_table_unref (self->stmts);
 	if (self->db != NULL)
 		sqlite3_close (self->db);
 
@@ -15,6 +15,11 @@ G_DECLARE_FINAL_TYPE (FuHistory, fu_history, FU, HISTORY, GObject)
 
 FuHistory	*fu_history_new				(void);
 
+gboolean	 fu_history_start_transaction		(FuHistory	*self,
+							 GError		**error);
+gboolean	 fu_history_commit_transaction		(FuHistory	*self,
+							 GError		**error);
+
 gboolean	 fu_history_add_device			(FuHistory	*self,
 							 FuDevice	*device,
 							 FwupdRelease	*release,
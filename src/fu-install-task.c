@@ -497,6 +497,57 @@ fu_install_task_compare (FuInstallTask *task1, FuInstallTask *task2)
 	return 0;
 }
 
+/* the root of the device and of any proxy, as updating either may cause the
+ * other to be detached or replugged */
+static void
+fu_install_task_add_roots (FuInstallTask *self, GPtrArray *roots)
+{
+	FuDevice *proxy = fu_device_get_proxy (self->device);
+	g_ptr_array_add (roots, fu_device_get_root (self->device));
+	if (proxy != NULL)
+		g_ptr_array_add (roots, fu_device_get_root (proxy));
+}
+
+/**
+ * fu_install_task_is_independent:
+ * @task1: first #FuInstallTask to compare.
+ * @task2: second #FuInstallTask to compare.
+ *
+ * Checks if two install tasks can be run at the same time, which is only
+ * possible if the devices and proxies share no composite ID and have the
+ * same order. The composite ID is the ID of the root device, which is
+ * used rather than the object as the root may be replugged during an update.
+ *
+ * Returns: %TRUE if the tasks do not depend on each other
+ **/
+gboolean
+fu_install_task_is_independent (FuInstallTask *task1, FuInstallTask *task2)
+{
+	g_autoptr(GPtrArray) roots1 = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GPtrArray) roots2 = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (task1), FALSE);
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (task2), FALSE);
+
+	if (fu_install_task_compare (task1, task2) != 0)
+		return FALSE;
+	fu_install_task_add_roots (task1, roots1);
+	fu_install_task_add_roots (task2, roots2);
+	for (guint i = 0; i < roots1->len; i++) {
+		FuDevice *root1 = g_ptr_array_index (roots1, i);
+		for (guint j = 0; j < roots2->len; j++) {
+			FuDevice *root2 = g_ptr_array_index (roots2, j);
+			if (root1 == root2)
+				return FALSE;
+			if (fu_device_get_id (root1) != NULL &&
+			    g_strcmp0 (fu_device_get_id (root1),
+				       fu_device_get_id (root2)) == 0)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /**
  * fu_install_task_new:
  * @device: A #FuDevice
@@ -26,3 +26,5 @@ gboolean	 fu_install_task_check_requirements	(FuInstallTask	*self,
 const gchar	*fu_install_task_get_action_id		(FuInstallTask	*self);
 gint		 fu_install_task_compare		(FuInstallTask	*task1,
 							 FuInstallTask	*task2);
+gboolean	 fu_install_task_is_independent		(FuInstallTask	*task1,
+							 FuInstallTask	*task2);
@@ -25,6 +25,7 @@
 #include <jcat.h>
 
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-plugin-private.h"
 #include "fwupd-security-attr-private.h"
 #include "fwupd-release-private.h"
@@ -33,11 +34,15 @@
 
 #include "fu-common.h"
 #include "fu-debug.h"
+#include "fu-device-changed-queue.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-install-task.h"
 #include "fu-security-attrs-private.h"
 
+/* the fastest each device can be sent to clients while updating */
+#define FU_MAIN_DEVICE_CHANGED_INTERVAL		100	/* ms */
+
 #ifdef HAVE_POLKIT
 #ifndef HAVE_POLKIT_0_114
 #pragma clang diagnostic push
@@ -61,6 +66,9 @@ typedef struct {
 	GMainLoop		*loop;
 	GFileMonitor		*argv0_monitor;
 	GHashTable		*sender_features;	/* sender:FwupdFeatureFlags */
+	GHashTable		*sender_devices;	/* sender:(device-id:GVariant) */
+	GMutex			 devices_mutex;		/* for the above */
+	FuDeviceChangedQueue	*devices_changed;
 #if GLIB_CHECK_VERSION(2,63,3)
 	GMemoryMonitor		*memory_monitor;
 #endif
@@ -125,7 +133,17 @@ fu_main_engine_device_removed_cb (FuEngine *engine,
 				  FuDevice *device,
 				  FuMainPrivate *priv)
 {
+	GHashTableIter iter;
 	GVariant *val;
+	gpointer value;
+
+	/* a pending change is no longer useful */
+	fu_device_changed_queue_remove (priv->devices_changed, fu_device_get_id (device));
+	g_mutex_lock (&priv->devices_mutex);
+	g_hash_table_iter_init (&iter, priv->sender_devices);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_hash_table_remove (value, fu_device_get_id (device));
+	g_mutex_unlock (&priv->devices_mutex);
 
 	/* not yet connected */
 	if (priv->connection == NULL)
@@ -139,17 +157,69 @@ fu_main_engine_device_removed_cb (FuEngine *engine,
 				       g_variant_new_tuple (&val, 1), NULL);
 }
 
+/* clients that asked for deltas do not listen to the DeviceChanged broadcast,
+ * so send them just the properties that changed since the last state they were
+ * sent, or the full device if they have not been sent it yet */
 static void
-fu_main_engine_device_changed_cb (FuEngine *engine,
-				  FuDevice *device,
-				  FuMainPrivate *priv)
+fu_main_emit_device_changed_senders (FuMainPrivate *priv, GVariant *val)
 {
-	GVariant *val;
+	GHashTableIter iter;
+	const gchar *device_id = NULL;
+	gpointer key;
+	gpointer value;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->devices_mutex);
+
+	if (!g_variant_lookup (val, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id))
+		return;
+	g_hash_table_iter_init (&iter, priv->sender_features);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *sender = (const gchar *) key;
+		guint64 *feature_flags = (guint64 *) value;
+		GHashTable *devices;
+		GVariant *val_old;
+
+		if ((*feature_flags & FWUPD_FEATURE_FLAG_DEVICE_DELTA) == 0)
+			continue;
+		devices = g_hash_table_lookup (priv->sender_devices, sender);
+		if (devices == NULL) {
+			devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, (GDestroyNotify) g_variant_unref);
+			g_hash_table_insert (priv->sender_devices, g_strdup (sender), devices);
+		}
+		val_old = g_hash_table_lookup (devices, device_id);
+		if (val_old != NULL) {
+			g_dbus_connection_emit_signal (priv->connection,
+						       sender,
+						       FWUPD_DBUS_PATH,
+						       FWUPD_DBUS_INTERFACE,
+						       "DeviceChangedDelta",
+						       fwupd_device_variant_delta (val_old, val),
+						       NULL);
+		} else {
+			g_dbus_connection_emit_signal (priv->connection,
+						       sender,
+						       FWUPD_DBUS_PATH,
+						       FWUPD_DBUS_INTERFACE,
+						       "DeviceChanged",
+						       g_variant_new_tuple (&val, 1), NULL);
+		}
+		g_hash_table_insert (devices, g_strdup (device_id), g_variant_ref (val));
+	}
+}
+
+static void
+fu_main_devices_changed_cb (FuDeviceChangedQueue *devices_changed,
+			    FuDevice *device,
+			    FuMainPrivate *priv)
+{
+	g_autoptr(GVariant) val = NULL;
 
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	val = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+					      FWUPD_DEVICE_FLAG_NONE);
+	fu_main_emit_device_changed_senders (priv, val);
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
@@ -158,6 +228,16 @@ fu_main_engine_device_changed_cb (FuEngine *engine,
 				       g_variant_new_tuple (&val, 1), NULL);
 }
 
+static void
+fu_main_engine_device_changed_cb (FuEngine *engine,
+				  FuDevice *device,
+				  FuMainPrivate *priv)
+{
+	/* progress can change hundreds of times a second, so rate limit;
+	 * this may be called from the thread of a parallel install */
+	fu_device_changed_queue_add (priv->devices_changed, device);
+}
+
 static void
 fu_main_emit_property_changed (FuMainPrivate *priv,
 			       const gchar *property_name,
@@ -272,8 +352,9 @@ fu_main_device_array_to_variant (FuMainPrivate *priv, FuEngineRequest *request,
 
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		GVariant *tmp = fwupd_device_to_variant_full (FWUPD_DEVICE (device),
-							      fu_engine_request_get_device_flags (request));
+		g_autoptr(GVariant) tmp = NULL;
+		tmp = fwupd_device_to_variant_cached (FWUPD_DEVICE (device),
+						      fu_engine_request_get_device_flags (request));
 		g_variant_builder_add_value (&builder, tmp);
 	}
 	return g_variant_new ("(aa{sv})", &builder);
@@ -1536,10 +1617,14 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_variant_get (parameters, "(t)", &feature_flags);
 		g_debug ("Called %s(%" G_GUINT64_FORMAT ")", method_name, feature_flags);
 
-		/* old flags for the same sender will be automatically destroyed */
+		/* old flags for the same sender will be automatically destroyed,
+		 * and the next change of each device is sent in full */
+		g_mutex_lock (&priv->devices_mutex);
 		g_hash_table_insert (priv->sender_features,
 				     g_strdup (sender),
 				     g_memdup (&feature_flags, sizeof(feature_flags)));
+		g_hash_table_remove (priv->sender_devices, sender);
+		g_mutex_unlock (&priv->devices_mutex);
 		g_dbus_method_invocation_return_value (invocation, NULL);
 		return;
 	}
@@ -1870,7 +1955,6 @@ fu_main_is_container (void)
 static void
 fu_main_private_free (FuMainPrivate *priv)
 {
-	g_hash_table_unref (priv->sender_features);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -1879,6 +1963,10 @@ fu_main_private_free (FuMainPrivate *priv)
 		g_object_unref (priv->proxy_uid);
 	if (priv->engine != NULL)
 		g_object_unref (priv->engine);
+	g_hash_table_unref (priv->sender_features);
+	g_hash_table_unref (priv->sender_devices);
+	g_object_unref (priv->devices_changed);
+	g_mutex_clear (&priv->devices_mutex);
 	if (priv->connection != NULL)
 		g_object_unref (priv->connection);
 #ifdef HAVE_POLKIT
@@ -1907,7 +1995,9 @@ int
 main (int argc, char *argv[])
 {
 	gboolean immediate_exit = FALSE;
+	gboolean no_probe_cache = FALSE;
 	gboolean timed_exit = FALSE;
+	FuEngineLoadFlags load_flags = FU_ENGINE_LOAD_FLAG_PROBE_CACHE;
 	const GOptionEntry options[] = {
 		{ "timed-exit", '\0', 0, G_OPTION_ARG_NONE, &timed_exit,
 		  /* TRANSLATORS: exit after we've started up, used for user profiling */
@@ -1915,6 +2005,9 @@ main (int argc, char *argv[])
 		{ "immediate-exit", '\0', 0, G_OPTION_ARG_NONE, &immediate_exit,
 		  /* TRANSLATORS: exit straight away, used for automatic profiling */
 		  _("Exit after the engine has loaded"), NULL },
+		{ "no-probe-cache", '\0', 0, G_OPTION_ARG_NONE, &no_probe_cache,
+		  /* TRANSLATORS: do not use the saved device state from the last run */
+		  _("Always set up devices using the hardware"), NULL },
 		{ NULL}
 	};
 	g_autoptr(FuMainPrivate) priv = NULL;
@@ -1943,6 +2036,13 @@ main (int argc, char *argv[])
 	/* create new objects */
 	priv = g_new0 (FuMainPrivate, 1);
 	priv->sender_features = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->sender_devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free, (GDestroyNotify) g_hash_table_unref);
+	g_mutex_init (&priv->devices_mutex);
+	priv->devices_changed = fu_device_changed_queue_new (FU_MAIN_DEVICE_CHANGED_INTERVAL);
+	g_signal_connect (priv->devices_changed, "device-changed",
+			  G_CALLBACK (fu_main_devices_changed_cb),
+			  priv);
 	priv->loop = g_main_loop_new (NULL, FALSE);
 
 	/* load engine */
@@ -1965,7 +2065,9 @@ main (int argc, char *argv[])
 	g_signal_connect (priv->engine, "percentage-changed",
 			  G_CALLBACK (fu_main_engine_percentage_changed_cb),
 			  priv);
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NONE, &error)) {
+	if (no_probe_cache)
+		load_flags &= ~FU_ENGINE_LOAD_FLAG_PROBE_CACHE;
+	if (!fu_engine_load (priv->engine, load_flags, &error)) {
 		g_printerr ("Failed to load engine: %s\n", error->message);
 		return EXIT_FAILURE;
 	}
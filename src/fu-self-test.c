@@ -16,6 +16,7 @@
 #include <string.h>
 
 #include "fu-config.h"
+#include "fu-device-changed-queue.h"
 #include "fu-device-list.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
@@ -28,6 +29,10 @@
 #include "fu-security-attr.h"
 #include "fu-security-attrs.h"
 #include "fu-smbios-private.h"
+#ifdef HAVE_ZSTD
+#include "fu-zstd-decompressor.h"
+#include <zstd.h>
+#endif
 
 typedef struct {
 	FuPlugin	*plugin;
@@ -940,6 +945,106 @@ fu_engine_requirements_parent_device_func (gconstpointer user_data)
 	g_assert (ret);
 }
 
+static void
+fu_engine_udev_changed_plugins_func (gconstpointer user_data)
+{
+	GPtrArray *plugins;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin1 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin2 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin3 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin4 = fu_plugin_new ();
+
+#ifndef HAVE_GUDEV
+	g_test_skip ("no GUdev support");
+	return;
+#endif
+
+	/* two plugins watching different subsystems, and one watching none */
+	fu_plugin_set_name (plugin1, "plugin1");
+	fu_plugin_set_build_hash (plugin1, FU_BUILD_HASH);
+	fu_plugin_add_udev_subsystem (plugin1, "drm");
+	fu_engine_add_plugin (engine, plugin1);
+	fu_plugin_set_name (plugin2, "plugin2");
+	fu_plugin_set_build_hash (plugin2, FU_BUILD_HASH);
+	fu_plugin_add_udev_subsystem (plugin2, "nvme");
+	fu_plugin_add_udev_subsystem (plugin2, "drm");
+	fu_engine_add_plugin (engine, plugin2);
+	fu_plugin_set_name (plugin3, "plugin3");
+	fu_plugin_set_build_hash (plugin3, FU_BUILD_HASH);
+	fu_engine_add_plugin (engine, plugin3);
+
+	/* only the plugins that asked for the subsystem */
+	plugins = fu_engine_get_udev_changed_plugins (engine, "nvme");
+	g_assert_nonnull (plugins);
+	g_assert_cmpint (plugins->len, ==, 1);
+	g_assert_true (g_ptr_array_index (plugins, 0) == plugin2);
+	plugins = fu_engine_get_udev_changed_plugins (engine, "drm");
+	g_assert_nonnull (plugins);
+	g_assert_cmpint (plugins->len, ==, 2);
+	g_assert_true (g_ptr_array_index (plugins, 0) == plugin1);
+	g_assert_true (g_ptr_array_index (plugins, 1) == plugin2);
+
+	/* nobody watching, or no subsystem */
+	g_assert_null (fu_engine_get_udev_changed_plugins (engine, "usb"));
+	g_assert_null (fu_engine_get_udev_changed_plugins (engine, NULL));
+
+	/* a plugin added later is included */
+	fu_plugin_set_name (plugin4, "plugin4");
+	fu_plugin_set_build_hash (plugin4, FU_BUILD_HASH);
+	fu_plugin_add_udev_subsystem (plugin4, "usb");
+	fu_engine_add_plugin (engine, plugin4);
+	plugins = fu_engine_get_udev_changed_plugins (engine, "usb");
+	g_assert_nonnull (plugins);
+	g_assert_cmpint (plugins->len, ==, 1);
+	g_assert_true (g_ptr_array_index (plugins, 0) == plugin4);
+}
+
+static void
+fu_engine_install_groups_func (gconstpointer user_data)
+{
+	GPtrArray *group;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin1 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin2 = fu_plugin_new ();
+	g_autoptr(GPtrArray) groups = NULL;
+	g_autoptr(GPtrArray) install_tasks = NULL;
+
+	/* only the second plugin can update devices at the same time */
+	fu_plugin_set_name (plugin1, "plugin1");
+	fu_plugin_set_build_hash (plugin1, FU_BUILD_HASH);
+	fu_engine_add_plugin (engine, plugin1);
+	fu_plugin_set_name (plugin2, "plugin2");
+	fu_plugin_set_build_hash (plugin2, FU_BUILD_HASH);
+	fu_plugin_add_thread_flag (plugin2, FU_PLUGIN_THREAD_FLAG_UPDATE);
+	fu_engine_add_plugin (engine, plugin2);
+
+	/* unrelated devices, two from each plugin and one from neither */
+	install_tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < 5; i++) {
+		g_autoptr(FuDevice) device = fu_device_new ();
+		if (i < 2)
+			fu_device_set_plugin (device, "plugin1");
+		else if (i < 4)
+			fu_device_set_plugin (device, "plugin2");
+		g_ptr_array_add (install_tasks, fu_install_task_new (device, NULL));
+	}
+	groups = fu_engine_get_install_groups (engine, install_tasks);
+	g_assert_nonnull (groups);
+	g_assert_cmpint (groups->len, ==, 4);
+
+	/* the plugin that did not opt in has its devices updated in order */
+	group = g_ptr_array_index (groups, 0);
+	g_assert_cmpint (group->len, ==, 2);
+	g_assert_true (g_ptr_array_index (group, 0) == g_ptr_array_index (install_tasks, 0));
+	g_assert_true (g_ptr_array_index (group, 1) == g_ptr_array_index (install_tasks, 1));
+	for (guint i = 1; i < groups->len; i++) {
+		group = g_ptr_array_index (groups, i);
+		g_assert_cmpint (group->len, ==, 1);
+		g_assert_true (g_ptr_array_index (group, 0) == g_ptr_array_index (install_tasks, i + 1));
+	}
+}
+
 static void
 fu_engine_device_priority_func (gconstpointer user_data)
 {
@@ -1950,6 +2055,64 @@ _device_list_count_cb (FuDeviceList *device_list, FuDevice *device, gpointer use
 	(*cnt)++;
 }
 
+static gdouble
+fu_device_list_performance_lookup (guint devices_cnt)
+{
+	const guint loops = 10000;
+	g_autoptr(FuDeviceList) device_list = fu_device_list_new ();
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	for (guint i = 0; i < devices_cnt; i++) {
+		g_autoptr(FuDevice) device = fu_device_new ();
+		g_autofree gchar *id = g_strdup_printf ("device%u", i);
+		g_autofree gchar *physical_id = g_strdup_printf ("usb:00:%02x", i);
+		fu_device_set_physical_id (device, physical_id);
+		fu_device_set_id (device, id);
+		for (guint j = 0; j < 8; j++) {
+			g_autofree gchar *instance_id = g_strdup_printf ("USB\\VID_%04X&PID_%04X", i, j);
+			fu_device_add_instance_id (device, instance_id);
+		}
+		fu_device_convert_instance_ids (device);
+		fu_device_list_add (device_list, device);
+		g_ptr_array_add (devices, g_steal_pointer (&device));
+	}
+
+	/* always look for the last device added */
+	g_timer_reset (timer);
+	for (guint i = 0; i < loops; i++) {
+		FuDevice *device = g_ptr_array_index (devices, devices->len - 1);
+		GPtrArray *guids = fu_device_get_guids (device);
+		g_autofree gchar *id_short = g_strndup (fu_device_get_id (device), 8);
+		g_autoptr(FuDevice) device1 = NULL;
+		g_autoptr(FuDevice) device2 = NULL;
+		g_autoptr(FuDevice) device3 = NULL;
+		g_autoptr(GError) error = NULL;
+
+		device1 = fu_device_list_get_by_id (device_list, id_short, &error);
+		g_assert_no_error (error);
+		g_assert (device1 == device);
+		device2 = fu_device_list_get_by_guid (device_list,
+						      g_ptr_array_index (guids, guids->len - 1),
+						      &error);
+		g_assert_no_error (error);
+		g_assert (device2 == device);
+		device3 = fu_device_list_get_by_guid (device_list,
+						      "00000000-0000-0000-0000-000000000000",
+						      NULL);
+		g_assert (device3 == NULL);
+	}
+	return g_timer_elapsed (timer, NULL) * 1000.f * 1000.f / loops;
+}
+
+static void
+fu_device_list_performance_func (gconstpointer user_data)
+{
+	gdouble elapsed_small = fu_device_list_performance_lookup (10);
+	gdouble elapsed_large = fu_device_list_performance_lookup (1000);
+	g_test_message ("lookup@10=%.3fus lookup@1000=%.3fus", elapsed_small, elapsed_large);
+}
+
 static void
 fu_device_list_delay_func (gconstpointer user_data)
 {
@@ -2007,6 +2170,82 @@ fu_device_list_delay_func (gconstpointer user_data)
 	g_assert_cmpint (changed_cnt, ==, 1);
 }
 
+typedef struct {
+	guint		 cnt;
+	gchar		*version;	/* of the last emitted */
+} FuDeviceChangedQueueHelper;
+
+static void
+_device_changed_queue_cb (FuDeviceChangedQueue *queue,
+			  FuDevice *device,
+			  gpointer user_data)
+{
+	FuDeviceChangedQueueHelper *helper = (FuDeviceChangedQueueHelper *) user_data;
+	helper->cnt++;
+	g_free (helper->version);
+	helper->version = g_strdup (fu_device_get_version (device));
+}
+
+static void
+fu_device_changed_queue_func (gconstpointer user_data)
+{
+	FuDeviceChangedQueueHelper helper = { 0 };
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDeviceChangedQueue) queue = fu_device_changed_queue_new (50);
+
+	g_signal_connect (queue, "device-changed",
+			  G_CALLBACK (_device_changed_queue_cb),
+			  &helper);
+
+	/* the first change is emitted now */
+	fu_device_set_id (device1, "device1");
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "1.2.3");
+	fu_device_changed_queue_add (queue, device1);
+	g_assert_cmpint (helper.cnt, ==, 1);
+	g_assert_cmpstr (helper.version, ==, "1.2.3");
+
+	/* changes in the interval are merged */
+	fu_device_set_version (device1, "1.2.4");
+	fu_device_changed_queue_add (queue, device1);
+	fu_device_set_version (device1, "1.2.5");
+	fu_device_changed_queue_add (queue, device1);
+	g_assert_cmpint (helper.cnt, ==, 1);
+
+	/* a different device is not rate limited by the first */
+	fu_device_set_id (device2, "device2");
+	fu_device_set_version_format (device2, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device2, "2.0.0");
+	fu_device_changed_queue_add (queue, device2);
+	g_assert_cmpint (helper.cnt, ==, 2);
+	g_assert_cmpstr (helper.version, ==, "2.0.0");
+
+	/* only the latest state of the first device is emitted */
+	fu_test_loop_run_with_timeout (75);
+	fu_test_loop_quit ();
+	g_assert_cmpint (helper.cnt, ==, 3);
+	g_assert_cmpstr (helper.version, ==, "1.2.5");
+
+	/* nothing changed in the last interval, so the next is emitted now */
+	fu_test_loop_run_with_timeout (75);
+	fu_test_loop_quit ();
+	g_assert_cmpint (helper.cnt, ==, 3);
+	fu_device_set_version (device1, "1.2.6");
+	fu_device_changed_queue_add (queue, device1);
+	g_assert_cmpint (helper.cnt, ==, 4);
+	g_assert_cmpstr (helper.version, ==, "1.2.6");
+
+	/* a pending change is dropped when the device is removed */
+	fu_device_set_version (device1, "1.2.7");
+	fu_device_changed_queue_add (queue, device1);
+	fu_device_changed_queue_remove (queue, fu_device_get_id (device1));
+	fu_test_loop_run_with_timeout (75);
+	fu_test_loop_quit ();
+	g_assert_cmpint (helper.cnt, ==, 4);
+	g_free (helper.version);
+}
+
 typedef struct {
 	FuDevice	*device_new;
 	FuDevice	*device_old;
@@ -2433,6 +2672,10 @@ fu_history_migrate_func (gconstpointer user_data)
 	g_autoptr(FuHistory) history = NULL;
 	g_autofree gchar *filename = NULL;
 
+	/* remove any stale write-ahead log from a previous run */
+	g_unlink ("/tmp/fwupd-self-test/var/lib/fwupd/pending.db-wal");
+	g_unlink ("/tmp/fwupd-self-test/var/lib/fwupd/pending.db-shm");
+
 	/* load old version */
 	filename = g_build_filename (TESTDATADIR_SRC, "history_v1.db", NULL);
 	file_src = g_file_new_for_path (filename);
@@ -2453,6 +2696,73 @@ fu_history_migrate_func (gconstpointer user_data)
 	g_assert_cmpstr (fu_device_get_id (device), ==, "2ba16d10df45823dd4494ff10a0bfccfef512c9d");
 }
 
+static void
+fu_history_performance_func (gconstpointer user_data)
+{
+	gboolean ret;
+	const guint loops = 100000;
+	const guint gets = 1000;
+	gdouble elapsed_add;
+	gdouble elapsed_get;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *filename_shm = NULL;
+	g_autofree gchar *filename_wal = NULL;
+	g_autoptr(FuHistory) history = fu_history_new ();
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* start with an empty database */
+	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	if (!g_file_test (dirname, G_FILE_TEST_IS_DIR))
+		return;
+	filename = g_build_filename (dirname, "pending.db", NULL);
+	filename_wal = g_build_filename (dirname, "pending.db-wal", NULL);
+	filename_shm = g_build_filename (dirname, "pending.db-shm", NULL);
+	g_unlink (filename);
+	g_unlink (filename_wal);
+	g_unlink (filename_shm);
+
+	/* add lots of devices in one transaction */
+	fwupd_release_set_version (release, "1.2.3");
+	ret = fu_history_start_transaction (history, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	for (guint i = 0; i < loops; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%040u", i);
+		g_autoptr(FuDevice) device = fu_device_new ();
+		fu_device_set_id (device, id);
+		fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+		fu_device_set_version (device, "1.2.2");
+		ret = fu_history_add_device (history, device, release, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+	}
+	ret = fu_history_commit_transaction (history, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	elapsed_add = g_timer_elapsed (timer, NULL) * 1000.f * 1000.f / loops;
+
+	/* look up devices using the index */
+	g_timer_reset (timer);
+	for (guint i = 0; i < gets; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%040u", i * 97);
+		g_autoptr(FuDevice) device = NULL;
+		device = fu_history_get_device_by_id (history, id, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (device);
+	}
+	elapsed_get = g_timer_elapsed (timer, NULL) * 1000.f * 1000.f / gets;
+	g_test_message ("add=%.3fus get=%.3fus", elapsed_add, elapsed_get);
+
+	/* do not leave a huge database for the other tests */
+	g_clear_object (&history);
+	g_unlink (filename);
+	g_unlink (filename_wal);
+	g_unlink (filename_shm);
+}
+
 static void
 _plugin_status_changed_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
 {
@@ -2971,6 +3281,83 @@ fu_security_attr_func (gconstpointer user_data)
 	}
 }
 
+#ifdef HAVE_ZSTD
+static void
+fu_zstd_decompressor_func (gconstpointer user_data)
+{
+	gsize bufsz;
+	gsize outsz;
+	gssize rc;
+	g_autofree guint8 *buf = NULL;
+	g_autofree guint8 *buf2 = NULL;
+	g_autoptr(FuZstdDecompressor) conv = fu_zstd_decompressor_new ();
+	g_autoptr(GBytes) blob_out = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) istream = NULL;
+	g_autoptr(GInputStream) istream_conv = NULL;
+	g_autoptr(GOutputStream) ostream = NULL;
+	g_autoptr(GString) xml = g_string_new ("<components>");
+
+	/* bigger than a single read so the converter gets called many times */
+	for (guint i = 0; i < 10000; i++)
+		g_string_append_printf (xml, "<component><id>%u</id></component>", i);
+	g_string_append (xml, "</components>");
+	bufsz = ZSTD_compressBound (xml->len);
+	buf = g_malloc0 (bufsz);
+	outsz = ZSTD_compress (buf, bufsz, xml->str, xml->len, 3);
+	g_assert_false (ZSTD_isError (outsz));
+
+	/* decompress */
+	istream = g_memory_input_stream_new_from_data (buf, outsz, NULL);
+	istream_conv = g_converter_input_stream_new (istream, G_CONVERTER (conv));
+	ostream = g_memory_output_stream_new_resizable ();
+	rc = g_output_stream_splice (ostream, istream_conv,
+				     G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				     NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (rc, ==, (gssize) xml->len);
+	blob_out = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (ostream));
+	g_assert_cmpint (g_bytes_get_size (blob_out), ==, xml->len);
+	g_assert (memcmp (g_bytes_get_data (blob_out, NULL), xml->str, xml->len) == 0);
+
+	/* truncated */
+	g_clear_object (&istream_conv);
+	g_clear_object (&istream);
+	g_clear_object (&ostream);
+	g_converter_reset (G_CONVERTER (conv));
+	istream = g_memory_input_stream_new_from_data (buf, outsz / 2, NULL);
+	istream_conv = g_converter_input_stream_new (istream, G_CONVERTER (conv));
+	ostream = g_memory_output_stream_new_resizable ();
+	rc = g_output_stream_splice (ostream, istream_conv,
+				     G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				     NULL, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT);
+	g_assert_cmpint (rc, ==, -1);
+	g_clear_error (&error);
+
+	/* two concatenated frames */
+	g_clear_object (&istream_conv);
+	g_clear_object (&istream);
+	g_clear_object (&ostream);
+	g_clear_pointer (&blob_out, g_bytes_unref);
+	g_converter_reset (G_CONVERTER (conv));
+	buf2 = g_malloc0 (outsz * 2);
+	memcpy (buf2, buf, outsz);
+	memcpy (buf2 + outsz, buf, outsz);
+	istream = g_memory_input_stream_new_from_data (buf2, outsz * 2, NULL);
+	istream_conv = g_converter_input_stream_new (istream, G_CONVERTER (conv));
+	ostream = g_memory_output_stream_new_resizable ();
+	rc = g_output_stream_splice (ostream, istream_conv,
+				     G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				     NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (rc, ==, (gssize) xml->len * 2);
+	blob_out = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (ostream));
+	g_assert (memcmp ((const guint8 *) g_bytes_get_data (blob_out, NULL) + xml->len,
+			  xml->str, xml->len) == 0);
+}
+#endif
+
 static void
 fu_memcpy_func (gconstpointer user_data)
 {
@@ -3108,6 +3495,54 @@ fu_install_task_compare_func (gconstpointer user_data)
 	g_assert_cmpint (fu_device_get_order (device_tmp), ==, 99);
 }
 
+static void
+fu_install_task_independent_func (gconstpointer user_data)
+{
+	g_autoptr(FuDevice) parent = fu_device_new ();
+	g_autoptr(FuDevice) child = fu_device_new ();
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) proxy = fu_device_new ();
+	g_autoptr(FuInstallTask) task_parent = NULL;
+	g_autoptr(FuInstallTask) task_child = NULL;
+	g_autoptr(FuInstallTask) task1 = NULL;
+	g_autoptr(FuInstallTask) task2 = NULL;
+
+	/* unrelated devices */
+	task1 = fu_install_task_new (device1, NULL);
+	task2 = fu_install_task_new (device2, NULL);
+	g_assert_true (fu_install_task_is_independent (task1, task2));
+
+	/* different order */
+	fu_device_set_order (device2, 1);
+	g_assert_false (fu_install_task_is_independent (task1, task2));
+	fu_device_set_order (device2, 0);
+
+	/* shared proxy */
+	fu_device_set_proxy (device1, proxy);
+	g_assert_true (fu_install_task_is_independent (task1, task2));
+	fu_device_set_proxy (device2, proxy);
+	g_assert_false (fu_install_task_is_independent (task1, task2));
+
+	/* device is the proxy of the other */
+	fu_device_set_proxy (device2, device1);
+	g_assert_false (fu_install_task_is_independent (task1, task2));
+
+	/* same parent */
+	fu_device_add_child (parent, child);
+	task_parent = fu_install_task_new (parent, NULL);
+	task_child = fu_install_task_new (child, NULL);
+	g_assert_false (fu_install_task_is_independent (task_parent, task_child));
+	g_assert_true (fu_install_task_is_independent (task_parent, task1));
+
+	/* same composite ID, e.g. the root was replugged */
+	fu_device_set_proxy (device1, NULL);
+	fu_device_set_proxy (device2, NULL);
+	fu_device_set_id (device1, "composite");
+	fu_device_set_id (device2, "composite");
+	g_assert_false (fu_install_task_is_independent (task1, task2));
+}
+
 int
 main (int argc, char **argv)
 {
@@ -3151,18 +3586,30 @@ main (int argc, char **argv)
 			      fu_plugin_module_func);
 	g_test_add_data_func ("/fwupd/memcpy", self,
 			      fu_memcpy_func);
+#ifdef HAVE_ZSTD
+	g_test_add_data_func ("/fwupd/zstd-decompressor", self,
+			      fu_zstd_decompressor_func);
+#endif
 	g_test_add_data_func ("/fwupd/security-attr", self,
 			      fu_security_attr_func);
 	g_test_add_data_func ("/fwupd/device-list", self,
 			      fu_device_list_func);
 	g_test_add_data_func ("/fwupd/device-list{delay}", self,
 			      fu_device_list_delay_func);
+	g_test_add_data_func ("/fwupd/device-changed-queue", self,
+			      fu_device_changed_queue_func);
 	g_test_add_data_func ("/fwupd/device-list{compatible}", self,
 			      fu_device_list_compatible_func);
 	g_test_add_data_func ("/fwupd/device-list{remove-chain}", self,
 			      fu_device_list_remove_chain_func);
+	if (g_test_slow ()) {
+		g_test_add_data_func ("/fwupd/device-list{performance}", self,
+				      fu_device_list_performance_func);
+	}
 	g_test_add_data_func ("/fwupd/install-task{compare}", self,
 			      fu_install_task_compare_func);
+	g_test_add_data_func ("/fwupd/install-task{independent}", self,
+			      fu_install_task_independent_func);
 	g_test_add_data_func ("/fwupd/engine{device-unlock}", self,
 			      fu_engine_device_unlock_func);
 	g_test_add_data_func ("/fwupd/engine{multiple-releases}", self,
@@ -3215,6 +3662,10 @@ main (int argc, char **argv)
 			      fu_engine_requirements_version_format_func);
 	g_test_add_data_func ("/fwupd/engine{device-auto-parent}", self,
 			      fu_engine_device_parent_func);
+	g_test_add_data_func ("/fwupd/engine{udev-changed-plugins}", self,
+			      fu_engine_udev_changed_plugins_func);
+	g_test_add_data_func ("/fwupd/engine{install-groups}", self,
+			      fu_engine_install_groups_func);
 	g_test_add_data_func ("/fwupd/engine{device-priority}", self,
 			      fu_engine_device_priority_func);
 	g_test_add_data_func ("/fwupd/engine{install-duration}", self,
@@ -3229,6 +3680,10 @@ main (int argc, char **argv)
 			      fu_history_func);
 	g_test_add_data_func ("/fwupd/history{migrate}", self,
 			      fu_history_migrate_func);
+	if (g_test_slow ()) {
+		g_test_add_data_func ("/fwupd/history{performance}", self,
+				      fu_history_performance_func);
+	}
 	g_test_add_data_func ("/fwupd/plugin-list", self,
 			      fu_plugin_list_func);
 	g_test_add_data_func ("/fwupd/plugin-list{depsolve}", self,
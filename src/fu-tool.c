@@ -305,9 +305,15 @@ fu_main_engine_percentage_changed_cb (FuEngine *engine,
 static gboolean
 fu_util_watch (FuUtilPrivate *priv, gchar **values, GError **error)
 {
+	guint dispatched = 0;
+	guint skipped = 0;
+
 	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
 		return FALSE;
 	g_main_loop_run (priv->loop);
+	fu_engine_get_udev_changed_stats (priv->engine, &dispatched, &skipped);
+	g_debug ("udev change events dispatched: %u, skipped: %u",
+		 dispatched, skipped);
 	return TRUE;
 }
 
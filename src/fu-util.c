@@ -583,7 +583,6 @@ static gchar *
 fu_util_download_if_required (FuUtilPrivate *priv, const gchar *perhapsfn, GError **error)
 {
 	g_autofree gchar *filename = NULL;
-	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(SoupURI) uri = NULL;
 
 	/* a local file */
@@ -593,18 +592,10 @@ fu_util_download_if_required (FuUtilPrivate *priv, const gchar *perhapsfn, GErro
 	if (uri == NULL)
 		return g_strdup (perhapsfn);
 
-	/* download the firmware to a cachedir */
+	/* download the firmware to a cachedir, resuming if interrupted */
 	filename = fu_util_get_user_cache_path (perhapsfn);
-	if (!fu_common_mkdir_parent (filename, error))
-		return NULL;
-	blob = fwupd_client_download_bytes (priv->client, perhapsfn,
-					    FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
-					    priv->cancellable, error);
-	if (blob == NULL)
-		return NULL;
-
-	/* save file to cache */
-	if (!fu_common_set_contents_bytes (filename, blob, error))
+	if (!fwupd_client_download_file (priv->client, perhapsfn, filename,
+					 priv->cancellable, error))
 		return NULL;
 	return g_steal_pointer (&filename);
 }
@@ -3155,7 +3146,8 @@ main (int argc, char *argv[])
 						     FWUPD_FEATURE_FLAG_CAN_REPORT |
 						     FWUPD_FEATURE_FLAG_SWITCH_BRANCH |
 						     FWUPD_FEATURE_FLAG_UPDATE_ACTION |
-						     FWUPD_FEATURE_FLAG_DETACH_ACTION,
+						     FWUPD_FEATURE_FLAG_DETACH_ACTION |
+						     FWUPD_FEATURE_FLAG_DEVICE_DELTA,
 						     priv->cancellable, &error)) {
 			g_printerr ("Failed to set front-end features: %s\n",
 				    error->message);
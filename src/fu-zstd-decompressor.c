@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuZstdDecompressor"
+
+#include "config.h"
+
+#include <zstd.h>
+
+#include "fu-zstd-decompressor.h"
+
+/* a #GConverter so that zstd-compressed metadata can be decompressed as it
+ * is being parsed, in the same way as #GZlibDecompressor */
+
+struct _FuZstdDecompressor {
+	GObject			 parent_instance;
+	ZSTD_DStream		*dstream;
+	gboolean		 frame_done;
+};
+
+static void fu_zstd_decompressor_iface_init (GConverterIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (FuZstdDecompressor, fu_zstd_decompressor, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+						fu_zstd_decompressor_iface_init))
+
+static void
+fu_zstd_decompressor_reset (GConverter *converter)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (converter);
+	ZSTD_initDStream (self->dstream);
+	self->frame_done = FALSE;
+}
+
+static GConverterResult
+fu_zstd_decompressor_convert (GConverter *converter,
+			      const void *inbuf,
+			      gsize inbuf_size,
+			      void *outbuf,
+			      gsize outbuf_size,
+			      GConverterFlags flags,
+			      gsize *bytes_read,
+			      gsize *bytes_written,
+			      GError **error)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (converter);
+	ZSTD_inBuffer input = { inbuf, inbuf_size, 0 };
+	ZSTD_outBuffer output = { outbuf, outbuf_size, 0 };
+	gsize rc;
+
+	rc = ZSTD_decompressStream (self->dstream, &output, &input);
+	if (ZSTD_isError (rc)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "failed to decompress: %s",
+			     ZSTD_getErrorName (rc));
+		return G_CONVERTER_ERROR;
+	}
+	*bytes_read = input.pos;
+	*bytes_written = output.pos;
+
+	/* the stream may contain more than one frame, e.g. from pzstd */
+	if (rc == 0)
+		self->frame_done = TRUE;
+	else if (input.pos > 0)
+		self->frame_done = FALSE;
+
+	/* end of the last frame */
+	if (self->frame_done &&
+	    (flags & G_CONVERTER_INPUT_AT_END) > 0 &&
+	    input.pos == inbuf_size)
+		return G_CONVERTER_FINISHED;
+
+	/* no progress could be made */
+	if (input.pos == 0 && output.pos == 0) {
+		if (flags & G_CONVERTER_INPUT_AT_END) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_PARTIAL_INPUT,
+					     "truncated zstd frame");
+			return G_CONVERTER_ERROR;
+		}
+		if (output.size == 0) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_NO_SPACE,
+					     "output buffer too small");
+			return G_CONVERTER_ERROR;
+		}
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_PARTIAL_INPUT,
+				     "need more input");
+		return G_CONVERTER_ERROR;
+	}
+	return G_CONVERTER_CONVERTED;
+}
+
+static void
+fu_zstd_decompressor_iface_init (GConverterIface *iface)
+{
+	iface->convert = fu_zstd_decompressor_convert;
+	iface->reset = fu_zstd_decompressor_reset;
+}
+
+static void
+fu_zstd_decompressor_init (FuZstdDecompressor *self)
+{
+	self->dstream = ZSTD_createDStream ();
+	ZSTD_initDStream (self->dstream);
+}
+
+static void
+fu_zstd_decompressor_finalize (GObject *object)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (object);
+	ZSTD_freeDStream (self->dstream);
+	G_OBJECT_CLASS (fu_zstd_decompressor_parent_class)->finalize (object);
+}
+
+static void
+fu_zstd_decompressor_class_init (FuZstdDecompressorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_zstd_decompressor_finalize;
+}
+
+FuZstdDecompressor *
+fu_zstd_decompressor_new (void)
+{
+	return g_object_new (FU_TYPE_ZSTD_DECOMPRESSOR, NULL);
+}